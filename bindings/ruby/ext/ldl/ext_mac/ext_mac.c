@@ -24,6 +24,7 @@
 #include <stddef.h>
 
 #include "lora_mac.h"
+#include "lora_airtime.h"
 
 static const uint8_t default_key[] = "\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00";
 static const uint8_t default_eui[] = "\x00\x00\x00\x00\x00\x00\x00\x00";
@@ -47,8 +48,15 @@ static VALUE data(int argc, VALUE *argv, VALUE self);
 static VALUE io_event(VALUE self, VALUE event, VALUE time);
 static VALUE ticksUntilNextChannel(VALUE self);
 static VALUE ticksUntilNextEvent(VALUE self);
+static VALUE eventStats(VALUE self);
+static VALUE setADR(VALUE self, VALUE value);
+static VALUE getADR(VALUE self);
+static VALUE adrStats(VALUE self);
 static VALUE transmitTimeUp(VALUE self, VALUE bw, VALUE sf, VALUE size);
 static VALUE transmitTimeDown(VALUE self, VALUE bw, VALUE sf, VALUE size);
+static VALUE transmitTimeUpUs(VALUE self, VALUE bw, VALUE sf, VALUE size);
+static VALUE transmitTimeDownUs(VALUE self, VALUE bw, VALUE sf, VALUE size);
+static VALUE transmitTimeUs(VALUE bandwidth, VALUE spreading_factor, VALUE size, bool crc);
 
 static void response(void *receiver, enum lora_mac_response_type type, const union lora_mac_response_arg *arg);
 
@@ -373,9 +381,15 @@ void Init_ext_mac(void)
     rb_define_method(cExtMAC, "io_event", io_event, 2);    
     rb_define_method(cExtMAC, "ticksUntilNextEvent", ticksUntilNextEvent, 0);    
     rb_define_method(cExtMAC, "ticksUntilNextChannel", ticksUntilNextChannel, 0);    
+    rb_define_method(cExtMAC, "eventStats", eventStats, 0);    
+    rb_define_method(cExtMAC, "adr=", setADR, 1);    
+    rb_define_method(cExtMAC, "adr", getADR, 0);    
+    rb_define_method(cExtMAC, "adrStats", adrStats, 0);    
     
     rb_define_singleton_method(cExtMAC, "transmitTimeUp", transmitTimeUp, 3);
     rb_define_singleton_method(cExtMAC, "transmitTimeDown", transmitTimeDown, 3);
+    rb_define_singleton_method(cExtMAC, "transmitTimeUpUs", transmitTimeUpUs, 3);
+    rb_define_singleton_method(cExtMAC, "transmitTimeDownUs", transmitTimeDownUs, 3);
     
     cEUI64 = rb_const_get(cLDL, rb_intern("EUI64"));
     cKey = rb_const_get(cLDL, rb_intern("Key"));
@@ -893,6 +907,97 @@ static VALUE ticksUntilNextEvent(VALUE self)
     return (next == UINT64_MAX) ? Qnil : ULL2NUM(next);
 }
 
+static VALUE eventStats(VALUE self)
+{
+    static const struct {
+        
+        enum lora_mac_handler handler;
+        const char *name;
+        
+    } map[] = {
+        {LORA_MAC_HANDLER_TX, "tx"},
+        {LORA_MAC_HANDLER_TX_COMPLETE, "tx_complete"},
+        {LORA_MAC_HANDLER_RX_START, "rx_start"},
+        {LORA_MAC_HANDLER_RX_READY, "rx_ready"},
+        {LORA_MAC_HANDLER_RX_TIMEOUT, "rx_timeout"}
+    };
+    
+    struct lora_mac *this;    
+    struct lora_event_stats stats;
+    VALUE retval = rb_hash_new();
+    VALUE entry;
+    VALUE histogram;
+    size_t i;
+    size_t j;
+    
+    Data_Get_Struct(self, struct lora_mac, this);
+    
+    for(i=0U; i < sizeof(map)/sizeof(*map); i++){
+        
+        if(MAC_getEventStats(this, map[i].handler, &stats)){
+            
+            histogram = rb_ary_new();
+            
+            for(j=0U; j < EVENT_STATS_BUCKETS; j++){
+                
+                rb_ary_push(histogram, UINT2NUM(stats.histogram[j]));
+            }
+            
+            entry = rb_hash_new();
+            
+            rb_hash_aset(entry, ID2SYM(rb_intern("count")), UINT2NUM(stats.count));
+            rb_hash_aset(entry, ID2SYM(rb_intern("late")), UINT2NUM(stats.late));
+            rb_hash_aset(entry, ID2SYM(rb_intern("min")), UINT2NUM(stats.min));
+            rb_hash_aset(entry, ID2SYM(rb_intern("max")), UINT2NUM(stats.max));
+            rb_hash_aset(entry, ID2SYM(rb_intern("histogram")), histogram);
+            
+            rb_hash_aset(retval, ID2SYM(rb_intern(map[i].name)), entry);
+        }
+    }
+    
+    return retval;
+}
+
+static VALUE setADR(VALUE self, VALUE value)
+{
+    struct lora_mac *this;    
+    Data_Get_Struct(self, struct lora_mac, this);
+    
+    MAC_setADR(this, RTEST(value));
+    
+    return self;
+}
+
+static VALUE getADR(VALUE self)
+{
+    struct lora_mac *this;    
+    Data_Get_Struct(self, struct lora_mac, this);
+    
+    return MAC_getADR(this) ? Qtrue : Qfalse;
+}
+
+static VALUE adrStats(VALUE self)
+{
+    struct lora_mac *this;    
+    struct lora_mac_adr_stats stats;
+    VALUE retval = rb_hash_new();
+    
+    Data_Get_Struct(self, struct lora_mac, this);
+    
+    MAC_getADRStats(this, &stats);
+    
+    rb_hash_aset(retval, ID2SYM(rb_intern("ack_counter")), UINT2NUM(stats.ackCounter));
+    rb_hash_aset(retval, ID2SYM(rb_intern("ack_req")), UINT2NUM(stats.ackReq));
+    rb_hash_aset(retval, ID2SYM(rb_intern("link_adr_accepted")), UINT2NUM(stats.linkADRAccepted));
+    rb_hash_aset(retval, ID2SYM(rb_intern("link_adr_rejected")), UINT2NUM(stats.linkADRRejected));
+    rb_hash_aset(retval, ID2SYM(rb_intern("last_status")), UINT2NUM(stats.lastStatus));
+    rb_hash_aset(retval, ID2SYM(rb_intern("power_reset")), UINT2NUM(stats.powerReset));
+    rb_hash_aset(retval, ID2SYM(rb_intern("rate_decreased")), UINT2NUM(stats.rateDecreased));
+    rb_hash_aset(retval, ID2SYM(rb_intern("channels_reset")), UINT2NUM(stats.channelsReset));
+    
+    return retval;
+}
+
 static VALUE transmitTimeUp(VALUE self, VALUE bandwidth, VALUE spreading_factor, VALUE size)
 {
     return UINT2NUM(MAC_transmitTimeUp(number_to_bw(bandwidth), number_to_sf(spreading_factor), (uint8_t)NUM2UINT(size)));
@@ -903,6 +1008,30 @@ static VALUE transmitTimeDown(VALUE self, VALUE bandwidth, VALUE spreading_facto
     return UINT2NUM(MAC_transmitTimeDown(number_to_bw(bandwidth), number_to_sf(spreading_factor), (uint8_t)NUM2UINT(size)));
 }
 
+static VALUE transmitTimeUpUs(VALUE self, VALUE bandwidth, VALUE spreading_factor, VALUE size)
+{
+    return transmitTimeUs(bandwidth, spreading_factor, size, true);
+}
+
+static VALUE transmitTimeDownUs(VALUE self, VALUE bandwidth, VALUE spreading_factor, VALUE size)
+{
+    return transmitTimeUs(bandwidth, spreading_factor, size, false);
+}
+
+static VALUE transmitTimeUs(VALUE bandwidth, VALUE spreading_factor, VALUE size, bool crc)
+{
+    enum lora_signal_bandwidth bw = number_to_bw(bandwidth);
+    enum lora_spreading_factor sf = number_to_sf(spreading_factor);
+    uint8_t options = crc ? (uint8_t)LORA_AIRTIME_CRC : 0U;
+    
+    if(Airtime_lowDataRateOptimize(sf, bw)){
+        
+        options |= (uint8_t)LORA_AIRTIME_LDRO;
+    }
+    
+    return UINT2NUM(Airtime_us(sf, bw, CR_5, options, (uint8_t)NUM2UINT(size)));
+}
+
 static VALUE ticksUntilNextChannel(VALUE self)
 {
     struct lora_mac *this;    
@@ -8,6 +8,7 @@ $srcs = ['ext_mac.c'].concat(lib_sources)
 $VPATH << File.join(root_dir, "src")
 $INCFLAGS << " -I#{File.join(root_dir, "include")} -I#{port_dir}"
 $defs << " -DLORA_DEBUG_INCLUDE=\\\"ext_lora_debug.h\\\""
+$defs << " -DLORA_EVENT_STATS"
 
 create_makefile('ldl/ext_mac')
 
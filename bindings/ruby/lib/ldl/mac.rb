@@ -60,6 +60,34 @@ module LDL
             end            
         end
         
+        # dispatch lateness of each MAC event handler
+        #
+        # @return [Hash] handler name => {count:, late:, min:, max:, histogram:}
+        def eventStats
+            with_mutex do
+                super
+            end
+        end
+        
+        # enable or disable Adaptive Data Rate
+        #
+        # @param value [true,false]
+        def adr=(value)
+            with_mutex do
+                super
+            end
+            self
+        end
+        
+        # ADR decisions
+        #
+        # @return [Hash] ack_counter:, ack_req:, link_adr_accepted:, link_adr_rejected:, last_status:, power_reset:, rate_decreased:, channels_reset:
+        def adrStats
+            with_mutex do
+                super
+            end
+        end
+        
         def io_event(event, time)
         
             #Logger.debug "io_event #{event} at #{time}"
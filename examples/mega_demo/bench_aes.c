@@ -0,0 +1,128 @@
+/* Copyright (c) 2018 Cameron Harper
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * */
+
+/* Cycles per LoraAES_encrypt block on the target
+ * 
+ * Built once with the C implementation (bin/bench_aes_c.elf) and once 
+ * with aes_avr.S (bin/bench_aes_asm.elf) by `make bench`. The result 
+ * is printed on the UART.
+ * 
+ * */
+
+#include <avr/interrupt.h>
+#include <avr/io.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#include "lora_aes.h"
+
+#ifndef BAUD
+    #define BAUD 9600
+#endif
+
+#if defined(LORA_USE_PLATFORM_AES)
+    #define IMPLEMENTATION "asm"
+#else
+    #define IMPLEMENTATION "c"
+#endif
+
+#define BLOCKS 64U
+
+static int putUART(char c, FILE *stream);
+
+static FILE uart = FDEV_SETUP_STREAM(putUART, NULL, _FDEV_SETUP_WRITE);
+
+/* upper 16 bits of the cycle counter */
+static volatile uint16_t overflows;
+
+ISR(TIMER1_OVF_vect)
+{
+    overflows++;
+}
+
+int main(void)
+{
+    /* FIPS-197 C.1 */
+    static const uint8_t key[] = {0x00,0x01,0x02,0x03,0x04,0x05,0x06,0x07,0x08,0x09,0x0a,0x0b,0x0c,0x0d,0x0e,0x0f};
+    static const uint8_t pt[] = {0x00,0x11,0x22,0x33,0x44,0x55,0x66,0x77,0x88,0x99,0xaa,0xbb,0xcc,0xdd,0xee,0xff};
+    static const uint8_t ct[] = {0x69,0xc4,0xe0,0xd8,0x6a,0x7b,0x04,0x30,0xd8,0xcd,0xb7,0x80,0x70,0xb4,0xc5,0x5a};
+
+    struct lora_aes_ctx ctx;
+    uint8_t s[AES_BLOCK_SIZE];
+    uint32_t cycles;
+    uint8_t i;
+
+    UBRR0L = (uint8_t)(F_CPU/(BAUD*16L)-1);
+    UCSR0B = (1U<<TXEN0);
+    UCSR0C = (1U<<UCSZ00) | (1U<<UCSZ01);
+
+    stdout = &uart;
+
+    LoraAES_init(&ctx, key);
+
+    (void)memcpy(s, pt, sizeof(s));
+    LoraAES_encrypt(&ctx, s);
+
+    printf("LoraAES_encrypt (%s): %s\n", IMPLEMENTATION, (memcmp(s, ct, sizeof(ct)) == 0) ? "ok" : "FAIL");
+
+    /* count every CPU cycle with timer1 */
+    TCCR1A = 0U;
+    TIMSK1 = (1U<<TOIE1);
+    TCNT1 = 0U;
+    sei();
+    TCCR1B = (1U<<CS10);
+
+    for(i=0U; i < BLOCKS; i++){
+
+        LoraAES_encrypt(&ctx, s);
+    }
+
+    TCCR1B = 0U;
+    cli();
+
+    cycles = ((uint32_t)overflows << 16) | TCNT1;
+
+    /* overflow while the timer was being stopped */
+    if((TIFR1 & (1U<<TOV1)) != 0U){
+
+        cycles += 0x10000UL;
+    }
+
+    printf("LoraAES_encrypt (%s): %lu cycles/block\n", IMPLEMENTATION, (unsigned long)(cycles / BLOCKS));
+
+    for(;;){
+    }
+
+    return 0;
+}
+
+static int putUART(char c, FILE *stream)
+{
+    (void)stream;
+
+    while((UCSR0A & (1U<<UDRE0)) == 0U){
+    }
+
+    UDR0 = (uint8_t)c;
+
+    return 0;
+}
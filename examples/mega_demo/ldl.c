@@ -26,6 +26,8 @@
 
 #include <avr/eeprom.h>
 #include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
 #include <util/atomic.h>
 
 #include <stdlib.h>
@@ -75,7 +77,20 @@ uint16_t downCounter EEMEM;
 
 bool ready = false;
 
-static uint64_t system_time;
+/* system time is timer1 counting microseconds (F_CPU / 8) extended by
+ * the overflow interrupt, so the CPU only wakes every 65.536ms when idle */
+static volatile uint64_t system_time;   /**< ticks at last timer1 overflow */
+static volatile uint8_t system_remainder;  /**< microseconds left over at last overflow (0..9) */
+
+#if F_CPU != 8000000U
+    #error "timer1 is set up for F_CPU == 8MHz"
+#endif
+
+/* microseconds per tick */
+#define US_PER_TICK (1000000UL / LORA_TICKS_PER_SECOND)
+
+/* don't bother sleeping for less than this many ticks */
+#define MIN_SLEEP 5U
 
 static struct param_store params EEMEM;
 
@@ -83,6 +98,7 @@ volatile struct lora_radio radio;
 volatile struct lora_mac mac;
 
 static void setup_external_interrupts(void);
+static void setup_timer(void);
 static void response_handler(void *receiver, enum lora_mac_response_type type, const union lora_mac_response_arg *arg);
 
 static uint8_t radio_read(void *receiver);
@@ -96,7 +112,7 @@ static void radio_write(void *receiver, uint8_t data);
 
 void ldl_init(void)
 {
-    system_time = 0U;
+    setup_timer();
     
     struct lora_board board = {
     
@@ -122,6 +138,44 @@ void ldl_tick(void **state, void (*on_ready)(void **))
     MAC_tick(&mac);    
 }
 
+void ldl_sleep(void)
+{
+    uint64_t deadline;
+    uint64_t now;
+    uint64_t interval;
+    
+    /* an interrupt from here on will wake the CPU from sleep_cpu() */
+    cli();
+    
+    deadline = MAC_nextDeadline(&mac);
+    now = System_time();
+    
+    if(deadline > (now + MIN_SLEEP)){
+        
+        interval = deadline - now;
+        
+        /* wake on compare if the deadline is before the next overflow */
+        if(interval < (0xffffUL / US_PER_TICK)){
+            
+            OCR1A = TCNT1 + (uint16_t)(interval * US_PER_TICK);
+            TIFR1 = (1U << OCF1A);
+            TIMSK1 |= (1U << OCIE1A);
+        }
+        
+        set_sleep_mode(SLEEP_MODE_IDLE);
+        sleep_enable();
+        
+        /* sleep_cpu() executes before any pending interrupt */
+        sei();
+        sleep_cpu();
+        
+        sleep_disable();
+        TIMSK1 &= ~(1U << OCIE1A);
+    }
+    
+    sei();
+}
+
 bool ldl_join(void)
 {
     return MAC_join(&mac);
@@ -278,6 +332,11 @@ uint8_t System_getNbTrans(void *receiver)
     return eeprom_read_byte(&params.nb_trans);
 }
 
+void System_setNbTrans(void *receiver, uint8_t value)
+{
+    eeprom_update_byte(&params.nb_trans, value);
+}
+
 uint8_t System_getTXPower(void *receiver)
 {
     return eeprom_read_byte(&params.tx_power);
@@ -408,16 +467,38 @@ ISR(INT1_vect){
     Radio_interrupt(&radio, 1U, System_time());
 }
 
+ISR(TIMER1_OVF_vect){
+    
+    uint32_t us = 0x10000UL + system_remainder;
+    
+    system_time += us / US_PER_TICK;
+    system_remainder = us % US_PER_TICK;
+}
+
+/* only needed to wake from sleep */
+EMPTY_INTERRUPT(TIMER1_COMPA_vect);
+
 uint64_t System_time(void)
 {
     uint64_t retval;
+    uint32_t us;
     
-    ATOMIC_BLOCK(ATOMIC_FORCEON)
+    /* restore since ldl_sleep() reads the time with interrupts disabled */
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
     {
         retval = system_time;
+        us = TCNT1;
+        
+        /* overflow has happened but not yet been serviced */
+        if(((TIFR1 & (1U << TOV1)) != 0U) && (us < 0x8000UL)){
+            
+            us += 0x10000UL;
+        }
+        
+        us += system_remainder;
     }
     
-    return retval;
+    return retval + (us / US_PER_TICK);
 }
 
 void System_atomic_setPtr(void **receiver, void *value)
@@ -481,6 +562,20 @@ static void enable_spi(void)
 #endif
 }
 
+static void setup_timer(void)
+{
+    system_time = 0U;
+    system_remainder = 0U;
+    
+    /* normal mode, F_CPU / 8 (1MHz at 8MHz) */
+    TCCR1A = 0U;
+    TCCR1B = (1U << CS11);
+    TCNT1 = 0U;
+    
+    TIFR1 = (1U << TOV1) | (1U << OCF1A);
+    TIMSK1 = (1U << TOIE1);
+}
+
 static void setup_external_interrupts(void)
 {
     /* configure INT0 and INT1 for rising edge interrupt */
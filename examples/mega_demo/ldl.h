@@ -27,6 +27,9 @@
 
 void ldl_init(void);
 void ldl_tick(void **state, void (*on_ready)(void **));
+
+/* sleep until the next MAC deadline or an interrupt */
+void ldl_sleep(void);
 bool ldl_join(void);
 
 #endif
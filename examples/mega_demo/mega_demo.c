@@ -41,6 +41,8 @@ void init(void)
 {
     uart_init();    
     ldl_init();
+    
+    sei();
 }
 
 void main(void)
@@ -48,6 +50,7 @@ void main(void)
     while(true){
         
         ldl_tick(NULL, app);            
+        ldl_sleep();
     }
 }
 
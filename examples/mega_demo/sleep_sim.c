@@ -0,0 +1,218 @@
+/* Copyright (c) 2018 Cameron Harper
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * */
+
+/* Host simulation of the mega_demo main loop
+ *
+ * Runs the event manager against a simulated clock with the schedule of
+ * a class A device (uplink, TX complete, RX1 and RX2 windows) and
+ * compares how long the CPU is awake when polling MAC_tick() against
+ * sleeping until MAC_nextDeadline() as ldl_sleep() does.
+ *
+ * Costs are in ticks (10us) and are estimates for an ATmega328p at
+ * 8MHz; change them to suit.
+ *
+ * */
+
+#include "lora_event.h"
+#include "lora_system.h"
+
+#include <stdio.h>
+
+/* one hour */
+#define SIM_TICKS (3600ULL * 100000ULL)
+
+#define UPLINK_INTERVAL (60ULL * 100000ULL)     /* uplink every minute */
+#define AIRTIME 5000U                           /* ~50ms at SF7 */
+#define RX1_DELAY 100000U                       /* 1s */
+#define RX_WINDOW 800U                          /* ~8 symbols at SF7 */
+
+#define LOOP_COST 4U            /* ldl_tick() with nothing to do plus ldl_sleep() */
+#define HANDLER_COST 200U       /* radio SPI setup, frame encode etc. */
+#define OVERFLOW_PERIOD 6553U   /* timer1 overflow wakes the CPU this often */
+
+/* datasheet typicals at 8MHz/3V (radio not included) */
+#define ACTIVE_UA 3000.0
+#define IDLE_UA 800.0
+
+struct irq {
+
+    enum on_input_types type;
+    uint64_t time;
+    bool pending;
+};
+
+static uint64_t now;
+static uint64_t awake;
+static uint64_t loops;
+static uint64_t maxLateness;
+static struct irq radio;
+static struct lora_event events;
+
+/* static function prototypes *****************************************/
+
+static void work(uint64_t ticks);
+static void radioIRQ(enum on_input_types type, uint64_t time);
+static void deliver(void);
+static void uplink(void *receiver, uint64_t time, uint64_t error);
+static void txComplete(void *receiver, uint64_t time, uint64_t error);
+static void rxStart(void *receiver, uint64_t time, uint64_t error);
+static void rxTimeout(void *receiver, uint64_t time, uint64_t error);
+static void simulate(const char *name, bool sleep);
+
+/* functions **********************************************************/
+
+uint64_t System_time(void)
+{
+    return now;
+}
+
+int main(void)
+{
+    printf("%-10s %10s %10s %12s %14s\n", "loop", "awake %", "loops", "avg uA", "max late (us)");
+
+    simulate("polling", false);
+    simulate("tickless", true);
+
+    return 0;
+}
+
+/* static functions ***************************************************/
+
+/* CPU is busy for `ticks` */
+static void work(uint64_t ticks)
+{
+    now += ticks;
+    awake += ticks;
+}
+
+static void radioIRQ(enum on_input_types type, uint64_t time)
+{
+    radio.type = type;
+    radio.time = time;
+    radio.pending = true;
+}
+
+/* pass radio interrupts that have happened to the event manager */
+static void deliver(void)
+{
+    if(radio.pending && (radio.time <= now)){
+
+        radio.pending = false;
+        Event_receive(&events, radio.type, radio.time);
+    }
+}
+
+static void uplink(void *receiver, uint64_t time, uint64_t error)
+{
+    work(HANDLER_COST);
+
+    (void)Event_onTimeout(&events, time - error + UPLINK_INTERVAL, NULL, uplink);
+    (void)Event_onInput(&events, EVENT_TX_COMPLETE, NULL, txComplete);
+
+    radioIRQ(EVENT_TX_COMPLETE, now + AIRTIME);
+}
+
+static void txComplete(void *receiver, uint64_t time, uint64_t error)
+{
+    work(HANDLER_COST);
+
+    (void)Event_onTimeout(&events, time - error + RX1_DELAY, NULL, rxStart);
+    (void)Event_onTimeout(&events, time - error + RX1_DELAY + 100000U, NULL, rxStart);
+}
+
+static void rxStart(void *receiver, uint64_t time, uint64_t error)
+{
+    if(error > maxLateness){
+
+        maxLateness = error;
+    }
+
+    work(HANDLER_COST);
+
+    (void)Event_onInput(&events, EVENT_RX_TIMEOUT, NULL, rxTimeout);
+
+    radioIRQ(EVENT_RX_TIMEOUT, now + RX_WINDOW);
+}
+
+static void rxTimeout(void *receiver, uint64_t time, uint64_t error)
+{
+    work(HANDLER_COST);
+}
+
+static void simulate(const char *name, bool sleep)
+{
+    uint64_t wake;
+    uint64_t deadline;
+    double uA;
+
+    now = 0U;
+    awake = 0U;
+    loops = 0U;
+    maxLateness = 0U;
+    radio.pending = false;
+
+    Event_init(&events);
+
+    (void)Event_onTimeout(&events, 100U, NULL, uplink);
+
+    while(now < SIM_TICKS){
+
+        loops++;
+
+        deliver();
+        Event_tick(&events);
+        work(LOOP_COST);
+        deliver();
+
+        if(sleep){
+
+            deadline = Event_nextDeadline(&events);
+
+            /* timer1 overflow */
+            wake = ((now / OVERFLOW_PERIOD) + 1U) * OVERFLOW_PERIOD;
+
+            if(deadline < wake){
+
+                wake = deadline;
+            }
+
+            if(radio.pending && (radio.time < wake)){
+
+                wake = radio.time;
+            }
+
+            if(wake > now){
+
+                now = wake;
+            }
+        }
+    }
+
+    uA = ((ACTIVE_UA * (double)awake) + (IDLE_UA * (double)(now - awake))) / (double)now;
+
+    printf("%-10s %10.3f %10llu %12.0f %14llu\n",
+        name,
+        100.0 * (double)awake / (double)now,
+        (unsigned long long)loops,
+        uA,
+        (unsigned long long)maxLateness * 10U
+    );
+}
@@ -37,9 +37,20 @@ extern "C" {
 #endif
 
 #include <stdint.h>
+#include <stddef.h>
+
+/* a device only ever uses the forward cipher (define LORA_AES_DECRYPT to keep it) */
+#if defined(LORA_DEVICE) && !defined(LORA_AES_DECRYPT) && !defined(LORA_AES_NO_DECRYPT)
+    #define LORA_AES_NO_DECRYPT
+#endif
 
 #if defined(LORA_USE_PLATFORM_AES)
 
+/* Include the file that defines the platform struct lora_aes_ctx */
+#ifdef LORA_AES_INCLUDE
+#include LORA_AES_INCLUDE
+#endif
+
 struct lora_aes_ctx;
 
 #else
@@ -47,7 +58,7 @@ struct lora_aes_ctx;
 /** Stores the expanded key */
 struct lora_aes_ctx {
 
-    uint8_t k[240U];    /**< expanded key */
+    uint8_t k[176U];    /**< expanded key (AES-128 only) */
     uint8_t r;          /**< number of rounds */
 };
 
@@ -75,14 +86,47 @@ void LoraAES_init(struct lora_aes_ctx *ctx, const uint8_t *key);
  * */
 void LoraAES_encrypt(const struct lora_aes_ctx *ctx, uint8_t *s);
 
+#if !defined(LORA_AES_NO_DECRYPT)
 /**
  * Decrypt a block of memory called state
  * 
+ * @note not available if LORA_AES_NO_DECRYPT is defined
+ * 
  * @param[in] ctx
  * @param[in] s pointer to 16 bytes of state (any alignment)
  * 
  * */
 void LoraAES_decrypt(const struct lora_aes_ctx *ctx, uint8_t *s);
+#endif
+
+/**
+ * Encrypt (or decrypt) memory in-place using counter mode
+ * 
+ * The keystream is the encryption of `iv`, `iv + 1`, `iv + 2`, ... where
+ * the counter is the whole block incremented as a big-endian integer. 
+ * Several keystream blocks are generated together where the engine
+ * supports it.
+ * 
+ * @param[in] ctx
+ * @param[in] iv pointer to 16 byte initial counter block
+ * @param[in/out] data
+ * @param[in] len byte length of `data` (need not be a multiple of AES_BLOCK_SIZE)
+ * 
+ * */
+void LoraAES_ctr(const struct lora_aes_ctx *ctx, const uint8_t *iv, void *data, size_t len);
+
+/**
+ * Encrypt several independent blocks, each under its own key
+ * 
+ * Blocks are processed together where the engine supports it so this 
+ * is faster than calling LoraAES_encrypt() for each block.
+ * 
+ * @param[in] ctx array of `n` keys (`ctx[i]` encrypts block `i`)
+ * @param[in/out] s pointer to `n` consecutive 16 byte blocks of state
+ * @param[in] n number of blocks
+ * 
+ * */
+void LoraAES_encryptBlocks(const struct lora_aes_ctx *const *ctx, uint8_t *s, size_t n);
 
 #ifdef __cplusplus
 }
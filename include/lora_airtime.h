@@ -0,0 +1,93 @@
+/* Copyright (c) 2018 Cameron Harper
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * */
+
+#ifndef LORA_AIRTIME_H
+#define LORA_AIRTIME_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "lora_radio_defs.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/** preamble length (symbols) assumed by the time on air calculation */
+#define LORA_AIRTIME_PREAMBLE 8U
+
+/** Options that change the time on air of a LoRa frame (OR together) */
+enum lora_airtime_option {
+    
+    LORA_AIRTIME_CRC = 1U,              /**< payload has a trailing CRC (uplink) */
+    LORA_AIRTIME_IMPLICIT_HEADER = 2U,  /**< frame has no PHY header */
+    LORA_AIRTIME_LDRO = 4U              /**< low data rate optimisation (see Airtime_lowDataRateOptimize()) */
+};
+
+/** Time on air of a LoRa frame in ticks
+ * 
+ * Calculated from tables prepared at build time; there are no
+ * divisions at run-time.
+ * 
+ * @param[in] sf
+ * @param[in] bw
+ * @param[in] cr
+ * @param[in] options #lora_airtime_option
+ * @param[in] size PHY payload size (bytes)
+ * 
+ * @return ticks (rounded down) or 0 if the settings are not LoRa
+ * 
+ * */
+uint32_t Airtime_ticks(enum lora_spreading_factor sf, enum lora_signal_bandwidth bw, enum lora_coding_rate cr, uint8_t options, uint8_t size);
+
+/** Time on air of a LoRa frame in microseconds
+ * 
+ * This is exact (symbol periods are a whole number of microseconds) and
+ * is intended for hosts such as gateway simulations.
+ * 
+ * @param[in] sf
+ * @param[in] bw
+ * @param[in] cr
+ * @param[in] options #lora_airtime_option
+ * @param[in] size PHY payload size (bytes)
+ * 
+ * @return microseconds or 0 if the settings are not LoRa
+ * 
+ * */
+uint32_t Airtime_us(enum lora_spreading_factor sf, enum lora_signal_bandwidth bw, enum lora_coding_rate cr, uint8_t options, uint8_t size);
+
+/** Is low data rate optimisation required?
+ * 
+ * The SX1272 datasheet requires it when the symbol period is 16ms or
+ * longer.
+ * 
+ * @param[in] sf
+ * @param[in] bw
+ * 
+ * @return true if required
+ * 
+ * */
+bool Airtime_lowDataRateOptimize(enum lora_spreading_factor sf, enum lora_signal_bandwidth bw);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
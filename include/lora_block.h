@@ -0,0 +1,187 @@
+/* Copyright (c) 2017-2018 Cameron Harper
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * */
+
+
+#ifndef LORA_BLOCK_H
+#define LORA_BLOCK_H
+
+/**
+ * @defgroup lora_block 128 bit block primitives
+ * @ingroup lora
+ * 
+ * Internal helpers shared by the AES, CMAC and frame modules.
+ * 
+ * The implementation is chosen at compile time:
+ * 
+ * - LORA_AVR: byte at a time
+ * - SSE2 or NEON: one vector operation
+ * - otherwise: native machine words
+ * 
+ * All functions accept blocks of any alignment.
+ *
+ * @{
+ * */
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(LORA_AVR)
+    #define LORA_BLOCK_BYTE
+#elif defined(__SSE2__)
+    #define LORA_BLOCK_SSE2
+    #include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    #define LORA_BLOCK_NEON
+    #include <arm_neon.h>
+#elif (UINTPTR_MAX > 0xffffffffU)
+    #define LORA_BLOCK_WORD64
+#else
+    #define LORA_BLOCK_WORD32
+#endif
+
+/**
+ * XOR a block into an accumulator (may be aliased)
+ *
+ * @param[in/out] acc accumulator
+ * @param[in] mask XORed with accumulator
+ *
+ * */
+static inline void LoraBlock_xor128(uint8_t *acc, const uint8_t *mask)
+{
+#if defined(LORA_BLOCK_SSE2)
+    _mm_storeu_si128((__m128i *)acc, _mm_xor_si128(_mm_loadu_si128((const __m128i *)acc), _mm_loadu_si128((const __m128i *)mask)));
+#elif defined(LORA_BLOCK_NEON)
+    vst1q_u8(acc, veorq_u8(vld1q_u8(acc), vld1q_u8(mask)));
+#elif defined(LORA_BLOCK_WORD64)
+    uint64_t a[2U];
+    uint64_t m[2U];
+    
+    /* memcpy is the portable unaligned load and compiles to a move */
+    (void)memcpy(a, acc, sizeof(a));
+    (void)memcpy(m, mask, sizeof(m));
+    
+    a[0] ^= m[0];
+    a[1] ^= m[1];
+    
+    (void)memcpy(acc, a, sizeof(a));
+#elif defined(LORA_BLOCK_WORD32)
+    uint32_t a[4U];
+    uint32_t m[4U];
+    
+    (void)memcpy(a, acc, sizeof(a));
+    (void)memcpy(m, mask, sizeof(m));
+    
+    a[0] ^= m[0];
+    a[1] ^= m[1];
+    a[2] ^= m[2];
+    a[3] ^= m[3];
+    
+    (void)memcpy(acc, a, sizeof(a));
+#else
+    uint8_t i;
+    
+    for(i=0U; i < 16U; i++){
+        
+        acc[i] ^= mask[i];
+    }
+#endif
+}
+
+/**
+ * Left shift (by one bit) a 128 bit big-endian vector
+ *
+ * @param[in/out] v vector to shift
+ *
+ * */
+static inline void LoraBlock_leftShift128(uint8_t *v)
+{
+#if defined(LORA_BLOCK_SSE2)
+    __m128i x = _mm_loadu_si128((const __m128i *)v);
+    
+    /* each byte takes the top bit of the byte that follows it in memory */
+    __m128i carry = _mm_and_si128(_mm_srli_epi16(_mm_srli_si128(x, 1), 7), _mm_set1_epi8(1));
+    
+    _mm_storeu_si128((__m128i *)v, _mm_or_si128(_mm_add_epi8(x, x), carry));
+#elif defined(LORA_BLOCK_NEON)
+    uint8x16_t x = vld1q_u8(v);
+    
+    /* each byte takes the top bit of the byte that follows it in memory */
+    uint8x16_t carry = vshrq_n_u8(vextq_u8(x, vdupq_n_u8(0U), 1), 7);
+    
+    vst1q_u8(v, vorrq_u8(vshlq_n_u8(x, 1), carry));
+#elif defined(LORA_BLOCK_WORD64)
+    uint64_t hi = 0U;
+    uint64_t lo = 0U;
+    uint8_t i;
+    
+    for(i=0U; i < 8U; i++){
+        
+        hi = (hi << 8) | v[i];
+        lo = (lo << 8) | v[i + 8U];
+    }
+    
+    hi = (hi << 1) | (lo >> 63);
+    lo <<= 1;
+    
+    for(i=8U; i > 0U; i--){
+        
+        v[i - 1U] = (uint8_t)hi;
+        v[i + 7U] = (uint8_t)lo;
+        hi >>= 8;
+        lo >>= 8;
+    }
+#elif defined(LORA_BLOCK_WORD32)
+    uint32_t w[4U];
+    uint8_t i;
+    
+    for(i=0U; i < 4U; i++){
+        
+        w[i] = ((uint32_t)v[(i << 2)] << 24) | ((uint32_t)v[(i << 2) + 1U] << 16) | ((uint32_t)v[(i << 2) + 2U] << 8) | (uint32_t)v[(i << 2) + 3U];
+    }
+    
+    w[0] = (w[0] << 1) | (w[1] >> 31);
+    w[1] = (w[1] << 1) | (w[2] >> 31);
+    w[2] = (w[2] << 1) | (w[3] >> 31);
+    w[3] <<= 1;
+    
+    for(i=0U; i < 4U; i++){
+        
+        v[(i << 2)] = (uint8_t)(w[i] >> 24);
+        v[(i << 2) + 1U] = (uint8_t)(w[i] >> 16);
+        v[(i << 2) + 2U] = (uint8_t)(w[i] >> 8);
+        v[(i << 2) + 3U] = (uint8_t)w[i];
+    }
+#else
+    uint8_t carry = 0U;
+    uint8_t t;
+    uint8_t i;
+    
+    for(i=16U; i > 0U; i--){
+        
+        t = v[i - 1U];
+        v[i - 1U] = (uint8_t)(t << 1) | carry;
+        carry = t >> 7;
+    }
+#endif
+}
+
+/** @} */
+#endif
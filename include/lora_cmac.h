@@ -38,6 +38,26 @@ extern "C" {
 /** forward declaration */
 struct lora_aes_ctx;
 
+/** CMAC subkeys (these depend only on the key) */
+struct lora_cmac_subkeys {
+    
+    uint8_t k1[16U];
+    uint8_t k2[16U];
+};
+
+#ifndef LORA_DEVICE
+/** one message for LoraCMAC_batch() */
+struct lora_cmac_batch {
+    
+    const struct lora_aes_ctx *aes_ctx;         /**< expanded key */
+    const struct lora_cmac_subkeys *subkeys;    /**< subkeys derived from `aes_ctx` */
+    const uint8_t *prefix;                      /**< 16 byte block that comes before `msg` (may be NULL) */
+    const uint8_t *msg;                         /**< message */
+    uint8_t len;                                /**< byte length of `msg` */
+    uint8_t mac[16U];                           /**< result */
+};
+#endif
+
 #if defined(LORA_USE_PLATFORM_CMAC)
 
 struct lora_cmac_ctxt;
@@ -47,6 +67,7 @@ struct lora_cmac_ctxt;
 struct lora_cmac_ctx {
 
     const struct lora_aes_ctx *aes_ctx;
+    const struct lora_cmac_subkeys *subkeys;    /**< NULL if subkeys are derived by LoraCMAC_finish */
     uint8_t m[16U];
     uint8_t x[16U];
     uint32_t size;
@@ -55,9 +76,46 @@ struct lora_cmac_ctx {
 #endif
 
 void LoraCMAC_init(struct lora_cmac_ctx *ctx, const struct lora_aes_ctx *aes_ctx);
+
+/**
+ * Derive the CMAC subkeys for a key
+ * 
+ * @param[out] subkeys
+ * @param[in] aes_ctx expanded key
+ * 
+ * */
+void LoraCMAC_initSubkeys(struct lora_cmac_subkeys *subkeys, const struct lora_aes_ctx *aes_ctx);
+
+/**
+ * Initialise CMAC with subkeys from LoraCMAC_initSubkeys()
+ * 
+ * LoraCMAC_finish will not have to derive the subkeys which saves one
+ * block encryption per MAC.
+ * 
+ * @param[out] ctx
+ * @param[in] aes_ctx expanded key
+ * @param[in] subkeys subkeys derived from `aes_ctx` (must remain valid until LoraCMAC_finish)
+ * 
+ * */
+void LoraCMAC_initWithSubkeys(struct lora_cmac_ctx *ctx, const struct lora_aes_ctx *aes_ctx, const struct lora_cmac_subkeys *subkeys);
 void LoraCMAC_update(struct lora_cmac_ctx *ctx, const void *data, uint8_t len);
 void LoraCMAC_finish(const struct lora_cmac_ctx *ctx, void *out, uint8_t outMax);
 
+#ifndef LORA_DEVICE
+/**
+ * Calculate the MAC of several messages together
+ * 
+ * The messages may each have a different key. The block cipher is run
+ * on one block from each message at a time so that engines able to
+ * process several blocks at once are kept busy.
+ * 
+ * @param[in/out] batch array of messages (`mac` is written)
+ * @param[in] n number of messages
+ * 
+ * */
+void LoraCMAC_batch(struct lora_cmac_batch *batch, size_t n);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -28,6 +28,58 @@ extern "C" {
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
+
+#ifndef LORA_EVENT_NUM_TIMERS
+    /** capacity of the timer pool */
+    #define LORA_EVENT_NUM_TIMERS 3U
+#endif
+
+#ifndef LORA_EVENT_QUEUE_SIZE
+    /** capacity of the IO event queue (power of two, at most 128) */
+    #define LORA_EVENT_QUEUE_SIZE 8U
+#endif
+
+#ifndef LORA_EVENT_STATS_HANDLERS
+    /** number of handlers LORA_EVENT_STATS can keep statistics for */
+    #define LORA_EVENT_STATS_HANDLERS 8U
+#endif
+
+#ifndef LORA_EVENT_LATE_TICKS
+    /** a dispatch this late or later is counted as late (the same as the MAC's RX_MARGIN) */
+    #define LORA_EVENT_LATE_TICKS 100U
+#endif
+
+#ifndef LORA_EVENT_GROUP_SIZE
+    /** number of struct lora_event a LORA_EVENT_GROUP can hold */
+    #define LORA_EVENT_GROUP_SIZE 8U
+#endif
+
+/** number of histogram buckets in struct lora_event_stats */
+#define EVENT_STATS_BUCKETS 12U
+
+/* The IO event queue indices are shared with the ISR. C11 atomics are
+ * used where available, AVR uses critical sections instead. */
+#if !defined(LORA_AVR) && !defined(__cplusplus) && defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L) && !defined(__STDC_NO_ATOMICS__)
+    #include <stdatomic.h>
+    #define LORA_EVENT_C11_ATOMICS
+    typedef atomic_uint_least8_t event_queue_index_t;
+#else
+    typedef volatile uint8_t event_queue_index_t;
+#endif
+
+struct lora_event;
+
+#if defined(LORA_EVENT_GROUP)
+    /* Members are linked onto their group from the ISR. */
+    #if defined(LORA_EVENT_C11_ATOMICS)
+        typedef _Atomic(struct lora_event *) event_group_link_t;
+        typedef atomic_bool event_group_flag_t;
+    #else
+        typedef struct lora_event *volatile event_group_link_t;
+        typedef volatile bool event_group_flag_t;
+    #endif
+#endif
 
 /** An event callback
  * 
@@ -38,6 +90,31 @@ extern "C" {
  * */
 typedef void (*event_handler_t)(void *receiver, uint64_t time, uint64_t error);
 
+/** A reference to a scheduled event
+ * 
+ * The low 16 bits select the slot and the high 16 bits hold the 
+ * generation of the slot when the event was scheduled. A slot changes 
+ * generation every time it is released, so a handle to an event that 
+ * has already been serviced or cancelled is detected as stale.
+ * 
+ * */
+typedef uint32_t event_handle_t;
+
+/** handle that never refers to an event */
+#define EVENT_HANDLE_NONE 0U
+
+/** timer priority class
+ * 
+ * When timers of both classes are due, every high priority timer is
+ * serviced before the next normal priority timer.
+ * 
+ * */
+enum event_priority {
+    
+    EVENT_PRIORITY_NORMAL,      /**< application and bulk work */
+    EVENT_PRIORITY_HIGH         /**< radio critical deadlines (e.g. RX window start) */
+};
+
 /** radio IO event source */
 enum on_input_types {
   
@@ -47,34 +124,136 @@ enum on_input_types {
     EVENT_NUM_EVENTS
 };
 
+/** dispatch lateness of one handler 
+ * 
+ * Lateness is the `error` passed to the handler. It is counted in
+ * power of two histogram buckets: bucket 0 is on time, bucket n is 
+ * [2^(n-1), 2^n) ticks late and the last bucket is everything later.
+ * 
+ * */
+struct lora_event_stats {
+    
+    uint32_t count;                             /**< times dispatched */
+    uint32_t late;                              /**< times dispatched LORA_EVENT_LATE_TICKS or more late */
+    uint32_t min;                               /**< least lateness (ticks) */
+    uint32_t max;                               /**< greatest lateness (ticks, saturates) */
+    uint32_t histogram[EVENT_STATS_BUCKETS];    /**< dispatches per bucket */
+};
+
 /** IO event state */
 struct on_input {
     
     event_handler_t handler;
     void *receiver;             
-    bool state;                 // todo: make atomic or protect
-    uint64_t time;              /**< time event received (us) */        
+    uint16_t gen;               /**< generation (see event_handle_t) */
+};
+
+/** an IO event received from ISR */
+struct on_input_event {
+    
+    uint64_t time;              /**< time event received */
+    uint8_t type;               /**< enum on_input_types */
 };
 
 /** timer event state */
 struct on_timeout {
     
-    struct on_timeout *next;
+    struct on_timeout *next;    /**< next free (or next pending if sorted list) */
         
     event_handler_t handler;
     void *receiver;
     uint64_t time;    
+    uint16_t gen;               /**< generation (see event_handle_t) */
+    uint8_t priority;           /**< enum event_priority */
+    
+#if defined(LORA_EVENT_HEAP)
+    uint32_t seq;               /**< order of scheduling (keeps equal deadlines FIFO) */
+    uint16_t pos;               /**< position in `heap` */
+#endif
 };
 
+#if defined(LORA_EVENT_GROUP)
+/** a scheduler shared by many struct lora_event
+ * 
+ * Members are kept in a binary min-heap ordered by their next deadline,
+ * so EventGroup_tick() only visits members that have something due.
+ * Members that receive an IO event link themselves onto `signalled`
+ * from the ISR and are moved to the front of the heap by the mainloop.
+ * 
+ * */
+struct lora_event_group {
+    
+    struct lora_event *heap[LORA_EVENT_GROUP_SIZE];
+    uint16_t heapLen;
+    
+    /** members with IO events not yet seen by the group (pushed by ISR) */
+    event_group_link_t signalled;
+};
+#endif
+
 struct lora_event {
 
-    #define EVENT_NUM_TIMERS 3U
+    #define EVENT_NUM_TIMERS LORA_EVENT_NUM_TIMERS
 
     struct on_timeout pool[EVENT_NUM_TIMERS];
     struct on_timeout *free;
+    
+#if defined(LORA_EVENT_HEAP)
+    /* binary min-heap of pending timers (earliest at heap[0]) */
+    struct on_timeout *heap[EVENT_NUM_TIMERS];
+    uint16_t heapLen;
+    uint32_t seq;
+#else
+    /* pending timers sorted by deadline */
     struct on_timeout *head;
+#endif
+
+    /* pending high priority timers sorted by deadline (always a list since there are few) */
+    struct on_timeout *urgent;
 
     struct on_input onInput[EVENT_NUM_EVENTS];
+    
+    /* single producer (ISR) single consumer (mainloop) ring of IO events */
+    struct {
+        
+        struct on_input_event buffer[LORA_EVENT_QUEUE_SIZE];
+        event_queue_index_t head;   /**< written by producer */
+        event_queue_index_t tail;   /**< written by consumer */
+        uint32_t dropped;           /**< events lost to a full queue (written by producer) */
+        uint8_t highWater;          /**< most events queued at once (written by producer) */
+        
+    } queue;
+    
+    uint8_t dispatching;            /**< IO event type whose handler is running (EVENT_NUM_EVENTS if none) */
+    
+    uint16_t timersPending;         /**< timers pending now */
+    uint16_t timersHighWater;       /**< most timers pending at once */
+    
+    /** System_time() calls made by the last Event_tick() */
+    uint32_t clockReads;
+    
+#if defined(LORA_EVENT_TIME_DELTA)
+    /** time of last read (extended by System_time32()) */
+    uint64_t now;
+#endif
+
+#if defined(LORA_EVENT_GROUP)
+    struct lora_event_group *group;     /**< NULL if not a member */
+    uint64_t groupKey;                  /**< deadline the group has ordered this member by */
+    uint16_t groupPos;                  /**< position in group heap */
+    
+    struct lora_event *signalNext;      /**< next in group `signalled` list */
+    event_group_flag_t signalled;       /**< true while on group `signalled` list */
+#endif
+
+#if defined(LORA_EVENT_STATS)
+    struct {
+        
+        event_handler_t handler;    /**< NULL if unused */
+        struct lora_event_stats stats;
+        
+    } stats[LORA_EVENT_STATS_HANDLERS];
+#endif
 };
 
 /** Init from mainloop
@@ -85,10 +264,14 @@ struct lora_event {
 void Event_init(struct lora_event *self);
 
 /** Receive an event notification from ISR
+ * 
+ * Events are queued in the order received and passed to the handler 
+ * registered by Event_onInput() the next time Event_tick() runs. An
+ * event received while the queue is full is dropped.
  * 
  * @param[in] self
  * @param[in] type event source 
- * @param[in] time system time (us)
+ * @param[in] time system time (ticks)
  * 
  * */
 void Event_receive(struct lora_event *self, enum on_input_types type, uint64_t time);
@@ -105,18 +288,26 @@ void Event_receive(struct lora_event *self, enum on_input_types type, uint64_t t
 void Event_tick(struct lora_event *self);
 
 /** Schedule an IO event from mainloop
+ * 
+ * Replaces any previous handler for `event`. Events of this type that
+ * are queued but not yet serviced were meant for the previous 
+ * registration and are discarded, so register before starting the 
+ * operation that will raise the event. 
+ * 
+ * The exception is a handler that registers again for its own event
+ * type: it receives the rest of a burst that is already queued.
  * 
  * @param[in] self
  * @param[in] event event source
  * @param[in] receiver callback receiver
  * @param[in] handler callback handler
  * 
- * @return pointer to event state
+ * @return handle
  * 
- * @retval NULL event could not be scheduled
+ * @retval EVENT_HANDLE_NONE event could not be scheduled
  * 
  * */
-void *Event_onInput(struct lora_event *self, enum on_input_types event, void *receiver, event_handler_t handler);
+event_handle_t Event_onInput(struct lora_event *self, enum on_input_types event, void *receiver, event_handler_t handler);
 
 /** Schedule a timer event from mainloop
  * 
@@ -125,20 +316,37 @@ void *Event_onInput(struct lora_event *self, enum on_input_types event, void *re
  * @param[in] receiver callback receiver
  * @param[in] handler callback handler
  * 
- * @return pointer to event state
+ * @return handle
+ * 
+ * @retval EVENT_HANDLE_NONE event could not be scheduled
+ * 
+ * */
+event_handle_t Event_onTimeout(struct lora_event *self, uint64_t timeout, void *receiver, event_handler_t handler);
+
+/** Schedule a timer event with a priority from mainloop
+ * 
+ * @param[in] self
+ * @param[in] timeout absolute system time (ticks) event will occur
+ * @param[in] priority
+ * @param[in] receiver callback receiver
+ * @param[in] handler callback handler
+ * 
+ * @return handle
  * 
- * @retval NULL event could not be scheduled
+ * @retval EVENT_HANDLE_NONE event could not be scheduled
  * 
  * */
-void *Event_onTimeout(struct lora_event *self, uint64_t timeout, void *receiver, event_handler_t handler);
+event_handle_t Event_onTimeoutWithPriority(struct lora_event *self, uint64_t timeout, enum event_priority priority, void *receiver, event_handler_t handler);
 
 /** Cancel an event handler (and clear the reference) from mainloop
+ * 
+ * Stale handles and EVENT_HANDLE_NONE are ignored.
  * 
  * @param[in] self
- * @param[in] event pointer to pointer of event state
+ * @param[in] event pointer to handle (set to EVENT_HANDLE_NONE)
  * 
  * */
-void Event_cancel(struct lora_event *self, void **event); 
+void Event_cancel(struct lora_event *self, event_handle_t *event); 
 
 /** Get interval until next event
  * 
@@ -150,6 +358,163 @@ void Event_cancel(struct lora_event *self, void **event);
  * */
 uint64_t Event_intervalUntilNext(struct lora_event *self);
 
+/** Get the time a normal priority handler can run before a high 
+ * priority timer is due
+ * 
+ * A long running handler can check this and yield (i.e. schedule 
+ * itself to continue later) so that it does not delay a radio critical
+ * deadline.
+ * 
+ * @param[in] self
+ * 
+ * @return ticks
+ * 
+ * @retval 0 a high priority timer is due
+ * @retval UINT64_MAX no high priority timer is pending
+ * 
+ * */
+uint64_t Event_budget(struct lora_event *self);
+
+/** Get the system time of the next deadline 
+ * 
+ * This does not read the clock so it is suitable for programming a 
+ * wakeup timer with interrupts disabled before going to sleep.
+ * 
+ * @param[in] self
+ * 
+ * @return system time (ticks)
+ * 
+ * @retval 0 an IO event is waiting to be serviced
+ * @retval UINT64_MAX nothing is scheduled (wait for an IO event)
+ * 
+ * */
+uint64_t Event_nextDeadline(const struct lora_event *self);
+
+#if defined(LORA_EVENT_GROUP)
+
+/** Init a group from mainloop
+ * 
+ * @param[in] self
+ * 
+ * */
+void EventGroup_init(struct lora_event_group *self);
+
+/** Add an event manager to a group from mainloop
+ * 
+ * Once added, EventGroup_tick() services the member and Event_tick()
+ * should not be called on it directly.
+ * 
+ * @param[in] self
+ * @param[in] event
+ * 
+ * @retval true added
+ * @retval false group is full or event already belongs to a group
+ * 
+ * */
+bool EventGroup_add(struct lora_event_group *self, struct lora_event *event);
+
+/** Remove an event manager from its group from mainloop
+ * 
+ * Do not call Event_receive() for the member (e.g. from an ISR) while
+ * it is being removed.
+ * 
+ * @param[in] self
+ * @param[in] event
+ * 
+ * */
+void EventGroup_remove(struct lora_event_group *self, struct lora_event *event);
+
+/** Service every member that has something due
+ * 
+ * Members are visited in deadline order and only if they have a timer
+ * due or an IO event waiting; the cost does not depend on the number
+ * of members.
+ * 
+ * @param[in] self
+ * 
+ * */
+void EventGroup_tick(struct lora_event_group *self);
+
+/** Get the earliest deadline of all members
+ * 
+ * Like Event_nextDeadline() this does not read the clock.
+ * 
+ * @param[in] self
+ * 
+ * @return system time (ticks)
+ * 
+ * @retval 0 an IO event is waiting to be serviced
+ * @retval UINT64_MAX nothing is scheduled (wait for an IO event)
+ * 
+ * */
+uint64_t EventGroup_nextDeadline(const struct lora_event_group *self);
+
+#endif
+
+#if defined(LORA_EVENT_VIRTUAL_TIME)
+
+/** Set the virtual clock
+ * 
+ * System_time() returns the virtual clock instead of a port clock. 
+ * There is one virtual clock shared by every event manager.
+ * 
+ * @param[in] time system time (ticks)
+ * 
+ * */
+void Event_setTime(uint64_t time);
+
+/** Run events in virtual time
+ * 
+ * The virtual clock jumps straight to each deadline up to `until` and
+ * the events due are serviced. Handlers may call Event_receive() to 
+ * simulate radio interrupts; these are serviced at the current virtual
+ * time. The clock is left at `until`.
+ * 
+ * @param[in] self
+ * @param[in] until system time (ticks)
+ * 
+ * */
+void Event_advance(struct lora_event *self, uint64_t until);
+
+#if defined(LORA_EVENT_GROUP)
+/** Run events of every group member in virtual time
+ * 
+ * @see Event_advance()
+ * 
+ * @param[in] self
+ * @param[in] until system time (ticks)
+ * 
+ * */
+void EventGroup_advance(struct lora_event_group *self, uint64_t until);
+#endif
+
+#endif
+
+#if defined(LORA_EVENT_STATS)
+
+/** Get dispatch lateness statistics for a handler
+ * 
+ * Statistics are kept for the first LORA_EVENT_STATS_HANDLERS handlers
+ * to be dispatched.
+ * 
+ * @param[in] self
+ * @param[in] handler
+ * @param[out] stats
+ * 
+ * @retval true handler has statistics
+ * 
+ * */
+bool Event_getStats(const struct lora_event *self, event_handler_t handler, struct lora_event_stats *stats);
+
+/** Clear all statistics
+ * 
+ * @param[in] self
+ * 
+ * */
+void Event_clearStats(struct lora_event *self);
+
+#endif
+
 #ifdef __cplusplus
 }
 #endif
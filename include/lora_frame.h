@@ -26,6 +26,9 @@
 extern "C" {
 #endif
 
+#include "lora_aes.h"
+#include "lora_cmac.h"
+
 #include <stdint.h>
 #include <stdbool.h>
 #include <stddef.h>
@@ -96,8 +99,71 @@ struct lora_frame {
     bool valid;    
 };
 
+/** expanded keys for data frames
+ * 
+ * Expanding a key is the most expensive part of encoding and decoding
+ * small frames; the keys for a session rarely change so they can be
+ * expanded once and reused for every frame.
+ * 
+ * */
+struct lora_frame_session_keys {
+    
+    struct lora_aes_ctx nwkSKey;    /**< network session key */
+    struct lora_aes_ctx appSKey;    /**< application session key */
+    
+    struct lora_cmac_subkeys nwkSKeySubkeys;    /**< for data MICs */
+};
+
+/** expanded keys for join and data frames */
+struct lora_frame_keys {
+    
+    struct lora_aes_ctx appKey;     /**< application key */
+    
+    struct lora_cmac_subkeys appKeySubkeys;     /**< for join MICs */
+    
+    struct lora_frame_session_keys session;
+};
+
+#ifndef LORA_DEVICE
+/** a frame for Frame_verifyMICs() */
+struct lora_frame_mic {
+    
+    const struct lora_frame_keys *keys;     /**< expanded keys for the device that sent `in` */
+    const void *in;                         /**< frame buffer (not modified) */
+    size_t len;                             /**< byte length of `in` */
+    bool valid;                             /**< true if MIC validated */
+};
+#endif
+
 /* function prototypes ************************************************/
 
+/** expand the keys for a session
+ * 
+ * @param[out] keys
+ * @param[in] appKey    application key (16 byte field)
+ * @param[in] nwkSKey   network session key (16 byte field)
+ * @param[in] appSKey   application session key (16 byte field)
+ * 
+ * */
+void Frame_initKeys(struct lora_frame_keys *keys, const void *appKey, const void *nwkSKey, const void *appSKey);
+
+/** expand the application key only
+ * 
+ * @param[out] keys
+ * @param[in] appKey    application key (16 byte field)
+ * 
+ * */
+void Frame_initAppKey(struct lora_frame_keys *keys, const void *appKey);
+
+/** expand the session keys only
+ * 
+ * @param[out] keys
+ * @param[in] nwkSKey   network session key (16 byte field)
+ * @param[in] appSKey   application session key (16 byte field)
+ * 
+ * */
+void Frame_initSessionKeys(struct lora_frame_session_keys *keys, const void *nwkSKey, const void *appSKey);
+
 /** encode a data frame
  *
  * @param[in] type type of data frame
@@ -114,6 +180,21 @@ struct lora_frame {
  * */
 size_t Frame_putData(enum lora_frame_type type, const void *nwkSKey, const void *appSKey, const struct lora_frame_data *f, void *out, size_t max);
 
+/** encode a data frame using expanded keys
+ *
+ * @param[in] type type of data frame
+ * @param[in] keys  expanded session keys (see Frame_initSessionKeys())
+ * @param[in] f     frame parameter structure
+ * @param[out] out  frame buffer
+ * @param[in] max   maximum byte length of `out`
+ *
+ * @return bytes encoded
+ *
+ * @retval 0 frame could not be encoded
+ *
+ * */
+size_t Frame_putDataWithKeys(enum lora_frame_type type, const struct lora_frame_session_keys *keys, const struct lora_frame_data *f, void *out, size_t max);
+
 /** encode a join request frame
  *
  * @param[in] key
@@ -128,7 +209,24 @@ size_t Frame_putData(enum lora_frame_type type, const void *nwkSKey, const void
  * */
 size_t Frame_putJoinRequest(const void *key, const struct lora_frame_join_request *f, void *out, size_t max);
 
+/** encode a join request frame using expanded keys
+ *
+ * @param[in] keys  expanded keys (only `appKey` is used)
+ * @param[in] f     frame parameter structure
+ * @param[out] out  frame buffer
+ * @param[in] max   maximum byte length of `out`
+ *
+ * @return bytes encoded
+ *
+ * @retval 0 frame could not be encoded
+ *
+ * */
+size_t Frame_putJoinRequestWithKeys(const struct lora_frame_keys *keys, const struct lora_frame_join_request *f, void *out, size_t max);
+
+#if !defined(LORA_AES_NO_DECRYPT)
 /** encode a join accept frame
+ *
+ * @note not available if LORA_AES_NO_DECRYPT is defined
  *
  * @param[in] key
  * @param[in] f     frame parameter structure
@@ -141,8 +239,13 @@ size_t Frame_putJoinRequest(const void *key, const struct lora_frame_join_reques
  *
  * */
 size_t Frame_putJoinAccept(const void *key, const struct lora_frame_join_accept *f, void *out, size_t max);
+#endif
 
 /** decode a frame
+ *
+ * Only the keys the frame needs are expanded: `appKey` for join 
+ * frames, `nwkSKey` and `appSKey` for data frames. A key the frame 
+ * does not need may be NULL; a frame that needs a NULL key is rejected.
  *
  * @param[in] appKey    application key (16 byte field)
  * @param[in] nwkSKey   network session key (16 byte field)
@@ -156,6 +259,48 @@ size_t Frame_putJoinAccept(const void *key, const struct lora_frame_join_accept
  * */
 bool Frame_decode(const void *appKey, const void *nwkSKey, const void *appSKey, void *in, size_t len, struct lora_frame *f);
 
+/** decode a frame using expanded keys
+ *
+ * @param[in] keys      expanded keys (see Frame_initKeys())
+ * @param[in] in        frame buffer (decrypt will be done in-place)
+ * @param[in] len       byte length of `in`
+ * @param[out] f        decoded frame structure
+ *
+ * @return true if frame well formed
+ *
+ * */
+bool Frame_decodeWithKeys(const struct lora_frame_keys *keys, void *in, size_t len, struct lora_frame *f);
+
+/** decode a data frame using expanded session keys
+ *
+ * Join frames are rejected.
+ *
+ * @param[in] keys      expanded session keys (see Frame_initSessionKeys())
+ * @param[in] in        frame buffer (decrypt will be done in-place)
+ * @param[in] len       byte length of `in`
+ * @param[out] f        decoded frame structure
+ *
+ * @return true if frame well formed
+ *
+ * */
+bool Frame_decodeDataWithKeys(const struct lora_frame_session_keys *keys, void *in, size_t len, struct lora_frame *f);
+
+#ifndef LORA_DEVICE
+/** verify the MIC of many frames without decoding them
+ *
+ * This is for filtering duplicate and garbage frames before doing a 
+ * full decode. Each frame may have different keys and the MICs are
+ * calculated together so that the block cipher is kept busy. 
+ * 
+ * Malformed frames are not valid.
+ *
+ * @param[in/out] frames    array of frames (`valid` is written)
+ * @param[in] n             number of frames
+ *
+ * */
+void Frame_verifyMICs(struct lora_frame_mic *frames, size_t n);
+#endif
+
 /** calculate size of the PhyPayload
  *
  * @param[in] dataLen length of data field in bytes
@@ -29,13 +29,66 @@ extern "C" {
 /** ticks per second */
 #define LORA_TICKS_PER_SECOND 100000U
 
+/* Timers each MAC feature can have pending at once. Features that are
+ * never active at the same time share a budget; a feature that adds 
+ * concurrent timers adds its own term to LORA_MAC_NUM_TIMERS. The
+ * build fails if LORA_EVENT_NUM_TIMERS is smaller. */
+#define LORA_MAC_TIMERS_TX 1U           /**< deferred start of TX (or of an NbTrans repetition) */
+#define LORA_MAC_TIMERS_RX 2U           /**< RX1 and RX2 window start (never while TX is pending) */
+#define LORA_MAC_TIMERS_IDLE 1U         /**< next uplink the MAC starts itself; command answers or the uplink queue (pending until TX is scheduled) */
+
+/** timers a MAC needs in its event manager */
+#define LORA_MAC_NUM_TIMERS ((LORA_MAC_TIMERS_RX > (LORA_MAC_TIMERS_TX + LORA_MAC_TIMERS_IDLE)) ? LORA_MAC_TIMERS_RX : (LORA_MAC_TIMERS_TX + LORA_MAC_TIMERS_IDLE))
+
+#if defined(LORA_MAC_QUEUE)
+
+    #ifndef LORA_MAC_QUEUE_SIZE
+        /** bytes of application data the uplink queue can hold */
+        #define LORA_MAC_QUEUE_SIZE 64U
+    #endif
+    
+    #ifndef LORA_MAC_QUEUE_DEPTH
+        /** messages the uplink queue can hold */
+        #define LORA_MAC_QUEUE_DEPTH 8U
+    #endif
+    
+    #if (LORA_MAC_QUEUE_DEPTH < 1U) || (LORA_MAC_QUEUE_DEPTH > 255U)
+        #error "LORA_MAC_QUEUE_DEPTH must be in range 1..255"
+    #endif
+    
+#endif
+
 #include "lora_region.h"
 #include "lora_radio.h"
 #include "lora_event.h"
+#include "lora_frame.h"
 
 #include <stdint.h>
 #include <stdbool.h>
 
+#ifndef LORA_MAC_MAX_CHANNELS
+    /** most channels of any region in this build (size of the channel cache) */
+    #if defined(LORA_REGION_ALL) || defined(LORA_REGION_CN_470_510)
+        #define LORA_MAC_MAX_CHANNELS 96U
+    #elif defined(LORA_REGION_US_902_928) || defined(LORA_REGION_AU_915_928)
+        #define LORA_MAC_MAX_CHANNELS 72U
+    #else
+        #define LORA_MAC_MAX_CHANNELS 16U
+    #endif
+#endif
+
+#ifndef LORA_MAC_ANSWER_SIZE
+    /** bytes of MAC command answers held for the next uplink */
+    #define LORA_MAC_ANSWER_SIZE 32U
+#endif
+
+#if (LORA_MAC_ANSWER_SIZE < 15U) || (LORA_MAC_ANSWER_SIZE > 255U)
+    #error "LORA_MAC_ANSWER_SIZE must be in range 15..255"
+#endif
+
+/** number of duty cycle bands tracked by the MAC */
+#define LORA_MAC_NUM_BANDS 5U
+
 struct lora_mac;
 
 enum lora_mac_response_type {
@@ -56,8 +109,33 @@ union lora_mac_response_arg {
     } rx;    
 };
 
+/** ADR decisions (see MAC_getADRStats()) */
+struct lora_mac_adr_stats {
+    
+    uint16_t ackCounter;        /**< uplinks since the last downlink (ADR_ACK_CNT) */
+    uint16_t ackReq;            /**< uplinks sent with ADRACKReq */
+    uint16_t linkADRAccepted;   /**< LinkADRReq blocks applied */
+    uint16_t linkADRRejected;   /**< LinkADRReq blocks rejected */
+    uint16_t powerReset;        /**< backoff steps that restored the default TX power */
+    uint16_t rateDecreased;     /**< backoff steps that lowered the rate */
+    uint16_t channelsReset;     /**< backoff steps that enabled every channel */
+    uint8_t lastStatus;         /**< status of the last LinkADRAns (power 4U, rate 2U, mask 1U) */
+};
+
 typedef void (*lora_mac_response_fn)(void *receiver, enum lora_mac_response_type type, const union lora_mac_response_arg *arg);
 
+#if defined(LORA_EVENT_STATS)
+/** MAC event handlers (see MAC_getEventStats()) */
+enum lora_mac_handler {
+    
+    LORA_MAC_HANDLER_TX,            /**< start of TX (channel available) */
+    LORA_MAC_HANDLER_TX_COMPLETE,   /**< radio TX complete interrupt */
+    LORA_MAC_HANDLER_RX_START,      /**< opening of an RX window */
+    LORA_MAC_HANDLER_RX_READY,      /**< radio RX ready interrupt */
+    LORA_MAC_HANDLER_RX_TIMEOUT     /**< radio RX timeout interrupt */
+};
+#endif
+
 enum lora_mac_state {
 
     IDLE,
@@ -80,6 +158,7 @@ enum lora_mac_operation {
     LORA_OP_JOINING,                /// MAC is performing a join
     LORA_OP_DATA_UNCONFIRMED,       /// MAC is sending unconfirmed data
     LORA_OP_DATA_CONFIRMED,         /// MAC is sending confirmed data    
+    LORA_OP_ANSWER,                 /// MAC is sending MAC command answers on port 0
 };
 
 struct lora_mac {
@@ -90,6 +169,10 @@ struct lora_mac {
     struct {
         
         bool joined : 1U;           /**< MAC has been joined */        
+#if !defined(LORA_MAC_NO_KEY_CACHE)
+        bool keysReady : 1U;        /**< `keys` are expanded from the current System keys */
+#endif
+        bool adr : 1U;              /**< ADR is enabled (see MAC_setADR()) */
     
     } status;
     
@@ -100,14 +183,39 @@ struct lora_mac {
     uint8_t bufferLen;
     
     /** tracks system time for when each band will become available */
-    uint64_t bands[5U];
+    uint64_t bands[LORA_MAC_NUM_BANDS];
+    
+    /** cached channel settings (see MAC_reloadChannels()) */
+    struct {
+        
+        /** minRate (high nibble) and maxRate (low nibble) of each channel */
+        uint8_t rates[LORA_MAC_MAX_CHANNELS];
+        
+        /** unmasked channels in each band */
+        uint8_t band[LORA_MAC_NUM_BANDS][(LORA_MAC_MAX_CHANNELS + 7U) / 8U];
+        
+        /** unmasked channels that support `rate` */
+        uint8_t enabled[(LORA_MAC_MAX_CHANNELS + 7U) / 8U];
+        
+        uint8_t rate;               /**< rate `enabled` is for */
+        
+        bool valid : 1U;            /**< `rates` and `band` are up to date */
+        bool enabledValid : 1U;     /**< `enabled` is up to date */
+        
+    } channels;
     
     uint16_t devNonce;
     
+#if !defined(LORA_MAC_NO_KEY_CACHE)
+    /** expanded session keys (see MAC_reloadKeys()) */
+    struct lora_frame_session_keys keys;
+#endif
+    
     struct {
         
         uint8_t chIndex;
         uint32_t freq;
+        uint8_t repeats;        /**< transmissions of the frame in `buffer` still to do (NbTrans) */
         
     } tx;
     
@@ -117,14 +225,47 @@ struct lora_mac {
     struct lora_event events;           /**< event manager */
     enum lora_region region;   /**< region MAC is oeprating in */
     
-    void *rx2Ready;     /**< timer callback for RX2 window start */    
-    void *rxComplete;   /**< RX complete IO event */
-    void *rxTimeout;    /**< RX timeout IO event */
+    event_handle_t rx2Ready;    /**< timer callback for RX2 window start */    
+    event_handle_t rxComplete;  /**< RX complete IO event */
+    event_handle_t rxTimeout;   /**< RX timeout IO event */
     void *radioTimer;
     
     lora_mac_response_fn responseHandler;
     void *responseReceiver;
     
+#if defined(LORA_MAC_QUEUE)
+    /** uplink queue (see MAC_queue()) */
+    struct {
+        
+        struct {
+            
+            uint8_t port;
+            uint8_t len;
+            bool confirmed;
+            
+        } msg[LORA_MAC_QUEUE_DEPTH];
+        
+        /** data of each message in order */
+        uint8_t data[LORA_MAC_QUEUE_SIZE];
+        
+        uint8_t count;          /**< messages queued */
+        uint16_t used;          /**< bytes of `data` in use */
+        
+    } queue;
+#endif
+    
+    /** MAC command answers for the next uplink */
+    uint8_t answers[LORA_MAC_ANSWER_SIZE];
+    uint8_t answersLen;
+    
+    /** timer for the next uplink the MAC starts itself */
+    event_handle_t nextUp;
+    
+    /** uplinks since the last downlink (ADR_ACK_CNT) */
+    uint16_t adrAckCounter;
+    
+    struct lora_mac_adr_stats adrStats;
+    
     void *system;       /**< passed as receiver in every System_* call */
 };
 
@@ -152,7 +293,7 @@ void MAC_init(struct lora_mac *self, void *system, enum lora_region region, stru
  * the txCompleteHandler callback.
  * 
  * - Duty cycle limits on available channels
- * - Retransmission depending on MAC setting
+ * - Unconfirmed frames are sent NbTrans times unless there is a downlink
  * 
  * @param[in] self
  * @param[in] confirmed true if this send should be confirmed
@@ -170,6 +311,47 @@ bool MAC_join(struct lora_mac *self);
 bool MAC_setRate(struct lora_mac *self, uint8_t rate);
 bool MAC_setPower(struct lora_mac *self, uint8_t power);
 
+/** Enable or disable Adaptive Data Rate
+ * 
+ * With ADR the network sets the rate, TX power, NbTrans and channel
+ * mask of the device with LinkADRReq. If the network does not answer
+ * for ADR_ACK_LIMIT uplinks the MAC sets ADRACKReq, and every 
+ * ADR_ACK_DELAY uplinks after that it first restores the default TX
+ * power, then lowers the rate one step at a time, and finally enables
+ * every channel.
+ * 
+ * LinkADRReq is applied whether or not ADR is enabled. ADR is disabled
+ * after MAC_init().
+ * 
+ * @param[in] self
+ * @param[in] value true to enable
+ * 
+ * */
+void MAC_setADR(struct lora_mac *self, bool value);
+
+/** Is ADR enabled?
+ * 
+ * @param[in] self
+ * @return true if ADR is enabled
+ * 
+ * */
+bool MAC_getADR(const struct lora_mac *self);
+
+/** Get ADR statistics
+ * 
+ * @param[in] self
+ * @param[out] stats
+ * 
+ * */
+void MAC_getADRStats(const struct lora_mac *self, struct lora_mac_adr_stats *stats);
+
+/** Clear ADR statistics (ADR_ACK_CNT is not changed)
+ * 
+ * @param[in] self
+ * 
+ * */
+void MAC_clearADRStats(struct lora_mac *self);
+
 void MAC_radioEvent(void *receiver, enum lora_radio_event event, uint64_t time);
 
 /** Get transmit time in ticks
@@ -204,6 +386,120 @@ void MAC_tick(struct lora_mac *self);
  * */
 uint64_t MAC_ticksUntilNextEvent(struct lora_mac *self);
 
+/** Get the system time the MAC next needs MAC_tick() to be called
+ * 
+ * The clock is not read, so a port can call this with interrupts 
+ * disabled, program a wakeup timer for the deadline, and sleep. A radio
+ * interrupt will also need MAC_tick() so it must wake the port too.
+ * 
+ * @param[in] self
+ * @return system time (ticks)
+ * 
+ * @retval 0 an event is waiting (do not sleep)
+ * @retval UINT64_MAX there are no future events (sleep until an interrupt)
+ * 
+ * */
+uint64_t MAC_nextDeadline(const struct lora_mac *self);
+
+/** Get the time the application can spend before the MAC must start TX
+ * or open an RX window
+ * 
+ * TX start and RX window start are high priority events (see
+ * Event_budget()); a long running application task should yield when
+ * this is small.
+ * 
+ * @param[in] self
+ * @return ticks
+ * 
+ * @retval 0 the MAC is waiting for MAC_tick()
+ * @retval UINT64_MAX the MAC has no radio deadline pending
+ * 
+ * */
+uint64_t MAC_budget(struct lora_mac *self);
+
+#if defined(LORA_MAC_QUEUE)
+/** Queue a message to send upstream
+ * 
+ * Unlike MAC_send() this may be called while the MAC is busy. The MAC
+ * sends queued messages in order as soon as it is idle and a channel is
+ * available.
+ * 
+ * Messages queued for the same port with the same `confirmed` setting
+ * are sent together: consecutive messages are concatenated into one
+ * frame for as long as they fit in the maximum payload of the current
+ * rate. The application must be able to split the payload again (e.g.
+ * fixed size readings).
+ * 
+ * The response handler is called once for each frame sent.
+ * 
+ * @param[in] self
+ * @param[in] confirmed true if this message should be confirmed
+ * @param[in] port 
+ * @param[in] data pointer to message (copied into the queue)
+ * @param[in] len byte length of data
+ * 
+ * @retval true message queued
+ * @retval false queue is full or port is invalid
+ * 
+ * */
+bool MAC_queue(struct lora_mac *self, bool confirmed, uint8_t port, const void *data, uint8_t len);
+
+/** Get the number of messages waiting in the uplink queue
+ * 
+ * @param[in] self
+ * 
+ * @return messages
+ * 
+ * */
+uint8_t MAC_queueLength(const struct lora_mac *self);
+
+/** Discard every message waiting in the uplink queue
+ * 
+ * @param[in] self
+ * 
+ * */
+void MAC_clearQueue(struct lora_mac *self);
+#endif
+
+#if defined(LORA_EVENT_GROUP)
+/** Schedule this MAC from a shared event group
+ * 
+ * EventGroup_tick() then services this MAC (and every other MAC in the
+ * group) instead of MAC_tick(). Call after MAC_init().
+ * 
+ * @param[in] self
+ * @param[in] group
+ * 
+ * @retval true attached
+ * @retval false group is full or MAC is already attached
+ * 
+ * */
+bool MAC_attach(struct lora_mac *self, struct lora_event_group *group);
+
+/** Stop scheduling this MAC from a shared event group
+ * 
+ * @param[in] self
+ * 
+ * */
+void MAC_detach(struct lora_mac *self);
+#endif
+
+#if defined(LORA_EVENT_STATS)
+/** Get dispatch lateness statistics for a MAC event handler
+ * 
+ * `late` of LORA_MAC_HANDLER_RX_START counts RX windows that were
+ * opened LORA_EVENT_LATE_TICKS or more after they were due.
+ * 
+ * @param[in] self
+ * @param[in] handler
+ * @param[out] stats
+ * 
+ * @retval true handler has been dispatched since Event_clearStats()
+ * 
+ * */
+bool MAC_getEventStats(const struct lora_mac *self, enum lora_mac_handler handler, struct lora_event_stats *stats);
+#endif
+
 /** Is MAC joined?
  * 
  * @param[in] self
@@ -219,6 +515,33 @@ bool MAC_isJoined(struct lora_mac *self);
  * */
 void MAC_restoreDefaults(struct lora_mac *self);
 
+/** Discard the expanded session keys
+ * 
+ * The MAC expands NwkSKey and AppSKey once and reuses them for
+ * every frame (AppKey is only needed to join and is expanded on demand). 
+ * Call this after changing the session keys by some means other than a 
+ * join so they are read again from System_get*.
+ * 
+ * Does nothing if LORA_MAC_NO_KEY_CACHE is defined.
+ * 
+ * @param[in] self
+ * 
+ * */
+void MAC_reloadKeys(struct lora_mac *self);
+
+/** Discard the cached channel settings
+ * 
+ * The MAC caches which channels are enabled, their rates, and their 
+ * bands so that channel selection does not need System_getChannel()
+ * and System_channelIsMasked() for every channel. Call this after
+ * changing channels or channel masks by some means other than the MAC
+ * so they are read again.
+ * 
+ * @param[in] self
+ * 
+ * */
+void MAC_reloadChannels(struct lora_mac *self);
+
 /** Get number of ticks until next channel is ready
  * 
  * @param[in] self
@@ -58,7 +58,7 @@ struct lora_link_adr_req {
     uint8_t txPower;
     uint16_t channelMask;
     uint8_t channelMaskControl;
-    uint8_t redundancy;        
+    uint8_t nbTrans;
 };
 
 struct lora_link_adr_ans {
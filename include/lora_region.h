@@ -119,6 +119,32 @@ uint8_t Region_getADRAckDither(enum lora_region region);
 uint8_t Region_getTXRate(enum lora_region region);
 uint8_t Region_getTXPower(enum lora_region region);
 
+/** highest TXPower index defined for a region */
+uint8_t Region_getMaxTXPower(enum lora_region region);
+
+/** what a LinkADRReq does to the channels ChMask does not cover */
+enum lora_region_mask_fill {
+    
+    LORA_MASK_FILL_NONE,    /**< unchanged */
+    LORA_MASK_FILL_ON,      /**< enabled */
+    LORA_MASK_FILL_OFF      /**< disabled */
+};
+
+/** Interpret the ChMaskCntl field of a LinkADRReq for a given region
+ * 
+ * ChMask applies to the sixteen channels from `first`; the other
+ * channels are set according to `fill`.
+ * 
+ * @param[in] region
+ * @param[in] cntl ChMaskCntl
+ * @param[out] first first channel of ChMask
+ * @param[out] fill
+ * 
+ * @retval true ChMaskCntl is defined for this region
+ * 
+ * */
+bool Region_getChannelMask(enum lora_region region, uint8_t cntl, uint8_t *first, enum lora_region_mask_fill *fill);
+
 /** derive the rate integer from bandwidth and spreading factor for a given region
  *
  * @note useful for semtech gateway protocol
@@ -31,12 +31,27 @@ extern "C" {
 #include <stddef.h>
 
 /** Get system time (ticks)
+ * 
+ * @note provided by lora_event.c if LORA_EVENT_VIRTUAL_TIME is defined
  * 
  * @return system time (ticks)
  * 
  * */
 uint64_t System_time(void);
 
+#if defined(LORA_EVENT_TIME_DELTA) || defined(LORA_EVENT_VIRTUAL_TIME)
+/** Get the low 32 bits of system time (ticks)
+ * 
+ * Only needed if LORA_EVENT_TIME_DELTA is defined. This must be much
+ * cheaper to read than System_time() (e.g. a free running hardware
+ * counter) and count at the same rate.
+ * 
+ * @return low 32 bits of system time (ticks)
+ * 
+ * */
+uint32_t System_time32(void);
+#endif
+
 /** Set the value of receiver to value in an atomic operation
  * 
  * @param[out] receiver
@@ -19,16 +19,18 @@
  *
  * */
 
-#if !defined(LORA_USE_PLATFORM_AES)
-
 /* includes ***********************************************************/
 
 #include "lora_aes.h"
+#include "lora_block.h"
 #include "lora_debug.h"
 #include <string.h>
+#include <stdbool.h>
 
 /* defines ************************************************************/
 
+#if !defined(LORA_USE_PLATFORM_AES)
+
 #define R1 0U   
 #define R2 1U
 #define R3 2U
@@ -41,6 +43,85 @@
 
 #define GALOIS_MUL2(B) ((((B) & 0x80U) == 0x80U) ? (uint8_t)(((B) << 1U) ^ 0x1bU) : (uint8_t)((B) << 1U))
 
+#if defined(LORA_AES_TTABLE)
+
+    #if defined(LORA_AVR)
+        #error "LORA_AES_TTABLE is intended for 32/64-bit hosts"
+    #endif
+
+    /* load/store a big-endian 32 bit word (any alignment) */
+    #define GETU32(P) ( ((uint32_t)(P)[0] << 24) | ((uint32_t)(P)[1] << 16) | ((uint32_t)(P)[2] << 8) | (uint32_t)(P)[3] )
+    #define PUTU32(P, W) do{ (P)[0] = (uint8_t)((W) >> 24); (P)[1] = (uint8_t)((W) >> 16); (P)[2] = (uint8_t)((W) >> 8); (P)[3] = (uint8_t)(W); }while(0)
+
+    /* T-table lookup of byte N of word W (N == 0 is most significant) */
+    #define TE0(W) te0[((W) >> 24)         ]
+    #define TE1(W) te1[((W) >> 16) & 0xffU ]
+    #define TE2(W) te2[((W) >> 8 ) & 0xffU ]
+    #define TE3(W) te3[((W)      ) & 0xffU ]
+
+    /* SubBytes on byte N of word W, result shifted back into position N */
+    #define SB0(W) ((uint32_t)SBOX( (W) >> 24         ) << 24)
+    #define SB1(W) ((uint32_t)SBOX( ((W) >> 16) & 0xffU ) << 16)
+    #define SB2(W) ((uint32_t)SBOX( ((W) >> 8 ) & 0xffU ) << 8)
+    #define SB3(W) ((uint32_t)SBOX( (W)         & 0xffU ))
+
+#endif
+
+#if defined(LORA_AES_BITSLICE)
+
+    #if defined(LORA_AES_TTABLE) || defined(LORA_AES_HW)
+        #error "LORA_AES_BITSLICE cannot be combined with LORA_AES_TTABLE or LORA_AES_HW"
+    #endif
+
+    #if !defined(LORA_AES_NO_DECRYPT)
+        #error "LORA_AES_BITSLICE has no inverse cipher (define LORA_AES_NO_DECRYPT)"
+    #endif
+
+    /* four blocks in 64-bit words on 64-bit hosts, otherwise (or when 
+     * LORA_AES_BITSLICE_32 is defined) two blocks in 32-bit words */
+    #if !defined(LORA_AES_BITSLICE_32) && defined(UINTPTR_MAX) && (UINTPTR_MAX > 0xffffffffU)
+        #define AES_BITSLICE_64
+        typedef uint64_t bitslice_word_t;
+    #else
+        typedef uint32_t bitslice_word_t;
+    #endif
+
+    /* exchange the bits selected by CL in X with those selected by CH in Y */
+    #define SWAPN(CL, CH, S, X, Y) do{ \
+        bitslice_word_t a_ = (X); \
+        bitslice_word_t b_ = (Y); \
+        (X) = (a_ & (CL)) | ((b_ & (CL)) << (S)); \
+        (Y) = ((a_ & (CH)) >> (S)) | (b_ & (CH)); \
+    }while(0)
+
+    /* load/store a little-endian 32 bit word (any alignment) */
+    #define GETU32LE(P) ( (uint32_t)(P)[0] | ((uint32_t)(P)[1] << 8) | ((uint32_t)(P)[2] << 16) | ((uint32_t)(P)[3] << 24) )
+    #define PUTU32LE(P, W) do{ (P)[0] = (uint8_t)(W); (P)[1] = (uint8_t)((W) >> 8); (P)[2] = (uint8_t)((W) >> 16); (P)[3] = (uint8_t)((W) >> 24); }while(0)
+
+    #if defined(AES_BITSLICE_64)
+    
+        /* bit 0 of every nibble; lane N of the state is this shifted left by N */
+        #define LANE0 0x1111111111111111U
+
+        /* each state word is four rows of four columns of four lanes */
+        #define ROW_BITS 16U
+        #define ROW_MASK 0xffffU
+        #define ROW_ONES 0x0001000100010001U
+        
+    #else
+
+        /* each state word is four rows of four columns of two lanes */
+        #define ROW_BITS 8U
+        #define ROW_MASK 0xffU
+        #define ROW_ONES 0x01010101U
+
+    #endif
+
+    #define COL_BITS (ROW_BITS >> 2)
+    #define WORD_BITS (ROW_BITS << 2)
+
+#endif
+
 #if defined(LORA_AVR)
 
     #include <avr/pgmspace.h>
@@ -59,6 +140,57 @@
     
 #endif
 
+#if defined(LORA_AES_HW)
+
+    #if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+
+        #define AES_HW_X86
+        #define AES_HW_TARGET __attribute__((target("aes,sse2")))
+
+        #include <emmintrin.h>
+        #include <wmmintrin.h>
+
+    #elif defined(__GNUC__) && defined(__aarch64__) && defined(__linux__)
+
+        #define AES_HW_ARM
+
+        #if defined(__clang__)
+            #define AES_HW_TARGET __attribute__((target("aes")))
+        #else
+            #define AES_HW_TARGET __attribute__((target("+crypto")))
+        #endif
+
+        #include <arm_neon.h>
+        #include <sys/auxv.h>
+        #include <asm/hwcap.h>
+
+    #endif
+
+    /* an AES implementation selected at run-time */
+    struct aes_engine {
+
+        void (*init)(struct lora_aes_ctx *ctx, const uint8_t *key);
+        void (*encrypt)(const struct lora_aes_ctx *ctx, uint8_t *s);
+        void (*encryptN)(const struct lora_aes_ctx *const *ctx, uint8_t *s, uint8_t n);
+    };
+
+#endif
+
+/* number of independent blocks the engine encrypts together
+ * 
+ * The table engines are bound by lookups so only the pipelined 
+ * instructions and the bitsliced engine gain from interleaving blocks.
+ * */
+#if defined(LORA_AES_HW)
+    #define AES_LANES 4U
+#elif defined(AES_BITSLICE_64)
+    #define AES_LANES 4U
+#elif defined(LORA_AES_BITSLICE)
+    #define AES_LANES 2U
+#else
+    #define AES_LANES 1U
+#endif
+
 enum aes_key_size {
 
     AES_KEY_128 = 16U,
@@ -68,6 +200,8 @@ enum aes_key_size {
 
 /* static variables ***************************************************/
 
+#if !defined(LORA_AES_BITSLICE)
+
 static const uint8_t sbox[] PROGMEM = {
     0x63U, 0x7cU, 0x77U, 0x7bU, 0xf2U, 0x6bU, 0x6fU, 0xc5U,
     0x30U, 0x01U, 0x67U, 0x2bU, 0xfeU, 0xd7U, 0xabU, 0x76U,
@@ -103,136 +237,413 @@ static const uint8_t sbox[] PROGMEM = {
     0x41U, 0x99U, 0x2dU, 0x0fU, 0xb0U, 0x54U, 0xbbU, 0x16U
 };
 
-/* functions **********************************************************/
+#endif
 
-void LoraAES_init(struct lora_aes_ctx *ctx, const uint8_t *key)
-{
-    uint8_t p;
-    uint8_t j;
-    uint8_t b = 0U;
-    uint8_t swap;
-    uint8_t *k;
-    uint8_t ks;
-    uint8_t i = 1U;
-    
-    static const uint8_t rcon[] PROGMEM = {
-        0x8dU, 0x01U, 0x02U, 0x04U, 0x08U, 0x10U, 0x20U, 0x40U, 0x80U, 0x1bU, 0x36U
-    };
+#if defined(LORA_AES_TTABLE)
 
-    LORA_PEDANTIC(ctx != NULL)
-    LORA_PEDANTIC(key != NULL)
+/* Each T-table combines SubBytes and MixColumns for one row of the
+ * state; te1..te3 are te0 rotated right by 8, 16 and 24 bits */
 
-    ctx->r = 10U;
-    b = 176U;
+static const uint32_t te0[] = {
+    0xc66363a5U, 0xf87c7c84U, 0xee777799U, 0xf67b7b8dU, 0xfff2f20dU, 0xd66b6bbdU,
+    0xde6f6fb1U, 0x91c5c554U, 0x60303050U, 0x02010103U, 0xce6767a9U, 0x562b2b7dU,
+    0xe7fefe19U, 0xb5d7d762U, 0x4dababe6U, 0xec76769aU, 0x8fcaca45U, 0x1f82829dU,
+    0x89c9c940U, 0xfa7d7d87U, 0xeffafa15U, 0xb25959ebU, 0x8e4747c9U, 0xfbf0f00bU,
+    0x41adadecU, 0xb3d4d467U, 0x5fa2a2fdU, 0x45afafeaU, 0x239c9cbfU, 0x53a4a4f7U,
+    0xe4727296U, 0x9bc0c05bU, 0x75b7b7c2U, 0xe1fdfd1cU, 0x3d9393aeU, 0x4c26266aU,
+    0x6c36365aU, 0x7e3f3f41U, 0xf5f7f702U, 0x83cccc4fU, 0x6834345cU, 0x51a5a5f4U,
+    0xd1e5e534U, 0xf9f1f108U, 0xe2717193U, 0xabd8d873U, 0x62313153U, 0x2a15153fU,
+    0x0804040cU, 0x95c7c752U, 0x46232365U, 0x9dc3c35eU, 0x30181828U, 0x379696a1U,
+    0x0a05050fU, 0x2f9a9ab5U, 0x0e070709U, 0x24121236U, 0x1b80809bU, 0xdfe2e23dU,
+    0xcdebeb26U, 0x4e272769U, 0x7fb2b2cdU, 0xea75759fU, 0x1209091bU, 0x1d83839eU,
+    0x582c2c74U, 0x341a1a2eU, 0x361b1b2dU, 0xdc6e6eb2U, 0xb45a5aeeU, 0x5ba0a0fbU,
+    0xa45252f6U, 0x763b3b4dU, 0xb7d6d661U, 0x7db3b3ceU, 0x5229297bU, 0xdde3e33eU,
+    0x5e2f2f71U, 0x13848497U, 0xa65353f5U, 0xb9d1d168U, 0x00000000U, 0xc1eded2cU,
+    0x40202060U, 0xe3fcfc1fU, 0x79b1b1c8U, 0xb65b5bedU, 0xd46a6abeU, 0x8dcbcb46U,
+    0x67bebed9U, 0x7239394bU, 0x944a4adeU, 0x984c4cd4U, 0xb05858e8U, 0x85cfcf4aU,
+    0xbbd0d06bU, 0xc5efef2aU, 0x4faaaae5U, 0xedfbfb16U, 0x864343c5U, 0x9a4d4dd7U,
+    0x66333355U, 0x11858594U, 0x8a4545cfU, 0xe9f9f910U, 0x04020206U, 0xfe7f7f81U,
+    0xa05050f0U, 0x783c3c44U, 0x259f9fbaU, 0x4ba8a8e3U, 0xa25151f3U, 0x5da3a3feU,
+    0x804040c0U, 0x058f8f8aU, 0x3f9292adU, 0x219d9dbcU, 0x70383848U, 0xf1f5f504U,
+    0x63bcbcdfU, 0x77b6b6c1U, 0xafdada75U, 0x42212163U, 0x20101030U, 0xe5ffff1aU,
+    0xfdf3f30eU, 0xbfd2d26dU, 0x81cdcd4cU, 0x180c0c14U, 0x26131335U, 0xc3ecec2fU,
+    0xbe5f5fe1U, 0x359797a2U, 0x884444ccU, 0x2e171739U, 0x93c4c457U, 0x55a7a7f2U,
+    0xfc7e7e82U, 0x7a3d3d47U, 0xc86464acU, 0xba5d5de7U, 0x3219192bU, 0xe6737395U,
+    0xc06060a0U, 0x19818198U, 0x9e4f4fd1U, 0xa3dcdc7fU, 0x44222266U, 0x542a2a7eU,
+    0x3b9090abU, 0x0b888883U, 0x8c4646caU, 0xc7eeee29U, 0x6bb8b8d3U, 0x2814143cU,
+    0xa7dede79U, 0xbc5e5ee2U, 0x160b0b1dU, 0xaddbdb76U, 0xdbe0e03bU, 0x64323256U,
+    0x743a3a4eU, 0x140a0a1eU, 0x924949dbU, 0x0c06060aU, 0x4824246cU, 0xb85c5ce4U,
+    0x9fc2c25dU, 0xbdd3d36eU, 0x43acacefU, 0xc46262a6U, 0x399191a8U, 0x319595a4U,
+    0xd3e4e437U, 0xf279798bU, 0xd5e7e732U, 0x8bc8c843U, 0x6e373759U, 0xda6d6db7U,
+    0x018d8d8cU, 0xb1d5d564U, 0x9c4e4ed2U, 0x49a9a9e0U, 0xd86c6cb4U, 0xac5656faU,
+    0xf3f4f407U, 0xcfeaea25U, 0xca6565afU, 0xf47a7a8eU, 0x47aeaee9U, 0x10080818U,
+    0x6fbabad5U, 0xf0787888U, 0x4a25256fU, 0x5c2e2e72U, 0x381c1c24U, 0x57a6a6f1U,
+    0x73b4b4c7U, 0x97c6c651U, 0xcbe8e823U, 0xa1dddd7cU, 0xe874749cU, 0x3e1f1f21U,
+    0x964b4bddU, 0x61bdbddcU, 0x0d8b8b86U, 0x0f8a8a85U, 0xe0707090U, 0x7c3e3e42U,
+    0x71b5b5c4U, 0xcc6666aaU, 0x904848d8U, 0x06030305U, 0xf7f6f601U, 0x1c0e0e12U,
+    0xc26161a3U, 0x6a35355fU, 0xae5757f9U, 0x69b9b9d0U, 0x17868691U, 0x99c1c158U,
+    0x3a1d1d27U, 0x279e9eb9U, 0xd9e1e138U, 0xebf8f813U, 0x2b9898b3U, 0x22111133U,
+    0xd26969bbU, 0xa9d9d970U, 0x078e8e89U, 0x339494a7U, 0x2d9b9bb6U, 0x3c1e1e22U,
+    0x15878792U, 0xc9e9e920U, 0x87cece49U, 0xaa5555ffU, 0x50282878U, 0xa5dfdf7aU,
+    0x038c8c8fU, 0x59a1a1f8U, 0x09898980U, 0x1a0d0d17U, 0x65bfbfdaU, 0xd7e6e631U,
+    0x844242c6U, 0xd06868b8U, 0x824141c3U, 0x299999b0U, 0x5a2d2d77U, 0x1e0f0f11U,
+    0x7bb0b0cbU, 0xa85454fcU, 0x6dbbbbd6U, 0x2c16163aU
+};
 
-    (void)memcpy(ctx->k, key, 16U);
-    k = ctx->k;    
-    ks = 16U;
-    p = ks;
+static const uint32_t te1[] = {
+    0xa5c66363U, 0x84f87c7cU, 0x99ee7777U, 0x8df67b7bU, 0x0dfff2f2U, 0xbdd66b6bU,
+    0xb1de6f6fU, 0x5491c5c5U, 0x50603030U, 0x03020101U, 0xa9ce6767U, 0x7d562b2bU,
+    0x19e7fefeU, 0x62b5d7d7U, 0xe64dababU, 0x9aec7676U, 0x458fcacaU, 0x9d1f8282U,
+    0x4089c9c9U, 0x87fa7d7dU, 0x15effafaU, 0xebb25959U, 0xc98e4747U, 0x0bfbf0f0U,
+    0xec41adadU, 0x67b3d4d4U, 0xfd5fa2a2U, 0xea45afafU, 0xbf239c9cU, 0xf753a4a4U,
+    0x96e47272U, 0x5b9bc0c0U, 0xc275b7b7U, 0x1ce1fdfdU, 0xae3d9393U, 0x6a4c2626U,
+    0x5a6c3636U, 0x417e3f3fU, 0x02f5f7f7U, 0x4f83ccccU, 0x5c683434U, 0xf451a5a5U,
+    0x34d1e5e5U, 0x08f9f1f1U, 0x93e27171U, 0x73abd8d8U, 0x53623131U, 0x3f2a1515U,
+    0x0c080404U, 0x5295c7c7U, 0x65462323U, 0x5e9dc3c3U, 0x28301818U, 0xa1379696U,
+    0x0f0a0505U, 0xb52f9a9aU, 0x090e0707U, 0x36241212U, 0x9b1b8080U, 0x3ddfe2e2U,
+    0x26cdebebU, 0x694e2727U, 0xcd7fb2b2U, 0x9fea7575U, 0x1b120909U, 0x9e1d8383U,
+    0x74582c2cU, 0x2e341a1aU, 0x2d361b1bU, 0xb2dc6e6eU, 0xeeb45a5aU, 0xfb5ba0a0U,
+    0xf6a45252U, 0x4d763b3bU, 0x61b7d6d6U, 0xce7db3b3U, 0x7b522929U, 0x3edde3e3U,
+    0x715e2f2fU, 0x97138484U, 0xf5a65353U, 0x68b9d1d1U, 0x00000000U, 0x2cc1ededU,
+    0x60402020U, 0x1fe3fcfcU, 0xc879b1b1U, 0xedb65b5bU, 0xbed46a6aU, 0x468dcbcbU,
+    0xd967bebeU, 0x4b723939U, 0xde944a4aU, 0xd4984c4cU, 0xe8b05858U, 0x4a85cfcfU,
+    0x6bbbd0d0U, 0x2ac5efefU, 0xe54faaaaU, 0x16edfbfbU, 0xc5864343U, 0xd79a4d4dU,
+    0x55663333U, 0x94118585U, 0xcf8a4545U, 0x10e9f9f9U, 0x06040202U, 0x81fe7f7fU,
+    0xf0a05050U, 0x44783c3cU, 0xba259f9fU, 0xe34ba8a8U, 0xf3a25151U, 0xfe5da3a3U,
+    0xc0804040U, 0x8a058f8fU, 0xad3f9292U, 0xbc219d9dU, 0x48703838U, 0x04f1f5f5U,
+    0xdf63bcbcU, 0xc177b6b6U, 0x75afdadaU, 0x63422121U, 0x30201010U, 0x1ae5ffffU,
+    0x0efdf3f3U, 0x6dbfd2d2U, 0x4c81cdcdU, 0x14180c0cU, 0x35261313U, 0x2fc3ececU,
+    0xe1be5f5fU, 0xa2359797U, 0xcc884444U, 0x392e1717U, 0x5793c4c4U, 0xf255a7a7U,
+    0x82fc7e7eU, 0x477a3d3dU, 0xacc86464U, 0xe7ba5d5dU, 0x2b321919U, 0x95e67373U,
+    0xa0c06060U, 0x98198181U, 0xd19e4f4fU, 0x7fa3dcdcU, 0x66442222U, 0x7e542a2aU,
+    0xab3b9090U, 0x830b8888U, 0xca8c4646U, 0x29c7eeeeU, 0xd36bb8b8U, 0x3c281414U,
+    0x79a7dedeU, 0xe2bc5e5eU, 0x1d160b0bU, 0x76addbdbU, 0x3bdbe0e0U, 0x56643232U,
+    0x4e743a3aU, 0x1e140a0aU, 0xdb924949U, 0x0a0c0606U, 0x6c482424U, 0xe4b85c5cU,
+    0x5d9fc2c2U, 0x6ebdd3d3U, 0xef43acacU, 0xa6c46262U, 0xa8399191U, 0xa4319595U,
+    0x37d3e4e4U, 0x8bf27979U, 0x32d5e7e7U, 0x438bc8c8U, 0x596e3737U, 0xb7da6d6dU,
+    0x8c018d8dU, 0x64b1d5d5U, 0xd29c4e4eU, 0xe049a9a9U, 0xb4d86c6cU, 0xfaac5656U,
+    0x07f3f4f4U, 0x25cfeaeaU, 0xafca6565U, 0x8ef47a7aU, 0xe947aeaeU, 0x18100808U,
+    0xd56fbabaU, 0x88f07878U, 0x6f4a2525U, 0x725c2e2eU, 0x24381c1cU, 0xf157a6a6U,
+    0xc773b4b4U, 0x5197c6c6U, 0x23cbe8e8U, 0x7ca1ddddU, 0x9ce87474U, 0x213e1f1fU,
+    0xdd964b4bU, 0xdc61bdbdU, 0x860d8b8bU, 0x850f8a8aU, 0x90e07070U, 0x427c3e3eU,
+    0xc471b5b5U, 0xaacc6666U, 0xd8904848U, 0x05060303U, 0x01f7f6f6U, 0x121c0e0eU,
+    0xa3c26161U, 0x5f6a3535U, 0xf9ae5757U, 0xd069b9b9U, 0x91178686U, 0x5899c1c1U,
+    0x273a1d1dU, 0xb9279e9eU, 0x38d9e1e1U, 0x13ebf8f8U, 0xb32b9898U, 0x33221111U,
+    0xbbd26969U, 0x70a9d9d9U, 0x89078e8eU, 0xa7339494U, 0xb62d9b9bU, 0x223c1e1eU,
+    0x92158787U, 0x20c9e9e9U, 0x4987ceceU, 0xffaa5555U, 0x78502828U, 0x7aa5dfdfU,
+    0x8f038c8cU, 0xf859a1a1U, 0x80098989U, 0x171a0d0dU, 0xda65bfbfU, 0x31d7e6e6U,
+    0xc6844242U, 0xb8d06868U, 0xc3824141U, 0xb0299999U, 0x775a2d2dU, 0x111e0f0fU,
+    0xcb7bb0b0U, 0xfca85454U, 0xd66dbbbbU, 0x3a2c1616U
+};
 
-    /* Rijndael key schedule */
-    while(p < b){
-        
-        swap = k[p - 4U];
-        k[p     ] = SBOX( k[p - 3U] ) ^ k[p      - ks] ^ RCON(i);
-        k[p + 1U] = SBOX( k[p - 2U] ) ^ k[p + 1U - ks];
-        k[p + 2U] = SBOX( k[p - 1U] ) ^ k[p + 2U - ks];
-        k[p + 3U] = SBOX( swap      ) ^ k[p + 3U - ks];
-        p += 4U;
+static const uint32_t te2[] = {
+    0x63a5c663U, 0x7c84f87cU, 0x7799ee77U, 0x7b8df67bU, 0xf20dfff2U, 0x6bbdd66bU,
+    0x6fb1de6fU, 0xc55491c5U, 0x30506030U, 0x01030201U, 0x67a9ce67U, 0x2b7d562bU,
+    0xfe19e7feU, 0xd762b5d7U, 0xabe64dabU, 0x769aec76U, 0xca458fcaU, 0x829d1f82U,
+    0xc94089c9U, 0x7d87fa7dU, 0xfa15effaU, 0x59ebb259U, 0x47c98e47U, 0xf00bfbf0U,
+    0xadec41adU, 0xd467b3d4U, 0xa2fd5fa2U, 0xafea45afU, 0x9cbf239cU, 0xa4f753a4U,
+    0x7296e472U, 0xc05b9bc0U, 0xb7c275b7U, 0xfd1ce1fdU, 0x93ae3d93U, 0x266a4c26U,
+    0x365a6c36U, 0x3f417e3fU, 0xf702f5f7U, 0xcc4f83ccU, 0x345c6834U, 0xa5f451a5U,
+    0xe534d1e5U, 0xf108f9f1U, 0x7193e271U, 0xd873abd8U, 0x31536231U, 0x153f2a15U,
+    0x040c0804U, 0xc75295c7U, 0x23654623U, 0xc35e9dc3U, 0x18283018U, 0x96a13796U,
+    0x050f0a05U, 0x9ab52f9aU, 0x07090e07U, 0x12362412U, 0x809b1b80U, 0xe23ddfe2U,
+    0xeb26cdebU, 0x27694e27U, 0xb2cd7fb2U, 0x759fea75U, 0x091b1209U, 0x839e1d83U,
+    0x2c74582cU, 0x1a2e341aU, 0x1b2d361bU, 0x6eb2dc6eU, 0x5aeeb45aU, 0xa0fb5ba0U,
+    0x52f6a452U, 0x3b4d763bU, 0xd661b7d6U, 0xb3ce7db3U, 0x297b5229U, 0xe33edde3U,
+    0x2f715e2fU, 0x84971384U, 0x53f5a653U, 0xd168b9d1U, 0x00000000U, 0xed2cc1edU,
+    0x20604020U, 0xfc1fe3fcU, 0xb1c879b1U, 0x5bedb65bU, 0x6abed46aU, 0xcb468dcbU,
+    0xbed967beU, 0x394b7239U, 0x4ade944aU, 0x4cd4984cU, 0x58e8b058U, 0xcf4a85cfU,
+    0xd06bbbd0U, 0xef2ac5efU, 0xaae54faaU, 0xfb16edfbU, 0x43c58643U, 0x4dd79a4dU,
+    0x33556633U, 0x85941185U, 0x45cf8a45U, 0xf910e9f9U, 0x02060402U, 0x7f81fe7fU,
+    0x50f0a050U, 0x3c44783cU, 0x9fba259fU, 0xa8e34ba8U, 0x51f3a251U, 0xa3fe5da3U,
+    0x40c08040U, 0x8f8a058fU, 0x92ad3f92U, 0x9dbc219dU, 0x38487038U, 0xf504f1f5U,
+    0xbcdf63bcU, 0xb6c177b6U, 0xda75afdaU, 0x21634221U, 0x10302010U, 0xff1ae5ffU,
+    0xf30efdf3U, 0xd26dbfd2U, 0xcd4c81cdU, 0x0c14180cU, 0x13352613U, 0xec2fc3ecU,
+    0x5fe1be5fU, 0x97a23597U, 0x44cc8844U, 0x17392e17U, 0xc45793c4U, 0xa7f255a7U,
+    0x7e82fc7eU, 0x3d477a3dU, 0x64acc864U, 0x5de7ba5dU, 0x192b3219U, 0x7395e673U,
+    0x60a0c060U, 0x81981981U, 0x4fd19e4fU, 0xdc7fa3dcU, 0x22664422U, 0x2a7e542aU,
+    0x90ab3b90U, 0x88830b88U, 0x46ca8c46U, 0xee29c7eeU, 0xb8d36bb8U, 0x143c2814U,
+    0xde79a7deU, 0x5ee2bc5eU, 0x0b1d160bU, 0xdb76addbU, 0xe03bdbe0U, 0x32566432U,
+    0x3a4e743aU, 0x0a1e140aU, 0x49db9249U, 0x060a0c06U, 0x246c4824U, 0x5ce4b85cU,
+    0xc25d9fc2U, 0xd36ebdd3U, 0xacef43acU, 0x62a6c462U, 0x91a83991U, 0x95a43195U,
+    0xe437d3e4U, 0x798bf279U, 0xe732d5e7U, 0xc8438bc8U, 0x37596e37U, 0x6db7da6dU,
+    0x8d8c018dU, 0xd564b1d5U, 0x4ed29c4eU, 0xa9e049a9U, 0x6cb4d86cU, 0x56faac56U,
+    0xf407f3f4U, 0xea25cfeaU, 0x65afca65U, 0x7a8ef47aU, 0xaee947aeU, 0x08181008U,
+    0xbad56fbaU, 0x7888f078U, 0x256f4a25U, 0x2e725c2eU, 0x1c24381cU, 0xa6f157a6U,
+    0xb4c773b4U, 0xc65197c6U, 0xe823cbe8U, 0xdd7ca1ddU, 0x749ce874U, 0x1f213e1fU,
+    0x4bdd964bU, 0xbddc61bdU, 0x8b860d8bU, 0x8a850f8aU, 0x7090e070U, 0x3e427c3eU,
+    0xb5c471b5U, 0x66aacc66U, 0x48d89048U, 0x03050603U, 0xf601f7f6U, 0x0e121c0eU,
+    0x61a3c261U, 0x355f6a35U, 0x57f9ae57U, 0xb9d069b9U, 0x86911786U, 0xc15899c1U,
+    0x1d273a1dU, 0x9eb9279eU, 0xe138d9e1U, 0xf813ebf8U, 0x98b32b98U, 0x11332211U,
+    0x69bbd269U, 0xd970a9d9U, 0x8e89078eU, 0x94a73394U, 0x9bb62d9bU, 0x1e223c1eU,
+    0x87921587U, 0xe920c9e9U, 0xce4987ceU, 0x55ffaa55U, 0x28785028U, 0xdf7aa5dfU,
+    0x8c8f038cU, 0xa1f859a1U, 0x89800989U, 0x0d171a0dU, 0xbfda65bfU, 0xe631d7e6U,
+    0x42c68442U, 0x68b8d068U, 0x41c38241U, 0x99b02999U, 0x2d775a2dU, 0x0f111e0fU,
+    0xb0cb7bb0U, 0x54fca854U, 0xbbd66dbbU, 0x163a2c16U
+};
 
-        for(j=0U; j < 12U; j++){
+static const uint32_t te3[] = {
+    0x6363a5c6U, 0x7c7c84f8U, 0x777799eeU, 0x7b7b8df6U, 0xf2f20dffU, 0x6b6bbdd6U,
+    0x6f6fb1deU, 0xc5c55491U, 0x30305060U, 0x01010302U, 0x6767a9ceU, 0x2b2b7d56U,
+    0xfefe19e7U, 0xd7d762b5U, 0xababe64dU, 0x76769aecU, 0xcaca458fU, 0x82829d1fU,
+    0xc9c94089U, 0x7d7d87faU, 0xfafa15efU, 0x5959ebb2U, 0x4747c98eU, 0xf0f00bfbU,
+    0xadadec41U, 0xd4d467b3U, 0xa2a2fd5fU, 0xafafea45U, 0x9c9cbf23U, 0xa4a4f753U,
+    0x727296e4U, 0xc0c05b9bU, 0xb7b7c275U, 0xfdfd1ce1U, 0x9393ae3dU, 0x26266a4cU,
+    0x36365a6cU, 0x3f3f417eU, 0xf7f702f5U, 0xcccc4f83U, 0x34345c68U, 0xa5a5f451U,
+    0xe5e534d1U, 0xf1f108f9U, 0x717193e2U, 0xd8d873abU, 0x31315362U, 0x15153f2aU,
+    0x04040c08U, 0xc7c75295U, 0x23236546U, 0xc3c35e9dU, 0x18182830U, 0x9696a137U,
+    0x05050f0aU, 0x9a9ab52fU, 0x0707090eU, 0x12123624U, 0x80809b1bU, 0xe2e23ddfU,
+    0xebeb26cdU, 0x2727694eU, 0xb2b2cd7fU, 0x75759feaU, 0x09091b12U, 0x83839e1dU,
+    0x2c2c7458U, 0x1a1a2e34U, 0x1b1b2d36U, 0x6e6eb2dcU, 0x5a5aeeb4U, 0xa0a0fb5bU,
+    0x5252f6a4U, 0x3b3b4d76U, 0xd6d661b7U, 0xb3b3ce7dU, 0x29297b52U, 0xe3e33eddU,
+    0x2f2f715eU, 0x84849713U, 0x5353f5a6U, 0xd1d168b9U, 0x00000000U, 0xeded2cc1U,
+    0x20206040U, 0xfcfc1fe3U, 0xb1b1c879U, 0x5b5bedb6U, 0x6a6abed4U, 0xcbcb468dU,
+    0xbebed967U, 0x39394b72U, 0x4a4ade94U, 0x4c4cd498U, 0x5858e8b0U, 0xcfcf4a85U,
+    0xd0d06bbbU, 0xefef2ac5U, 0xaaaae54fU, 0xfbfb16edU, 0x4343c586U, 0x4d4dd79aU,
+    0x33335566U, 0x85859411U, 0x4545cf8aU, 0xf9f910e9U, 0x02020604U, 0x7f7f81feU,
+    0x5050f0a0U, 0x3c3c4478U, 0x9f9fba25U, 0xa8a8e34bU, 0x5151f3a2U, 0xa3a3fe5dU,
+    0x4040c080U, 0x8f8f8a05U, 0x9292ad3fU, 0x9d9dbc21U, 0x38384870U, 0xf5f504f1U,
+    0xbcbcdf63U, 0xb6b6c177U, 0xdada75afU, 0x21216342U, 0x10103020U, 0xffff1ae5U,
+    0xf3f30efdU, 0xd2d26dbfU, 0xcdcd4c81U, 0x0c0c1418U, 0x13133526U, 0xecec2fc3U,
+    0x5f5fe1beU, 0x9797a235U, 0x4444cc88U, 0x1717392eU, 0xc4c45793U, 0xa7a7f255U,
+    0x7e7e82fcU, 0x3d3d477aU, 0x6464acc8U, 0x5d5de7baU, 0x19192b32U, 0x737395e6U,
+    0x6060a0c0U, 0x81819819U, 0x4f4fd19eU, 0xdcdc7fa3U, 0x22226644U, 0x2a2a7e54U,
+    0x9090ab3bU, 0x8888830bU, 0x4646ca8cU, 0xeeee29c7U, 0xb8b8d36bU, 0x14143c28U,
+    0xdede79a7U, 0x5e5ee2bcU, 0x0b0b1d16U, 0xdbdb76adU, 0xe0e03bdbU, 0x32325664U,
+    0x3a3a4e74U, 0x0a0a1e14U, 0x4949db92U, 0x06060a0cU, 0x24246c48U, 0x5c5ce4b8U,
+    0xc2c25d9fU, 0xd3d36ebdU, 0xacacef43U, 0x6262a6c4U, 0x9191a839U, 0x9595a431U,
+    0xe4e437d3U, 0x79798bf2U, 0xe7e732d5U, 0xc8c8438bU, 0x3737596eU, 0x6d6db7daU,
+    0x8d8d8c01U, 0xd5d564b1U, 0x4e4ed29cU, 0xa9a9e049U, 0x6c6cb4d8U, 0x5656faacU,
+    0xf4f407f3U, 0xeaea25cfU, 0x6565afcaU, 0x7a7a8ef4U, 0xaeaee947U, 0x08081810U,
+    0xbabad56fU, 0x787888f0U, 0x25256f4aU, 0x2e2e725cU, 0x1c1c2438U, 0xa6a6f157U,
+    0xb4b4c773U, 0xc6c65197U, 0xe8e823cbU, 0xdddd7ca1U, 0x74749ce8U, 0x1f1f213eU,
+    0x4b4bdd96U, 0xbdbddc61U, 0x8b8b860dU, 0x8a8a850fU, 0x707090e0U, 0x3e3e427cU,
+    0xb5b5c471U, 0x6666aaccU, 0x4848d890U, 0x03030506U, 0xf6f601f7U, 0x0e0e121cU,
+    0x6161a3c2U, 0x35355f6aU, 0x5757f9aeU, 0xb9b9d069U, 0x86869117U, 0xc1c15899U,
+    0x1d1d273aU, 0x9e9eb927U, 0xe1e138d9U, 0xf8f813ebU, 0x9898b32bU, 0x11113322U,
+    0x6969bbd2U, 0xd9d970a9U, 0x8e8e8907U, 0x9494a733U, 0x9b9bb62dU, 0x1e1e223cU,
+    0x87879215U, 0xe9e920c9U, 0xcece4987U, 0x5555ffaaU, 0x28287850U, 0xdfdf7aa5U,
+    0x8c8c8f03U, 0xa1a1f859U, 0x89898009U, 0x0d0d171aU, 0xbfbfda65U, 0xe6e631d7U,
+    0x4242c684U, 0x6868b8d0U, 0x4141c382U, 0x9999b029U, 0x2d2d775aU, 0x0f0f111eU,
+    0xb0b0cb7bU, 0x5454fca8U, 0xbbbbd66dU, 0x16163a2cU
+};
 
-            k[p] = k[p - 4U] ^ k[p - ks];
-            p++;
-        }
+#endif
 
-        i++;
-    }
-}
+#else
 
-void LoraAES_encrypt(const struct lora_aes_ctx *ctx, uint8_t *s)
-{
-    uint8_t r;    
-    uint8_t a;
-    uint8_t b;
-    uint8_t c;
-    uint8_t d;    
-    uint8_t i;
-    uint8_t p = 0U;
-    const uint8_t *k = ctx->k;
+    #define AES_LANES 1U
 
-    /* add round key, sbox and shiftrows */
-    for(r = 0U; r < ctx->r; r++){
+#endif
 
-        /* add round key, sbox, left shift row */
+/* static function prototypes *****************************************/
 
-        /* row 1 */
-        s[C1] = SBOX( s[C1] ^ k[p] );
-        s[C2] = SBOX( s[C2] ^ k[p + C2] );
-        s[C3] = SBOX( s[C3] ^ k[p + C3] );
-        s[C4] = SBOX( s[C4] ^ k[p + C4] );
+/**
+ * Encrypt `n` consecutive blocks, each with its own key
+ * 
+ * @param[in] ctx array of `n` expanded keys
+ * @param[in/out] s `n` blocks of state
+ * @param[in] n number of blocks (1..AES_LANES)
+ * 
+ * */
+static void encryptBlocks(const struct lora_aes_ctx *const *ctx, uint8_t *s, uint8_t n);
 
-        /* row 2, left shift 1 */
-        a = SBOX( s[R2] ^ k[p + R2] );
-        s[R2     ] = SBOX( s[R2 + C2] ^ k[p + R2 + C2] );
-        s[R2 + C2] = SBOX( s[R2 + C3] ^ k[p + R2 + C3] );
-        s[R2 + C3] = SBOX( s[R2 + C4] ^ k[p + R2 + C4] );
-        s[R2 + C4] = a;
+/**
+ * Increment a 128 bit big-endian counter block
+ * 
+ * @param[in/out] ctr
+ * 
+ * */
+static void incrementCounter(uint8_t *ctr);
 
-        /* row 3, left shift 2 */
-        a = SBOX( s[R3     ] ^ k[p + R3] );
-        b = SBOX( s[R3 + C2] ^ k[p + R3 + C2] );
-        s[R3     ] = SBOX( s[R3 + C3] ^ k[p + R3 + C3] );
-        s[R3 + C2] = SBOX( s[R3 + C4] ^ k[p + R3 + C4] );
-        s[R3 + C3] = a;
-        s[R3 + C4] = b;
+#if !defined(LORA_USE_PLATFORM_AES)
 
-        /* row 4, left shift 3 */
-        a = SBOX( s[R4 + C4] ^ k[p + R4 + C4] );
-        s[R4 + C4] = SBOX( s[R4 + C3] ^ k[p + R4 + C3] );
-        s[R4 + C3] = SBOX( s[R4 + C2] ^ k[p + R4 + C2] );
-        s[R4 + C2] = SBOX( s[R4     ] ^ k[p + R4     ] );
-        s[R4     ] = a;
+/**
+ * Portable key expansion
+ * 
+ * @param[out] ctx
+ * @param[in] key
+ * 
+ * */
+static void initSoft(struct lora_aes_ctx *ctx, const uint8_t *key);
 
-        if((r+1U) == ctx->r){
+/**
+ * Portable block encryption (byte, T-table or bitsliced engine)
+ * 
+ * @param[in] ctx
+ * @param[in/out] s
+ * 
+ * */
+static void encryptSoft(const struct lora_aes_ctx *ctx, uint8_t *s);
 
-            p += 16U;
+/**
+ * Portable encryption of several blocks
+ * 
+ * @param[in] ctx
+ * @param[in/out] s
+ * @param[in] n
+ * 
+ * */
+static void encryptSoftN(const struct lora_aes_ctx *const *ctx, uint8_t *s, uint8_t n);
 
-            /* final add round key */
-            for(i=0U; i < 16U; i++){
+#if defined(LORA_AES_BITSLICE)
 
-                s[i] ^= ctx->k[p+i];
-            }
-            
-            break;
-        }
-         
-        /* mix columns */
-        for(i=0U; i < 16U; i += 4U){
+/**
+ * Transpose blocks to and from the bitsliced representation
+ * 
+ * Applying this twice restores the input.
+ * 
+ * @param[in/out] q eight words
+ * 
+ * */
+static void ortho(bitslice_word_t *q);
 
-            a = s[i     ];
-            b = s[i + 1U];
-            c = s[i + 2U];
-            d = s[i + 3U];
+/**
+ * SubBytes on every byte of the bitsliced state
+ * 
+ * This is the Boyar-Peralta circuit so there are no lookups.
+ * 
+ * @param[in/out] q eight words
+ * 
+ * */
+static void subBytesBitslice(bitslice_word_t *q);
 
-            /* 2a + 3b + 1c + 1d 
-             * 1a + 2b + 3c + 1d
-             * 1a + 1b + 2c + 3d
-             * 3a + 1b + 1c + 2d
-             *
-             * */
-            s[i     ] ^= (a ^ b ^ c ^ d) ^ GALOIS_MUL2( (a ^ b) );
-            s[i + 1U] ^= (a ^ b ^ c ^ d) ^ GALOIS_MUL2( (b ^ c) );
-            s[i + 2U] ^= (a ^ b ^ c ^ d) ^ GALOIS_MUL2( (c ^ d) );
-            s[i + 3U] ^= (a ^ b ^ c ^ d) ^ GALOIS_MUL2( (d ^ a) );
-        }
+/**
+ * SubWord on a key schedule word (constant-time)
+ * 
+ * @param[in] x
+ * @return SubWord(x)
+ * 
+ * */
+static uint32_t subWordBitslice(uint32_t x);
 
-        p += 16U;
-    }   
+/**
+ * ShiftRows applied `n` times to one word of the bitsliced state
+ * 
+ * @param[in] x
+ * @param[in] n
+ * @return x with row r rotated left by (n * r) mod 4 columns
+ * 
+ * */
+static bitslice_word_t shiftRowsWord(bitslice_word_t x, uint8_t n);
+
+/**
+ * MixColumns on a fixsliced state
+ * 
+ * After round `t` without ShiftRows, row r of the state is
+ * rotated right by (t * r) mod 4 columns compared with the real one.
+ * 
+ * @param[in/out] q eight words
+ * @param[in] t round
+ * 
+ * */
+static void mixColumnsBitslice(bitslice_word_t *q, uint8_t t);
+
+#if defined(AES_BITSLICE_64)
+
+/**
+ * Spread the four words of a block over two state words
+ * 
+ * Bytes are spaced so that ortho() can then bring block N to lane N.
+ * 
+ * @param[out] q0
+ * @param[out] q1
+ * @param[in] w four little-endian words of a block
+ * 
+ * */
+static void interleaveIn(uint64_t *q0, uint64_t *q1, const uint32_t *w);
+
+/**
+ * Inverse of interleaveIn()
+ * 
+ * @param[out] w four little-endian words of a block
+ * @param[in] q0
+ * @param[in] q1
+ * 
+ * */
+static void interleaveOut(uint32_t *w, uint64_t q0, uint64_t q1);
+
+/**
+ * Add round key `r` of each lane's key to the bitsliced state
+ * 
+ * @param[in/out] q eight words
+ * @param[in] keys one per lane
+ * @param[in] r round
+ * @param[in] same true if every lane has the same key
+ * 
+ * */
+static void addRoundKeyBitslice(uint64_t *q, const struct lora_aes_ctx *const *keys, uint8_t r, bool same);
+
+#else
+
+/**
+ * Add round key `r` of each lane's key to the bitsliced state
+ * 
+ * @param[in/out] q eight words
+ * @param[in] k0 key of lane 0
+ * @param[in] k1 key of lane 1
+ * @param[in] r round
+ * 
+ * */
+static void addRoundKeyBitslice(uint32_t *q, const struct lora_aes_ctx *k0, const struct lora_aes_ctx *k1, uint8_t r);
+
+#endif
+
+#endif
+
+#if defined(LORA_AES_HW)
+
+/**
+ * Select the fastest engine supported by the CPU (result is cached)
+ * 
+ * @return engine
+ * 
+ * */
+static const struct aes_engine *getEngine(void);
+
+#if defined(AES_HW_X86)
+AES_HW_TARGET static __m128i expandNI(__m128i key, __m128i kga);
+AES_HW_TARGET static void initNI(struct lora_aes_ctx *ctx, const uint8_t *key);
+AES_HW_TARGET static void encryptNI(const struct lora_aes_ctx *ctx, uint8_t *s);
+AES_HW_TARGET static void encryptNIN(const struct lora_aes_ctx *const *ctx, uint8_t *s, uint8_t n);
+#elif defined(AES_HW_ARM)
+AES_HW_TARGET static void encryptCE(const struct lora_aes_ctx *ctx, uint8_t *s);
+AES_HW_TARGET static void encryptCEN(const struct lora_aes_ctx *const *ctx, uint8_t *s, uint8_t n);
+#endif
+
+#endif
+
+#endif
+
+/* functions **********************************************************/
+
+#if !defined(LORA_USE_PLATFORM_AES)
+
+void LoraAES_init(struct lora_aes_ctx *ctx, const uint8_t *key)
+{
+    LORA_PEDANTIC(ctx != NULL)
+    LORA_PEDANTIC(key != NULL)
+
+#if defined(LORA_AES_HW)
+    getEngine()->init(ctx, key);
+#else
+    initSoft(ctx, key);
+#endif
 }
 
+void LoraAES_encrypt(const struct lora_aes_ctx *ctx, uint8_t *s)
+{
+    LORA_PEDANTIC(ctx != NULL)
+    LORA_PEDANTIC(s != NULL)
+
+#if defined(LORA_AES_HW)
+    getEngine()->encrypt(ctx, s);
+#else
+    encryptSoft(ctx, s);
+#endif
+}
 
-#if !defined(LORA_DEVICE)
+#if !defined(LORA_AES_NO_DECRYPT)
 void LoraAES_decrypt(const struct lora_aes_ctx *ctx, uint8_t *s)
 {
     uint8_t r;
@@ -365,3 +776,1171 @@ void LoraAES_decrypt(const struct lora_aes_ctx *ctx, uint8_t *s)
 #endif
 
 #endif
+
+void LoraAES_ctr(const struct lora_aes_ctx *ctx, const uint8_t *iv, void *data, size_t len)
+{
+    LORA_PEDANTIC(ctx != NULL)
+    LORA_PEDANTIC(iv != NULL)
+    LORA_PEDANTIC((len == 0U) || (data != NULL))
+    
+    const struct lora_aes_ctx *keys[AES_LANES];
+    uint8_t ks[AES_LANES * AES_BLOCK_SIZE];
+    uint8_t ctr[AES_BLOCK_SIZE];
+    uint8_t *out = (uint8_t *)data;
+    size_t pos = 0U;
+    size_t part;
+    size_t i;
+    uint8_t n;
+
+    (void)memcpy(ctr, iv, sizeof(ctr));
+
+    for(i=0U; i < AES_LANES; i++){
+
+        keys[i] = ctx;
+    }
+
+    while(pos < len){
+
+        /* generate up to AES_LANES keystream blocks at once */
+        for(n=0U; (n < AES_LANES) && ((pos + ((size_t)n * AES_BLOCK_SIZE)) < len); n++){
+
+            (void)memcpy(&ks[n * AES_BLOCK_SIZE], ctr, sizeof(ctr));
+            incrementCounter(ctr);
+        }
+
+        encryptBlocks(keys, ks, n);
+
+        part = (len - pos);
+        part = (part > ((size_t)n * AES_BLOCK_SIZE)) ? ((size_t)n * AES_BLOCK_SIZE) : part;
+
+        for(i=0U; (i + AES_BLOCK_SIZE) <= part; i += AES_BLOCK_SIZE){
+
+            LoraBlock_xor128(&out[pos + i], &ks[i]);
+        }
+
+        for(; i < part; i++){
+
+            out[pos + i] ^= ks[i];
+        }
+
+        pos += part;
+    }
+}
+
+void LoraAES_encryptBlocks(const struct lora_aes_ctx *const *ctx, uint8_t *s, size_t n)
+{
+    LORA_PEDANTIC((n == 0U) || (ctx != NULL))
+    LORA_PEDANTIC((n == 0U) || (s != NULL))
+
+    size_t pos;
+    uint8_t lanes;
+
+    for(pos=0U; pos < n; pos += lanes){
+
+        lanes = ((n - pos) > AES_LANES) ? (uint8_t)AES_LANES : (uint8_t)(n - pos);
+
+        encryptBlocks(&ctx[pos], &s[pos * AES_BLOCK_SIZE], lanes);
+    }
+}
+
+/* static functions ***************************************************/
+
+static void encryptBlocks(const struct lora_aes_ctx *const *ctx, uint8_t *s, uint8_t n)
+{
+    LORA_PEDANTIC(n <= AES_LANES)
+
+#if defined(LORA_USE_PLATFORM_AES)
+    uint8_t i;
+
+    for(i=0U; i < n; i++){
+
+        LoraAES_encrypt(ctx[i], &s[i * AES_BLOCK_SIZE]);
+    }
+#elif defined(LORA_AES_HW)
+    getEngine()->encryptN(ctx, s, n);
+#else
+    encryptSoftN(ctx, s, n);
+#endif
+}
+
+static void incrementCounter(uint8_t *ctr)
+{
+    uint8_t i;
+
+    for(i=AES_BLOCK_SIZE; i > 0U; i--){
+
+        ctr[i-1U]++;
+
+        if(ctr[i-1U] != 0U){
+
+            break;
+        }
+    }
+}
+
+#if !defined(LORA_USE_PLATFORM_AES)
+
+#if defined(LORA_AES_BITSLICE)
+
+static void encryptSoft(const struct lora_aes_ctx *ctx, uint8_t *s)
+{
+    /* a single block costs the same as a full pass */
+    encryptSoftN(&ctx, s, 1U);
+}
+
+#if defined(AES_BITSLICE_64)
+
+static void initSoft(struct lora_aes_ctx *ctx, const uint8_t *key)
+{
+    static const uint8_t rcon[] = {
+        0x01U, 0x02U, 0x04U, 0x08U, 0x10U, 0x20U, 0x40U, 0x80U, 0x1bU, 0x36U
+    };
+
+    uint32_t w[44U];
+    uint64_t q[8U];
+    uint64_t comp;
+    uint32_t tmp = 0U;
+    uint8_t i;
+    uint8_t j;
+
+    /* Rijndael key schedule */
+    for(i=0U; i < 4U; i++){
+
+        tmp = GETU32LE(&key[i << 2]);
+        w[i] = tmp;
+    }
+
+    for(i=4U; i < 44U; i++){
+
+        if((i & 3U) == 0U){
+
+            tmp = (tmp << 24) | (tmp >> 8);
+            tmp = subWordBitslice(tmp) ^ (uint32_t)rcon[(i >> 2) - 1U];
+        }
+
+        tmp ^= w[i - 4U];
+        w[i] = tmp;
+    }
+
+    /* each round key is kept in bitsliced form, compressed to one copy 
+     * (bits 0..3 of each nibble are bit planes 0..3 or 4..7) */
+    for(i=0U; i < 11U; i++){
+
+        interleaveIn(&q[0], &q[4], &w[i << 2]);
+
+        q[1] = q[0];
+        q[2] = q[0];
+        q[3] = q[0];
+        q[5] = q[4];
+        q[6] = q[4];
+        q[7] = q[4];
+
+        ortho(q);
+
+        for(j=0U; j < 2U; j++){
+
+            comp = (q[(j << 2)] & LANE0) 
+                | (q[(j << 2) + 1U] & (LANE0 << 1)) 
+                | (q[(j << 2) + 2U] & (LANE0 << 2)) 
+                | (q[(j << 2) + 3U] & (LANE0 << 3));
+
+            /* keys for rounds 1..9 are rotated to match the fixsliced state 
+             * (columns move by whole nibbles so the bit planes are kept apart) */
+            if((i > 0U) && (i < 10U)){
+
+                comp = shiftRowsWord(comp, (uint8_t)(4U - (i & 3U)));
+            }
+
+            /* native byte order since the key never leaves this engine */
+            (void)memcpy(&ctx->k[(i << 4) + (j << 3)], &comp, sizeof(comp));
+        }
+    }
+
+    ctx->r = 10U;
+}
+
+static void encryptSoftN(const struct lora_aes_ctx *const *ctx, uint8_t *s, uint8_t n)
+{
+    const struct lora_aes_ctx *keys[4U];
+    uint64_t q[8U];
+    uint32_t w[4U];
+    uint8_t in[AES_BLOCK_SIZE];
+    bool same;
+    uint8_t lanes;
+    uint8_t l;
+    uint8_t b;
+    uint8_t i;
+    uint8_t r;
+
+    for(l=0U; l < n; l += 4U){
+
+        lanes = ((uint8_t)(n - l) > 4U) ? 4U : (uint8_t)(n - l);
+        same = true;
+
+        /* unused lanes encrypt zeros with the first key */
+        for(b=0U; b < 4U; b++){
+
+            if(b < lanes){
+
+                keys[b] = ctx[l + b];
+                (void)memcpy(in, &s[(l + b) * AES_BLOCK_SIZE], sizeof(in));
+            }
+            else{
+
+                keys[b] = ctx[l];
+                (void)memset(in, 0, sizeof(in));
+            }
+
+            same = same && (keys[b] == keys[0]);
+
+            for(i=0U; i < 4U; i++){
+
+                w[i] = GETU32LE(&in[i << 2]);
+            }
+
+            interleaveIn(&q[b], &q[b + 4U], w);
+        }
+
+        ortho(q);
+
+        addRoundKeyBitslice(q, keys, 0U, same);
+
+        /* fixsliced: ShiftRows is left out, MixColumns and the round 
+         * keys follow the columns instead */
+        for(r=1U; r < keys[0]->r; r++){
+
+            subBytesBitslice(q);
+            mixColumnsBitslice(q, r);
+            addRoundKeyBitslice(q, keys, r, same);
+        }
+
+        subBytesBitslice(q);
+
+        /* the last round catches up on every ShiftRows left out */
+        for(i=0U; i < 8U; i++){
+
+            q[i] = shiftRowsWord(q[i], r);
+        }
+
+        addRoundKeyBitslice(q, keys, r, same);
+
+        ortho(q);
+
+        for(b=0U; b < lanes; b++){
+
+            interleaveOut(w, q[b], q[b + 4U]);
+
+            for(i=0U; i < 4U; i++){
+
+                PUTU32LE(&s[((l + b) * AES_BLOCK_SIZE) + (i << 2)], w[i]);
+            }
+        }
+    }
+}
+
+static void interleaveIn(uint64_t *q0, uint64_t *q1, const uint32_t *w)
+{
+    uint64_t x0 = w[0];
+    uint64_t x1 = w[1];
+    uint64_t x2 = w[2];
+    uint64_t x3 = w[3];
+
+    x0 |= (x0 << 16);
+    x1 |= (x1 << 16);
+    x2 |= (x2 << 16);
+    x3 |= (x3 << 16);
+
+    x0 &= 0x0000ffff0000ffffU;
+    x1 &= 0x0000ffff0000ffffU;
+    x2 &= 0x0000ffff0000ffffU;
+    x3 &= 0x0000ffff0000ffffU;
+
+    x0 |= (x0 << 8);
+    x1 |= (x1 << 8);
+    x2 |= (x2 << 8);
+    x3 |= (x3 << 8);
+
+    x0 &= 0x00ff00ff00ff00ffU;
+    x1 &= 0x00ff00ff00ff00ffU;
+    x2 &= 0x00ff00ff00ff00ffU;
+    x3 &= 0x00ff00ff00ff00ffU;
+
+    *q0 = x0 | (x2 << 8);
+    *q1 = x1 | (x3 << 8);
+}
+
+static void interleaveOut(uint32_t *w, uint64_t q0, uint64_t q1)
+{
+    uint64_t x0 = q0 & 0x00ff00ff00ff00ffU;
+    uint64_t x1 = q1 & 0x00ff00ff00ff00ffU;
+    uint64_t x2 = (q0 >> 8) & 0x00ff00ff00ff00ffU;
+    uint64_t x3 = (q1 >> 8) & 0x00ff00ff00ff00ffU;
+
+    x0 |= (x0 >> 8);
+    x1 |= (x1 >> 8);
+    x2 |= (x2 >> 8);
+    x3 |= (x3 >> 8);
+
+    x0 &= 0x0000ffff0000ffffU;
+    x1 &= 0x0000ffff0000ffffU;
+    x2 &= 0x0000ffff0000ffffU;
+    x3 &= 0x0000ffff0000ffffU;
+
+    w[0] = (uint32_t)x0 | (uint32_t)(x0 >> 16);
+    w[1] = (uint32_t)x1 | (uint32_t)(x1 >> 16);
+    w[2] = (uint32_t)x2 | (uint32_t)(x2 >> 16);
+    w[3] = (uint32_t)x3 | (uint32_t)(x3 >> 16);
+}
+
+static void addRoundKeyBitslice(uint64_t *q, const struct lora_aes_ctx *const *keys, uint8_t r, bool same)
+{
+    uint64_t comp;
+    uint64_t x;
+    uint8_t h;
+    uint8_t j;
+    uint8_t l;
+
+    for(h=0U; h < 2U; h++){
+
+        if(same){
+
+            (void)memcpy(&comp, &keys[0]->k[(r << 4) + (h << 3)], sizeof(comp));
+
+            /* x * 15 copies each bit to all four lanes */
+            for(j=0U; j < 4U; j++){
+
+                x = (comp >> j) & LANE0;
+                q[(h << 2) + j] ^= (x << 4) - x;
+            }
+        }
+        else{
+
+            for(l=0U; l < 4U; l++){
+
+                (void)memcpy(&comp, &keys[l]->k[(r << 4) + (h << 3)], sizeof(comp));
+
+                for(j=0U; j < 4U; j++){
+
+                    q[(h << 2) + j] ^= ((comp >> j) & LANE0) << l;
+                }
+            }
+        }
+    }
+}
+
+#else
+
+static void initSoft(struct lora_aes_ctx *ctx, const uint8_t *key)
+{
+    static const uint8_t rcon[] = {
+        0x01U, 0x02U, 0x04U, 0x08U, 0x10U, 0x20U, 0x40U, 0x80U, 0x1bU, 0x36U
+    };
+
+    uint32_t w[88U];
+    uint32_t tmp = 0U;
+    uint8_t i;
+
+    /* Rijndael key schedule with each word repeated for both blocks */
+    for(i=0U; i < 4U; i++){
+
+        tmp = GETU32LE(&key[i << 2]);
+        w[(i << 1)] = tmp;
+        w[(i << 1) + 1U] = tmp;
+    }
+
+    for(i=4U; i < 44U; i++){
+
+        if((i & 3U) == 0U){
+
+            tmp = (tmp << 24) | (tmp >> 8);
+            tmp = subWordBitslice(tmp) ^ (uint32_t)rcon[(i >> 2) - 1U];
+        }
+
+        tmp ^= w[(i - 4U) << 1];
+        w[(i << 1)] = tmp;
+        w[(i << 1) + 1U] = tmp;
+    }
+
+    /* each round key is kept in bitsliced form, compressed to one copy */
+    for(i=0U; i < 88U; i += 8U){
+
+        ortho(&w[i]);
+    }
+
+    for(i=0U; i < 44U; i++){
+
+        tmp = (w[(i << 1)] & 0x55555555U) | (w[(i << 1) + 1U] & 0xaaaaaaaaU);
+
+        /* keys for rounds 1..9 are rotated to match the fixsliced state 
+         * (columns move by even bit counts so the lanes are kept apart) */
+        if(((i >> 2) > 0U) && ((i >> 2) < 10U)){
+
+            tmp = shiftRowsWord(tmp, (uint8_t)(4U - ((i >> 2) & 3U)));
+        }
+
+        /* native byte order since the key never leaves this engine */
+        (void)memcpy(&ctx->k[i << 2], &tmp, sizeof(tmp));
+    }
+
+    ctx->r = 10U;
+}
+
+static void encryptSoftN(const struct lora_aes_ctx *const *ctx, uint8_t *s, uint8_t n)
+{
+    uint32_t q[8U];
+    const struct lora_aes_ctx *k1;
+    const uint8_t *b;
+    uint8_t l;
+    uint8_t i;
+    uint8_t r;
+
+    for(l=0U; l < n; l += 2U){
+
+        /* lane 1 repeats lane 0 when n is odd */
+        b = ((l + 1U) < n) ? &s[(l + 1U) * AES_BLOCK_SIZE] : &s[l * AES_BLOCK_SIZE];
+        k1 = ((l + 1U) < n) ? ctx[l + 1U] : ctx[l];
+
+        for(i=0U; i < 4U; i++){
+
+            q[(i << 1)] = GETU32LE(&s[(l * AES_BLOCK_SIZE) + (i << 2)]);
+            q[(i << 1) + 1U] = GETU32LE(&b[i << 2]);
+        }
+
+        ortho(q);
+        addRoundKeyBitslice(q, ctx[l], k1, 0U);
+
+        /* fixsliced: ShiftRows is left out, MixColumns and the round 
+         * keys follow the columns instead */
+        for(r=1U; r < ctx[l]->r; r++){
+
+            subBytesBitslice(q);
+            mixColumnsBitslice(q, r);
+
+            addRoundKeyBitslice(q, ctx[l], k1, r);
+        }
+
+        subBytesBitslice(q);
+
+        /* the last round catches up on every ShiftRows left out */
+        for(i=0U; i < 8U; i++){
+
+            q[i] = shiftRowsWord(q[i], r);
+        }
+
+        addRoundKeyBitslice(q, ctx[l], k1, r);
+
+        ortho(q);
+
+        for(i=0U; i < 4U; i++){
+
+            PUTU32LE(&s[(l * AES_BLOCK_SIZE) + (i << 2)], q[(i << 1)]);
+
+            if((l + 1U) < n){
+
+                PUTU32LE(&s[((l + 1U) * AES_BLOCK_SIZE) + (i << 2)], q[(i << 1) + 1U]);
+            }
+        }
+    }
+}
+
+static void addRoundKeyBitslice(uint32_t *q, const struct lora_aes_ctx *k0, const struct lora_aes_ctx *k1, uint8_t r)
+{
+    uint32_t x0;
+    uint32_t x1;
+    uint8_t i;
+
+    /* even bits belong to lane 0, odd bits to lane 1 */
+    for(i=0U; i < 4U; i++){
+
+        (void)memcpy(&x0, &k0->k[((r << 2) + i) << 2], sizeof(x0));
+
+        if(k0 == k1){
+
+            /* copy each bit to both lanes */
+            x1 = x0 & 0x55555555U;
+            q[(i << 1)] ^= x1 | (x1 << 1);
+            x1 = x0 & 0xaaaaaaaaU;
+            q[(i << 1) + 1U] ^= x1 | (x1 >> 1);
+        }
+        else{
+
+            (void)memcpy(&x1, &k1->k[((r << 2) + i) << 2], sizeof(x1));
+
+            q[(i << 1)] ^= (x0 & 0x55555555U) | ((x1 & 0x55555555U) << 1);
+            q[(i << 1) + 1U] ^= ((x0 & 0xaaaaaaaaU) >> 1) | (x1 & 0xaaaaaaaaU);
+        }
+    }
+}
+
+#endif
+
+/* a bit pattern repeated across a state word */
+#define REPEAT(X) ((bitslice_word_t)((X) * 0x0101010101010101U))
+
+static void ortho(bitslice_word_t *q)
+{
+    SWAPN(REPEAT(0x55U), REPEAT(0xaaU), 1U, q[0], q[1]);
+    SWAPN(REPEAT(0x55U), REPEAT(0xaaU), 1U, q[2], q[3]);
+    SWAPN(REPEAT(0x55U), REPEAT(0xaaU), 1U, q[4], q[5]);
+    SWAPN(REPEAT(0x55U), REPEAT(0xaaU), 1U, q[6], q[7]);
+
+    SWAPN(REPEAT(0x33U), REPEAT(0xccU), 2U, q[0], q[2]);
+    SWAPN(REPEAT(0x33U), REPEAT(0xccU), 2U, q[1], q[3]);
+    SWAPN(REPEAT(0x33U), REPEAT(0xccU), 2U, q[4], q[6]);
+    SWAPN(REPEAT(0x33U), REPEAT(0xccU), 2U, q[5], q[7]);
+
+    SWAPN(REPEAT(0x0fU), REPEAT(0xf0U), 4U, q[0], q[4]);
+    SWAPN(REPEAT(0x0fU), REPEAT(0xf0U), 4U, q[1], q[5]);
+    SWAPN(REPEAT(0x0fU), REPEAT(0xf0U), 4U, q[2], q[6]);
+    SWAPN(REPEAT(0x0fU), REPEAT(0xf0U), 4U, q[3], q[7]);
+}
+
+static void subBytesBitslice(bitslice_word_t *q)
+{
+    /* Boyar and Peralta, "A new combinational logic minimization 
+     * technique with applications to cryptology" (x0 and s0 are the
+     * most significant bits) */
+
+    bitslice_word_t x0, x1, x2, x3, x4, x5, x6, x7;
+    bitslice_word_t y1, y2, y3, y4, y5, y6, y7, y8, y9, y10, y11;
+    bitslice_word_t y12, y13, y14, y15, y16, y17, y18, y19, y20, y21;
+    bitslice_word_t z0, z1, z2, z3, z4, z5, z6, z7, z8, z9, z10, z11;
+    bitslice_word_t z12, z13, z14, z15, z16, z17;
+    bitslice_word_t t0, t1, t2, t3, t4, t5, t6, t7, t8, t9, t10, t11;
+    bitslice_word_t t12, t13, t14, t15, t16, t17, t18, t19, t20, t21, t22, t23;
+    bitslice_word_t t24, t25, t26, t27, t28, t29, t30, t31, t32, t33, t34, t35;
+    bitslice_word_t t36, t37, t38, t39, t40, t41, t42, t43, t44, t45, t46, t47;
+    bitslice_word_t t48, t49, t50, t51, t52, t53, t54, t55, t56, t57, t58, t59;
+    bitslice_word_t t60, t61, t62, t63, t64, t65, t66, t67;
+    bitslice_word_t s0, s1, s2, s3, s4, s5, s6, s7;
+
+    x0 = q[7];
+    x1 = q[6];
+    x2 = q[5];
+    x3 = q[4];
+    x4 = q[3];
+    x5 = q[2];
+    x6 = q[1];
+    x7 = q[0];
+
+    /* top linear transformation */
+    y14 = x3 ^ x5;
+    y13 = x0 ^ x6;
+    y9 = x0 ^ x3;
+    y8 = x0 ^ x5;
+    t0 = x1 ^ x2;
+    y1 = t0 ^ x7;
+    y4 = y1 ^ x3;
+    y12 = y13 ^ y14;
+    y2 = y1 ^ x0;
+    y5 = y1 ^ x6;
+    y3 = y5 ^ y8;
+    t1 = x4 ^ y12;
+    y15 = t1 ^ x5;
+    y20 = t1 ^ x1;
+    y6 = y15 ^ x7;
+    y10 = y15 ^ t0;
+    y11 = y20 ^ y9;
+    y7 = x7 ^ y11;
+    y17 = y10 ^ y11;
+    y19 = y10 ^ y8;
+    y16 = t0 ^ y11;
+    y21 = y13 ^ y16;
+    y18 = x0 ^ y16;
+
+    /* non-linear section */
+    t2 = y12 & y15;
+    t3 = y3 & y6;
+    t4 = t3 ^ t2;
+    t5 = y4 & x7;
+    t6 = t5 ^ t2;
+    t7 = y13 & y16;
+    t8 = y5 & y1;
+    t9 = t8 ^ t7;
+    t10 = y2 & y7;
+    t11 = t10 ^ t7;
+    t12 = y9 & y11;
+    t13 = y14 & y17;
+    t14 = t13 ^ t12;
+    t15 = y8 & y10;
+    t16 = t15 ^ t12;
+    t17 = t4 ^ t14;
+    t18 = t6 ^ t16;
+    t19 = t9 ^ t14;
+    t20 = t11 ^ t16;
+    t21 = t17 ^ y20;
+    t22 = t18 ^ y19;
+    t23 = t19 ^ y21;
+    t24 = t20 ^ y18;
+
+    t25 = t21 ^ t22;
+    t26 = t21 & t23;
+    t27 = t24 ^ t26;
+    t28 = t25 & t27;
+    t29 = t28 ^ t22;
+    t30 = t23 ^ t24;
+    t31 = t22 ^ t26;
+    t32 = t31 & t30;
+    t33 = t32 ^ t24;
+    t34 = t23 ^ t33;
+    t35 = t27 ^ t33;
+    t36 = t24 & t35;
+    t37 = t36 ^ t34;
+    t38 = t27 ^ t36;
+    t39 = t29 & t38;
+    t40 = t25 ^ t39;
+
+    t41 = t40 ^ t37;
+    t42 = t29 ^ t33;
+    t43 = t29 ^ t40;
+    t44 = t33 ^ t37;
+    t45 = t42 ^ t41;
+    z0 = t44 & y15;
+    z1 = t37 & y6;
+    z2 = t33 & x7;
+    z3 = t43 & y16;
+    z4 = t40 & y1;
+    z5 = t29 & y7;
+    z6 = t42 & y11;
+    z7 = t45 & y17;
+    z8 = t41 & y10;
+    z9 = t44 & y12;
+    z10 = t37 & y3;
+    z11 = t33 & y4;
+    z12 = t43 & y13;
+    z13 = t40 & y5;
+    z14 = t29 & y2;
+    z15 = t42 & y9;
+    z16 = t45 & y14;
+    z17 = t41 & y8;
+
+    /* bottom linear transformation */
+    t46 = z15 ^ z16;
+    t47 = z10 ^ z11;
+    t48 = z5 ^ z13;
+    t49 = z9 ^ z10;
+    t50 = z2 ^ z12;
+    t51 = z2 ^ z5;
+    t52 = z7 ^ z8;
+    t53 = z0 ^ z3;
+    t54 = z6 ^ z7;
+    t55 = z16 ^ z17;
+    t56 = z12 ^ t48;
+    t57 = t50 ^ t53;
+    t58 = z4 ^ t46;
+    t59 = z3 ^ t54;
+    t60 = t46 ^ t57;
+    t61 = z14 ^ t57;
+    t62 = t52 ^ t58;
+    t63 = t49 ^ t58;
+    t64 = z4 ^ t59;
+    t65 = t61 ^ t62;
+    t66 = z1 ^ t63;
+    s0 = t59 ^ t63;
+    s6 = t56 ^ ~t62;
+    s7 = t48 ^ ~t60;
+    t67 = t64 ^ t65;
+    s3 = t53 ^ t66;
+    s4 = t51 ^ t66;
+    s5 = t47 ^ t65;
+    s1 = t64 ^ ~s3;
+    s2 = t55 ^ ~t67;
+
+    q[7] = s0;
+    q[6] = s1;
+    q[5] = s2;
+    q[4] = s3;
+    q[3] = s4;
+    q[2] = s5;
+    q[1] = s6;
+    q[0] = s7;
+}
+
+/* rotate right by S bits (0 < S < WORD_BITS) */
+#define ROTR(X, S) (((X) >> (S)) | ((X) << (WORD_BITS - (S))))
+
+/* row R of a state word */
+#define ROW(R) ((bitslice_word_t)ROW_MASK << ((R) * ROW_BITS))
+
+/* bits of each row that stay in it when it is rotated right by K bits */
+#define ROWLO(K) ((bitslice_word_t)(ROW_ONES * (ROW_MASK >> (K))))
+
+/* rotate each row right by K bits (0 < K < ROW_BITS) */
+#define ROWROTR(X, K) ((((X) >> (K)) & ROWLO(K)) | (((X) << (ROW_BITS - (K))) & ~ROWLO(K)))
+
+static bitslice_word_t shiftRowsWord(bitslice_word_t x, uint8_t n)
+{
+    bitslice_word_t retval = x;
+
+    /* rotating a row right by COL_BITS moves it left by one column */
+    if((n & 1U) != 0U){
+
+        retval = (retval & ROW(0U))
+            | (ROWROTR(retval, COL_BITS) & ROW(1U))
+            | (ROWROTR(retval, COL_BITS * 2U) & ROW(2U))
+            | (ROWROTR(retval, COL_BITS * 3U) & ROW(3U));
+    }
+
+    if((n & 2U) != 0U){
+
+        retval = (retval & (ROW(0U) | ROW(2U))) | (ROWROTR(retval, COL_BITS * 2U) & (ROW(1U) | ROW(3U)));
+    }
+
+    return retval;
+}
+
+/* row r+1 at column c+m, then row r+2 at column c+2m (rotation and 
+ * ROWROTR() folded together) */
+#define ROW1(X, M) (((M) == 0U) ? ROTR((X), ROW_BITS) : \
+    ((ROTR((X), ROW_BITS + ((M) * COL_BITS)) & ROWLO((M) * COL_BITS)) | (ROTR((X), (M) * COL_BITS) & ~ROWLO((M) * COL_BITS))))
+#define ROW2(X, M) ((((M) & 1U) == 0U) ? ROTR((X), ROW_BITS * 2U) : \
+    ((ROTR((X), (ROW_BITS + COL_BITS) * 2U) & ROWLO(COL_BITS * 2U)) | (ROTR((X), ROW_BITS + (COL_BITS * 2U)) & ~ROWLO(COL_BITS * 2U))))
+
+/* MixColumns for a constant M, where row r+1 of a column is M columns on */
+#define MIXCOLUMNS(Q, M) do{ \
+    bitslice_word_t q0 = (Q)[0], q1 = (Q)[1], q2 = (Q)[2], q3 = (Q)[3]; \
+    bitslice_word_t q4 = (Q)[4], q5 = (Q)[5], q6 = (Q)[6], q7 = (Q)[7]; \
+    bitslice_word_t r0 = ROW1(q0, M), r1 = ROW1(q1, M), r2 = ROW1(q2, M), r3 = ROW1(q3, M); \
+    bitslice_word_t r4 = ROW1(q4, M), r5 = ROW1(q5, M), r6 = ROW1(q6, M), r7 = ROW1(q7, M); \
+    (Q)[0] = q7 ^ r7 ^ r0 ^ ROW2(q0 ^ r0, M); \
+    (Q)[1] = q0 ^ r0 ^ q7 ^ r7 ^ r1 ^ ROW2(q1 ^ r1, M); \
+    (Q)[2] = q1 ^ r1 ^ r2 ^ ROW2(q2 ^ r2, M); \
+    (Q)[3] = q2 ^ r2 ^ q7 ^ r7 ^ r3 ^ ROW2(q3 ^ r3, M); \
+    (Q)[4] = q3 ^ r3 ^ q7 ^ r7 ^ r4 ^ ROW2(q4 ^ r4, M); \
+    (Q)[5] = q4 ^ r4 ^ r5 ^ ROW2(q5 ^ r5, M); \
+    (Q)[6] = q5 ^ r5 ^ r6 ^ ROW2(q6 ^ r6, M); \
+    (Q)[7] = q6 ^ r6 ^ r7 ^ ROW2(q7 ^ r7, M); \
+}while(0)
+
+static void mixColumnsBitslice(bitslice_word_t *q, uint8_t t)
+{
+    /* one expansion per column offset so that the rotations fold */
+    switch(t & 3U){
+    case 1U:
+        MIXCOLUMNS(q, 1U);
+        break;
+    case 2U:
+        MIXCOLUMNS(q, 2U);
+        break;
+    case 3U:
+        MIXCOLUMNS(q, 3U);
+        break;
+    default:
+        MIXCOLUMNS(q, 0U);
+        break;
+    }
+}
+
+static uint32_t subWordBitslice(uint32_t x)
+{
+    bitslice_word_t q[8U];
+    uint8_t i;
+
+    for(i=0U; i < 8U; i++){
+
+        q[i] = x;
+    }
+
+    ortho(q);
+    subBytesBitslice(q);
+    ortho(q);
+
+    return (uint32_t)q[0];
+}
+
+#else
+
+static void initSoft(struct lora_aes_ctx *ctx, const uint8_t *key)
+{
+    uint8_t p;
+    uint8_t j;
+    uint8_t b = 0U;
+    uint8_t swap;
+    uint8_t *k;
+    uint8_t ks;
+    uint8_t i = 1U;
+    
+    static const uint8_t rcon[] PROGMEM = {
+        0x8dU, 0x01U, 0x02U, 0x04U, 0x08U, 0x10U, 0x20U, 0x40U, 0x80U, 0x1bU, 0x36U
+    };
+
+    ctx->r = 10U;
+    b = 176U;
+
+    (void)memcpy(ctx->k, key, 16U);
+    k = ctx->k;    
+    ks = 16U;
+    p = ks;
+
+    /* Rijndael key schedule */
+    while(p < b){
+        
+        swap = k[p - 4U];
+        k[p     ] = SBOX( k[p - 3U] ) ^ k[p      - ks] ^ RCON(i);
+        k[p + 1U] = SBOX( k[p - 2U] ) ^ k[p + 1U - ks];
+        k[p + 2U] = SBOX( k[p - 1U] ) ^ k[p + 2U - ks];
+        k[p + 3U] = SBOX( swap      ) ^ k[p + 3U - ks];
+        p += 4U;
+
+        for(j=0U; j < 12U; j++){
+
+            k[p] = k[p - 4U] ^ k[p - ks];
+            p++;
+        }
+
+        i++;
+    }
+}
+
+#if defined(LORA_AES_TTABLE)
+
+static void encryptSoft(const struct lora_aes_ctx *ctx, uint8_t *s)
+{
+    uint32_t s0;
+    uint32_t s1;
+    uint32_t s2;
+    uint32_t s3;
+    uint32_t t0;
+    uint32_t t1;
+    uint32_t t2;
+    uint32_t t3;
+    uint8_t r;
+    const uint8_t *k = ctx->k;
+
+    /* initial add round key */
+    s0 = GETU32(&s[C1]) ^ GETU32(&k[C1]);
+    s1 = GETU32(&s[C2]) ^ GETU32(&k[C2]);
+    s2 = GETU32(&s[C3]) ^ GETU32(&k[C3]);
+    s3 = GETU32(&s[C4]) ^ GETU32(&k[C4]);
+    
+    k += 16U;
+
+    /* sbox, shiftrows, mix columns and add round key in one pass */
+    for(r = 1U; r < ctx->r; r++){
+
+        t0 = TE0(s0) ^ TE1(s1) ^ TE2(s2) ^ TE3(s3) ^ GETU32(&k[C1]);
+        t1 = TE0(s1) ^ TE1(s2) ^ TE2(s3) ^ TE3(s0) ^ GETU32(&k[C2]);
+        t2 = TE0(s2) ^ TE1(s3) ^ TE2(s0) ^ TE3(s1) ^ GETU32(&k[C3]);
+        t3 = TE0(s3) ^ TE1(s0) ^ TE2(s1) ^ TE3(s2) ^ GETU32(&k[C4]);
+
+        s0 = t0;
+        s1 = t1;
+        s2 = t2;
+        s3 = t3;
+
+        k += 16U;
+    }
+
+    /* final round has no mix columns */
+    t0 = SB0(s0) ^ SB1(s1) ^ SB2(s2) ^ SB3(s3) ^ GETU32(&k[C1]);
+    t1 = SB0(s1) ^ SB1(s2) ^ SB2(s3) ^ SB3(s0) ^ GETU32(&k[C2]);
+    t2 = SB0(s2) ^ SB1(s3) ^ SB2(s0) ^ SB3(s1) ^ GETU32(&k[C3]);
+    t3 = SB0(s3) ^ SB1(s0) ^ SB2(s1) ^ SB3(s2) ^ GETU32(&k[C4]);
+
+    PUTU32(&s[C1], t0);
+    PUTU32(&s[C2], t1);
+    PUTU32(&s[C3], t2);
+    PUTU32(&s[C4], t3);
+}
+
+#else
+
+static void encryptSoft(const struct lora_aes_ctx *ctx, uint8_t *s)
+{
+    uint8_t r;    
+    uint8_t a;
+    uint8_t b;
+    uint8_t c;
+    uint8_t d;    
+    uint8_t i;
+    uint8_t p = 0U;
+    const uint8_t *k = ctx->k;
+
+    /* add round key, sbox and shiftrows */
+    for(r = 0U; r < ctx->r; r++){
+
+        /* add round key, sbox, left shift row */
+
+        /* row 1 */
+        s[C1] = SBOX( s[C1] ^ k[p] );
+        s[C2] = SBOX( s[C2] ^ k[p + C2] );
+        s[C3] = SBOX( s[C3] ^ k[p + C3] );
+        s[C4] = SBOX( s[C4] ^ k[p + C4] );
+
+        /* row 2, left shift 1 */
+        a = SBOX( s[R2] ^ k[p + R2] );
+        s[R2     ] = SBOX( s[R2 + C2] ^ k[p + R2 + C2] );
+        s[R2 + C2] = SBOX( s[R2 + C3] ^ k[p + R2 + C3] );
+        s[R2 + C3] = SBOX( s[R2 + C4] ^ k[p + R2 + C4] );
+        s[R2 + C4] = a;
+
+        /* row 3, left shift 2 */
+        a = SBOX( s[R3     ] ^ k[p + R3] );
+        b = SBOX( s[R3 + C2] ^ k[p + R3 + C2] );
+        s[R3     ] = SBOX( s[R3 + C3] ^ k[p + R3 + C3] );
+        s[R3 + C2] = SBOX( s[R3 + C4] ^ k[p + R3 + C4] );
+        s[R3 + C3] = a;
+        s[R3 + C4] = b;
+
+        /* row 4, left shift 3 */
+        a = SBOX( s[R4 + C4] ^ k[p + R4 + C4] );
+        s[R4 + C4] = SBOX( s[R4 + C3] ^ k[p + R4 + C3] );
+        s[R4 + C3] = SBOX( s[R4 + C2] ^ k[p + R4 + C2] );
+        s[R4 + C2] = SBOX( s[R4     ] ^ k[p + R4     ] );
+        s[R4     ] = a;
+
+        if((r+1U) == ctx->r){
+
+            p += 16U;
+
+            /* final add round key */
+            for(i=0U; i < 16U; i++){
+
+                s[i] ^= ctx->k[p+i];
+            }
+            
+            break;
+        }
+         
+        /* mix columns */
+        for(i=0U; i < 16U; i += 4U){
+
+            a = s[i     ];
+            b = s[i + 1U];
+            c = s[i + 2U];
+            d = s[i + 3U];
+
+            /* 2a + 3b + 1c + 1d 
+             * 1a + 2b + 3c + 1d
+             * 1a + 1b + 2c + 3d
+             * 3a + 1b + 1c + 2d
+             *
+             * */
+            s[i     ] ^= (a ^ b ^ c ^ d) ^ GALOIS_MUL2( (a ^ b) );
+            s[i + 1U] ^= (a ^ b ^ c ^ d) ^ GALOIS_MUL2( (b ^ c) );
+            s[i + 2U] ^= (a ^ b ^ c ^ d) ^ GALOIS_MUL2( (c ^ d) );
+            s[i + 3U] ^= (a ^ b ^ c ^ d) ^ GALOIS_MUL2( (d ^ a) );
+        }
+
+        p += 16U;
+    }   
+}
+
+#endif
+
+static void encryptSoftN(const struct lora_aes_ctx *const *ctx, uint8_t *s, uint8_t n)
+{
+    uint8_t l;
+
+    for(l=0U; l < n; l++){
+
+        encryptSoft(ctx[l], &s[l * AES_BLOCK_SIZE]);
+    }
+}
+
+#endif
+
+#if defined(LORA_AES_HW)
+
+static const struct aes_engine *getEngine(void)
+{
+    static const struct aes_engine soft = {
+        .init = initSoft,
+        .encrypt = encryptSoft,
+        .encryptN = encryptSoftN
+    };
+
+#if defined(AES_HW_X86)
+    static const struct aes_engine hw = {
+        .init = initNI,
+        .encrypt = encryptNI,
+        .encryptN = encryptNIN
+    };
+#elif defined(AES_HW_ARM)
+    static const struct aes_engine hw = {
+        .init = initSoft,
+        .encrypt = encryptCE,
+        .encryptN = encryptCEN
+    };
+#endif
+
+    /* a race here is benign since every caller selects the same engine */
+    static const struct aes_engine *engine = NULL;
+
+    if(engine == NULL){
+
+#if defined(AES_HW_X86)
+        __builtin_cpu_init();
+        engine = (__builtin_cpu_supports("aes") && __builtin_cpu_supports("sse2")) ? &hw : &soft;
+#elif defined(AES_HW_ARM)
+        engine = ((getauxval(AT_HWCAP) & HWCAP_AES) == HWCAP_AES) ? &hw : &soft;
+#else
+        engine = &soft;
+#endif
+    }
+
+    return engine;
+}
+
+#if defined(AES_HW_X86)
+
+/* one step of the AES-128 key schedule, kga is the aeskeygenassist result */
+AES_HW_TARGET static __m128i expandNI(__m128i key, __m128i kga)
+{
+    kga = _mm_shuffle_epi32(kga, 0xff);
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+
+    return _mm_xor_si128(key, kga);
+}
+
+/* aeskeygenassist needs rcon as an immediate */
+#define EXPAND_NI(RK, N, RCON) (RK)[(N)] = expandNI((RK)[(N)-1], _mm_aeskeygenassist_si128((RK)[(N)-1], (RCON)))
+
+AES_HW_TARGET static void initNI(struct lora_aes_ctx *ctx, const uint8_t *key)
+{
+    __m128i rk[11U];
+    uint8_t i;
+
+    rk[0] = _mm_loadu_si128((const __m128i *)key);
+
+    EXPAND_NI(rk, 1, 0x01);
+    EXPAND_NI(rk, 2, 0x02);
+    EXPAND_NI(rk, 3, 0x04);
+    EXPAND_NI(rk, 4, 0x08);
+    EXPAND_NI(rk, 5, 0x10);
+    EXPAND_NI(rk, 6, 0x20);
+    EXPAND_NI(rk, 7, 0x40);
+    EXPAND_NI(rk, 8, 0x80);
+    EXPAND_NI(rk, 9, 0x1b);
+    EXPAND_NI(rk, 10, 0x36);
+
+    /* round keys are stored in the same layout as initSoft produces */
+    for(i=0U; i < 11U; i++){
+
+        _mm_storeu_si128((__m128i *)&ctx->k[i << 4], rk[i]);
+    }
+
+    ctx->r = 10U;
+}
+
+AES_HW_TARGET static void encryptNI(const struct lora_aes_ctx *ctx, uint8_t *s)
+{
+    const __m128i *k = (const __m128i *)ctx->k;
+    __m128i m;
+    uint8_t r;
+
+    m = _mm_xor_si128(_mm_loadu_si128((const __m128i *)s), _mm_loadu_si128(k));
+
+    for(r=1U; r < ctx->r; r++){
+
+        m = _mm_aesenc_si128(m, _mm_loadu_si128(&k[r]));
+    }
+
+    m = _mm_aesenclast_si128(m, _mm_loadu_si128(&k[r]));
+
+    _mm_storeu_si128((__m128i *)s, m);
+}
+
+AES_HW_TARGET static void encryptNIN(const struct lora_aes_ctx *const *ctx, uint8_t *s, uint8_t n)
+{
+    __m128i m0;
+    __m128i m1;
+    __m128i m2;
+    __m128i m3;
+    uint8_t r;
+    uint8_t l;
+
+    if(n == 4U){
+
+        m0 = _mm_xor_si128(_mm_loadu_si128((const __m128i *)&s[0U]), _mm_loadu_si128((const __m128i *)ctx[0]->k));
+        m1 = _mm_xor_si128(_mm_loadu_si128((const __m128i *)&s[16U]), _mm_loadu_si128((const __m128i *)ctx[1]->k));
+        m2 = _mm_xor_si128(_mm_loadu_si128((const __m128i *)&s[32U]), _mm_loadu_si128((const __m128i *)ctx[2]->k));
+        m3 = _mm_xor_si128(_mm_loadu_si128((const __m128i *)&s[48U]), _mm_loadu_si128((const __m128i *)ctx[3]->k));
+
+        /* independent aesenc instructions are issued back to back */
+        for(r=1U; r < ctx[0]->r; r++){
+
+            m0 = _mm_aesenc_si128(m0, _mm_loadu_si128((const __m128i *)&ctx[0]->k[r << 4]));
+            m1 = _mm_aesenc_si128(m1, _mm_loadu_si128((const __m128i *)&ctx[1]->k[r << 4]));
+            m2 = _mm_aesenc_si128(m2, _mm_loadu_si128((const __m128i *)&ctx[2]->k[r << 4]));
+            m3 = _mm_aesenc_si128(m3, _mm_loadu_si128((const __m128i *)&ctx[3]->k[r << 4]));
+        }
+
+        _mm_storeu_si128((__m128i *)&s[0U], _mm_aesenclast_si128(m0, _mm_loadu_si128((const __m128i *)&ctx[0]->k[r << 4])));
+        _mm_storeu_si128((__m128i *)&s[16U], _mm_aesenclast_si128(m1, _mm_loadu_si128((const __m128i *)&ctx[1]->k[r << 4])));
+        _mm_storeu_si128((__m128i *)&s[32U], _mm_aesenclast_si128(m2, _mm_loadu_si128((const __m128i *)&ctx[2]->k[r << 4])));
+        _mm_storeu_si128((__m128i *)&s[48U], _mm_aesenclast_si128(m3, _mm_loadu_si128((const __m128i *)&ctx[3]->k[r << 4])));
+    }
+    else{
+
+        for(l=0U; l < n; l++){
+
+            encryptNI(ctx[l], &s[l * AES_BLOCK_SIZE]);
+        }
+    }
+}
+
+#elif defined(AES_HW_ARM)
+
+AES_HW_TARGET static void encryptCE(const struct lora_aes_ctx *ctx, uint8_t *s)
+{
+    uint8x16_t m = vld1q_u8(s);
+    uint8_t r;
+
+    /* vaeseq_u8 is AddRoundKey, SubBytes and ShiftRows */
+    for(r=0U; r < (ctx->r - 1U); r++){
+
+        m = vaesmcq_u8(vaeseq_u8(m, vld1q_u8(&ctx->k[r << 4])));
+    }
+
+    m = vaeseq_u8(m, vld1q_u8(&ctx->k[r << 4]));
+    m = veorq_u8(m, vld1q_u8(&ctx->k[(r + 1U) << 4]));
+
+    vst1q_u8(s, m);
+}
+
+AES_HW_TARGET static void encryptCEN(const struct lora_aes_ctx *const *ctx, uint8_t *s, uint8_t n)
+{
+    uint8x16_t m0;
+    uint8x16_t m1;
+    uint8x16_t m2;
+    uint8x16_t m3;
+    uint8_t r;
+    uint8_t l;
+
+    if(n == 4U){
+
+        m0 = vld1q_u8(&s[0U]);
+        m1 = vld1q_u8(&s[16U]);
+        m2 = vld1q_u8(&s[32U]);
+        m3 = vld1q_u8(&s[48U]);
+
+        for(r=0U; r < (ctx[0]->r - 1U); r++){
+
+            m0 = vaesmcq_u8(vaeseq_u8(m0, vld1q_u8(&ctx[0]->k[r << 4])));
+            m1 = vaesmcq_u8(vaeseq_u8(m1, vld1q_u8(&ctx[1]->k[r << 4])));
+            m2 = vaesmcq_u8(vaeseq_u8(m2, vld1q_u8(&ctx[2]->k[r << 4])));
+            m3 = vaesmcq_u8(vaeseq_u8(m3, vld1q_u8(&ctx[3]->k[r << 4])));
+        }
+
+        vst1q_u8(&s[0U], veorq_u8(vaeseq_u8(m0, vld1q_u8(&ctx[0]->k[r << 4])), vld1q_u8(&ctx[0]->k[(r + 1U) << 4])));
+        vst1q_u8(&s[16U], veorq_u8(vaeseq_u8(m1, vld1q_u8(&ctx[1]->k[r << 4])), vld1q_u8(&ctx[1]->k[(r + 1U) << 4])));
+        vst1q_u8(&s[32U], veorq_u8(vaeseq_u8(m2, vld1q_u8(&ctx[2]->k[r << 4])), vld1q_u8(&ctx[2]->k[(r + 1U) << 4])));
+        vst1q_u8(&s[48U], veorq_u8(vaeseq_u8(m3, vld1q_u8(&ctx[3]->k[r << 4])), vld1q_u8(&ctx[3]->k[(r + 1U) << 4])));
+    }
+    else{
+
+        for(l=0U; l < n; l++){
+
+            encryptCE(ctx[l], &s[l * AES_BLOCK_SIZE]);
+        }
+    }
+}
+
+#endif
+
+#endif
+
+#endif
@@ -0,0 +1,207 @@
+/* Copyright (c) 2018 Cameron Harper
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * */
+
+/* includes ***********************************************************/
+
+#include "lora_airtime.h"
+#include "lora_mac.h"
+#include "lora_debug.h"
+
+/* defines ************************************************************/
+
+#if defined(LORA_AVR)
+
+    #include <avr/pgmspace.h>
+    
+    #define QUARTER_SYMBOL(SF, BW) pgm_read_dword(&quarterSymbol[(SF)][(BW)])
+    #define RECIPROCAL(M) pgm_read_word(&reciprocal[(M)])
+
+#else
+    
+    #define PROGMEM
+    
+    #define QUARTER_SYMBOL(SF, BW) quarterSymbol[(SF)][(BW)]
+    #define RECIPROCAL(M) reciprocal[(M)]
+    
+#endif
+
+/* Time on air from 4.1.1.7 of the sx1272 datasheet
+ *
+ * Ts = 2^SF / BW
+ * Tpreamble = (Npreamble + 4.25) x Ts
+ * Npayload = 8 + max( ceil[( 8PL - 4SF + 28 + 16CRC - 20IH ) / ( 4(SF - 2DE) )] x (CR + 4), 0 )
+ * Tpacket = Tpreamble + (Npayload x Ts)
+ *
+ * Ts is 2^(SF+3) microseconds at 125KHz, so a quarter of a symbol is a
+ * whole number of microseconds (2^(SF+1) at 125KHz, halved for each
+ * doubling of bandwidth) and time on air is the number of quarter
+ * symbols shifted left. 
+ * 
+ * Ticks are the number of quarter symbols multiplied by the ticks in a 
+ * quarter symbol, which is tabulated in 16.16 fixed point. The table is 
+ * rounded up so that rounding down the product gives the same result 
+ * as rounding down the exact value (the error over the longest frame 
+ * is less than a thirtieth of a tick, and at 100000 ticks per second
+ * the exact value is a multiple of a tenth of a tick).
+ * 
+ * The ceiling division is a multiplication by a tabulated reciprocal
+ * of the denominator (2^RECIPROCAL_SHIFT / 4(SF - 2DE), rounded up), 
+ * which is exact for every numerator a 255 byte frame can produce.
+ * 
+ * */
+
+#define MIN_SF 7U
+#define NUM_SF 6U
+#define NUM_BW 3U
+
+/* smallest SF - 2DE */
+#define MIN_M 5U
+#define NUM_M 8U
+
+#define RECIPROCAL_SHIFT 20U
+
+#define QUARTER_SYMBOL_US_SHIFT(SF, BW) ((SF) + 1U - (BW))
+#define QUARTER_SYMBOL_TICKS(SF, BW) ((uint32_t)(((((uint64_t)LORA_TICKS_PER_SECOND) << (QUARTER_SYMBOL_US_SHIFT(SF, BW) + 16U)) + 999999U) / 1000000U))
+#define RECIPROCAL_OF(D) ((uint16_t)(((1UL << RECIPROCAL_SHIFT) + (D) - 1U) / (D)))
+
+/* static variables ***************************************************/
+
+static const uint32_t quarterSymbol[NUM_SF][NUM_BW] PROGMEM = {
+    {QUARTER_SYMBOL_TICKS(7U, 0U), QUARTER_SYMBOL_TICKS(7U, 1U), QUARTER_SYMBOL_TICKS(7U, 2U)},
+    {QUARTER_SYMBOL_TICKS(8U, 0U), QUARTER_SYMBOL_TICKS(8U, 1U), QUARTER_SYMBOL_TICKS(8U, 2U)},
+    {QUARTER_SYMBOL_TICKS(9U, 0U), QUARTER_SYMBOL_TICKS(9U, 1U), QUARTER_SYMBOL_TICKS(9U, 2U)},
+    {QUARTER_SYMBOL_TICKS(10U, 0U), QUARTER_SYMBOL_TICKS(10U, 1U), QUARTER_SYMBOL_TICKS(10U, 2U)},
+    {QUARTER_SYMBOL_TICKS(11U, 0U), QUARTER_SYMBOL_TICKS(11U, 1U), QUARTER_SYMBOL_TICKS(11U, 2U)},
+    {QUARTER_SYMBOL_TICKS(12U, 0U), QUARTER_SYMBOL_TICKS(12U, 1U), QUARTER_SYMBOL_TICKS(12U, 2U)}
+};
+
+static const uint16_t reciprocal[NUM_M] PROGMEM = {
+    RECIPROCAL_OF(4U * 5U),
+    RECIPROCAL_OF(4U * 6U),
+    RECIPROCAL_OF(4U * 7U),
+    RECIPROCAL_OF(4U * 8U),
+    RECIPROCAL_OF(4U * 9U),
+    RECIPROCAL_OF(4U * 10U),
+    RECIPROCAL_OF(4U * 11U),
+    RECIPROCAL_OF(4U * 12U)
+};
+
+/* static function prototypes *****************************************/
+
+static bool lookup(enum lora_spreading_factor sf, enum lora_signal_bandwidth bw, uint8_t *sfIndex, uint8_t *bwIndex);
+static uint32_t quarterSymbols(uint8_t sf, enum lora_coding_rate cr, uint8_t options, uint8_t size);
+
+/* functions **********************************************************/
+
+uint32_t Airtime_ticks(enum lora_spreading_factor sf, enum lora_signal_bandwidth bw, enum lora_coding_rate cr, uint8_t options, uint8_t size)
+{
+    uint32_t retval = 0U;
+    uint32_t n;
+    uint32_t q;
+    uint8_t sfIndex;
+    uint8_t bwIndex;
+    
+    if(lookup(sf, bw, &sfIndex, &bwIndex)){
+        
+        n = quarterSymbols((uint8_t)sf, cr, options, size);
+        q = QUARTER_SYMBOL(sfIndex, bwIndex);
+        
+        /* split to keep the product in 32 bits */
+        retval = (n * (q >> 16)) + ((n * (q & 0xffffU)) >> 16);
+    }
+    
+    return retval;
+}
+
+uint32_t Airtime_us(enum lora_spreading_factor sf, enum lora_signal_bandwidth bw, enum lora_coding_rate cr, uint8_t options, uint8_t size)
+{
+    uint32_t retval = 0U;
+    uint8_t sfIndex;
+    uint8_t bwIndex;
+    
+    if(lookup(sf, bw, &sfIndex, &bwIndex)){
+        
+        retval = quarterSymbols((uint8_t)sf, cr, options, size) << QUARTER_SYMBOL_US_SHIFT((uint8_t)sf, bwIndex);
+    }
+    
+    return retval;
+}
+
+bool Airtime_lowDataRateOptimize(enum lora_spreading_factor sf, enum lora_signal_bandwidth bw)
+{
+    uint8_t sfIndex;
+    uint8_t bwIndex;
+    
+    /* symbol period is 2^(SF+3-BW) microseconds */
+    return lookup(sf, bw, &sfIndex, &bwIndex) && ((((uint32_t)1U) << ((uint8_t)sf + 3U - bwIndex)) >= 16000UL);
+}
+
+/* static functions ***************************************************/
+
+static bool lookup(enum lora_spreading_factor sf, enum lora_signal_bandwidth bw, uint8_t *sfIndex, uint8_t *bwIndex)
+{
+    bool retval = true;
+    
+    switch(bw){
+    case BW_125:
+        *bwIndex = 0U;
+        break;
+    case BW_250:
+        *bwIndex = 1U;
+        break;
+    case BW_500:
+        *bwIndex = 2U;
+        break;
+    default:
+        retval = false;
+        break;
+    }
+    
+    if(((uint8_t)sf < MIN_SF) || ((uint8_t)sf >= (MIN_SF + NUM_SF))){
+        
+        retval = false;
+    }
+    else{
+        
+        *sfIndex = (uint8_t)sf - MIN_SF;
+    }
+    
+    return retval;
+}
+
+static uint32_t quarterSymbols(uint8_t sf, enum lora_coding_rate cr, uint8_t options, uint8_t size)
+{
+    uint8_t m = sf - (((options & LORA_AIRTIME_LDRO) != 0U) ? 2U : 0U);
+    uint32_t numerator = (8U * (uint32_t)size) + 28U + (((options & LORA_AIRTIME_CRC) != 0U) ? 16U : 0U);
+    uint32_t subtract = (4U * (uint32_t)sf) + (((options & LORA_AIRTIME_IMPLICIT_HEADER) != 0U) ? 20U : 0U);
+    uint32_t blocks = 0U;
+    
+    LORA_PEDANTIC((cr >= CR_5) && (cr <= CR_8))
+    
+    if(numerator > subtract){
+        
+        /* ceil((numerator - subtract) / 4m) */
+        blocks = ((numerator - subtract + (4U * (uint32_t)m) - 1U) * RECIPROCAL(m - MIN_M)) >> RECIPROCAL_SHIFT;
+    }
+    
+    /* preamble and sync word are 4.25 symbols longer than the programmed preamble */
+    return (4U * LORA_AIRTIME_PREAMBLE) + 17U + (4U * (8U + (blocks * ((uint32_t)cr + 4U))));
+}
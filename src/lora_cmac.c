@@ -25,6 +25,7 @@
 
 #include "lora_aes.h"
 #include "lora_cmac.h"
+#include "lora_block.h"
 #include "lora_debug.h"
 
 #include <string.h>
@@ -33,27 +34,26 @@
 /* defines ************************************************************/
 
 #define BLOCK_SIZE  16U
-#define LSB         0x01U
-#define MSB         0x80U
 
-/* static function prototypes *****************************************/
+#ifndef LORA_DEVICE
+/* messages processed together by LoraCMAC_batch */
+#define BATCH_LANES 8U
+#endif
 
-/**
- * XOR an aligned AES block (may be aliased)
- *
- * @param[out] acc accumulator
- * @param[in] mask XORed with accumulator
- *
- * */
-static void xor128(uint8_t *acc, const uint8_t *mask);
+/* static function prototypes *****************************************/
 
 /**
- * left shift (by one bit) a 128bit vector
- *
- * @param[in/out] v vector to shift
- *
+ * Get block `r` of a batch message (with padding and subkey applied if last)
+ * 
+ * @param[in] item
+ * @param[in] r block index
+ * @param[in] blocks number of blocks in message
+ * @param[out] m 16 byte block
+ * 
  * */
-static void leftShift128(uint8_t *v);
+#ifndef LORA_DEVICE
+static void getBatchBlock(const struct lora_cmac_batch *item, size_t r, size_t blocks, uint8_t *m);
+#endif
 
 /* functions  *********************************************************/
 
@@ -66,6 +66,41 @@ void LoraCMAC_init(struct lora_cmac_ctx *ctx, const struct lora_aes_ctx *aes_ctx
     ctx->aes_ctx = aes_ctx;
 }
 
+void LoraCMAC_initSubkeys(struct lora_cmac_subkeys *subkeys, const struct lora_aes_ctx *aes_ctx)
+{
+    LORA_PEDANTIC(subkeys != NULL)
+    LORA_PEDANTIC(aes_ctx != NULL)
+    
+    uint8_t k[BLOCK_SIZE];
+    
+    (void)memset(k, 0, sizeof(k));
+    LoraAES_encrypt(aes_ctx, k);
+    
+    (void)memcpy(subkeys->k1, k, sizeof(subkeys->k1));
+    LoraBlock_leftShift128(subkeys->k1);
+
+    if((k[0] & 0x80U) == 0x80U){
+
+        subkeys->k1[15] ^= 0x87U;
+    }
+
+    (void)memcpy(subkeys->k2, subkeys->k1, sizeof(subkeys->k2));
+    LoraBlock_leftShift128(subkeys->k2);
+
+    if((subkeys->k1[0] & 0x80U) == 0x80U){
+
+        subkeys->k2[15] ^= 0x87U;
+    }
+}
+
+void LoraCMAC_initWithSubkeys(struct lora_cmac_ctx *ctx, const struct lora_aes_ctx *aes_ctx, const struct lora_cmac_subkeys *subkeys)
+{
+    LORA_PEDANTIC(subkeys != NULL)
+    
+    LoraCMAC_init(ctx, aes_ctx);
+    ctx->subkeys = subkeys;
+}
+
 void LoraCMAC_update(struct lora_cmac_ctx *ctx, const void *data, uint8_t len)
 {
     LORA_PEDANTIC(ctx != NULL)
@@ -84,7 +119,7 @@ void LoraCMAC_update(struct lora_cmac_ctx *ctx, const void *data, uint8_t len)
             /* sometimes a whole extra block will already be cached, process it */
             if((part == 0U) && (ctx->size > 0U)){
                 
-                xor128(ctx->x, ctx->m);
+                LoraBlock_xor128(ctx->x, ctx->m);
                 LoraAES_encrypt(ctx->aes_ctx, ctx->x);
             }
 
@@ -106,7 +141,7 @@ void LoraCMAC_update(struct lora_cmac_ctx *ctx, const void *data, uint8_t len)
 
                 part = 0U;
 
-                xor128(ctx->x, ctx->m);
+                LoraBlock_xor128(ctx->x, ctx->m);
                 LoraAES_encrypt(ctx->aes_ctx, ctx->x);                
             }
         }
@@ -120,34 +155,19 @@ void LoraCMAC_finish(const struct lora_cmac_ctx *ctx, void *out, uint8_t outMax)
 {
     LORA_PEDANTIC(ctx != NULL)
 
-    uint8_t k[BLOCK_SIZE];
-    
-    uint8_t k1[BLOCK_SIZE];
-    uint8_t k2[BLOCK_SIZE];
+    struct lora_cmac_subkeys derived;
+    const struct lora_cmac_subkeys *subkeys = ctx->subkeys;
     
     uint8_t m_last[BLOCK_SIZE];
 
     size_t part;
 
-    /* generate subkeys */
+    /* generate subkeys (unless already done) */
     
-    (void)memset(k, 0, sizeof(k));
-    LoraAES_encrypt(ctx->aes_ctx, k);
+    if(subkeys == NULL){
     
-    (void)memcpy(k1, k, sizeof(k1));
-    leftShift128(k1);
-
-    if((k[0] & 0x80U) == 0x80U){
-
-        k1[15] ^= 0x87U;
-    }
-
-    (void)memcpy(k2, k1, sizeof(k2));
-    leftShift128(k2);
-
-    if((k1[0] & 0x80U) == 0x80U){
-
-        k2[15] ^= 0x87U;
+        LoraCMAC_initSubkeys(&derived, ctx->aes_ctx);
+        subkeys = &derived;
     }
 
     /* process last block (m_last) */
@@ -161,64 +181,131 @@ void LoraCMAC_finish(const struct lora_cmac_ctx *ctx, void *out, uint8_t outMax)
         (void)memcpy(m_last, ctx->m, part);
 
         m_last[part] = 0x80U;
-        xor128(m_last, k2);        
+        LoraBlock_xor128(m_last, subkeys->k2);        
     }
     else{        
 
         (void)memcpy(m_last, ctx->m, sizeof(m_last));
 
-        xor128(m_last, k1);
+        LoraBlock_xor128(m_last, subkeys->k1);
     }
 
-    xor128(m_last, ctx->x);
+    LoraBlock_xor128(m_last, ctx->x);
 
     LoraAES_encrypt(ctx->aes_ctx, m_last);
 
     (void)memcpy(out, m_last, (outMax > sizeof(m_last)) ? sizeof(m_last) : outMax);
 }
 
-/* static functions  **************************************************/
-
-static void leftShift128(uint8_t *v)
+#ifndef LORA_DEVICE
+void LoraCMAC_batch(struct lora_cmac_batch *batch, size_t n)
 {
-    uint8_t t;
-    uint8_t tt;
-    uint8_t carry;
-    uint8_t i;
+    LORA_PEDANTIC((n == 0U) || (batch != NULL))
     
-    carry = 0U;
-
-    for(i=16U; i > 0U; i--){
-
-        t = v[i-1U];
-
-        tt = t;
-        tt <<= 1;
-        tt |= carry;
-
-        carry = ((t & MSB) == MSB) ? LSB : 0x0U;
-        v[i-1U] = tt;
+    const struct lora_aes_ctx *aes_ctx[BATCH_LANES];
+    struct lora_cmac_batch *active[BATCH_LANES];
+    size_t blocks[BATCH_LANES];
+    uint8_t s[BATCH_LANES * BLOCK_SIZE];
+    uint8_t m[BLOCK_SIZE];
+    size_t pos;
+    size_t lanes;
+    size_t maxBlocks;
+    size_t count;
+    size_t total;
+    size_t r;
+    size_t i;
+    
+    for(pos=0U; pos < n; pos += lanes){
+        
+        lanes = ((n - pos) > BATCH_LANES) ? BATCH_LANES : (n - pos);
+        maxBlocks = 0U;
+        
+        for(i=0U; i < lanes; i++){
+            
+            LORA_PEDANTIC(batch[pos + i].aes_ctx != NULL)
+            LORA_PEDANTIC(batch[pos + i].subkeys != NULL)
+            
+            total = ((batch[pos + i].prefix != NULL) ? BLOCK_SIZE : 0U) + batch[pos + i].len;
+            
+            /* an empty message is one padded block */
+            blocks[i] = (total == 0U) ? 1U : ((total + (BLOCK_SIZE - 1U)) / BLOCK_SIZE);
+            maxBlocks = (blocks[i] > maxBlocks) ? blocks[i] : maxBlocks;
+            
+            (void)memset(batch[pos + i].mac, 0, sizeof(batch[pos + i].mac));
+        }
+        
+        /* one block from each message that has one left */
+        for(r=0U; r < maxBlocks; r++){
+            
+            count = 0U;
+            
+            for(i=0U; i < lanes; i++){
+                
+                if(r < blocks[i]){
+                    
+                    active[count] = &batch[pos + i];
+                    aes_ctx[count] = active[count]->aes_ctx;
+                    
+                    getBatchBlock(active[count], r, blocks[i], m);
+                    LoraBlock_xor128(m, active[count]->mac);
+                    (void)memcpy(&s[count * BLOCK_SIZE], m, sizeof(m));
+                    
+                    count++;
+                }
+            }
+            
+            LoraAES_encryptBlocks(aes_ctx, s, count);
+            
+            for(i=0U; i < count; i++){
+                
+                (void)memcpy(active[i]->mac, &s[i * BLOCK_SIZE], sizeof(active[i]->mac));
+            }
+        }
     }
 }
 
-static void xor128(uint8_t *acc, const uint8_t *mask)
+#endif
+
+/* static functions  **************************************************/
+
+#ifndef LORA_DEVICE
+static void getBatchBlock(const struct lora_cmac_batch *item, size_t r, size_t blocks, uint8_t *m)
 {
-    acc[0] ^= mask[0];
-    acc[1] ^= mask[1];
-    acc[2] ^= mask[2];
-    acc[3] ^= mask[3];
-    acc[4] ^= mask[4];
-    acc[5] ^= mask[5];
-    acc[6] ^= mask[6];
-    acc[7] ^= mask[7];
-    acc[8] ^= mask[8];
-    acc[9] ^= mask[9];
-    acc[10] ^= mask[10];
-    acc[11] ^= mask[11];
-    acc[12] ^= mask[12];
-    acc[13] ^= mask[13];
-    acc[14] ^= mask[14];
-    acc[15] ^= mask[15];        
+    size_t part;
+    size_t offset;
+    
+    (void)memset(m, 0, BLOCK_SIZE);
+    
+    if((r == 0U) && (item->prefix != NULL)){
+        
+        (void)memcpy(m, item->prefix, BLOCK_SIZE);
+        part = BLOCK_SIZE;
+    }
+    else{
+        
+        offset = (r * BLOCK_SIZE) - ((item->prefix != NULL) ? BLOCK_SIZE : 0U);
+        part = item->len - offset;
+        part = (part > BLOCK_SIZE) ? BLOCK_SIZE : part;
+        
+        if(part > 0U){
+            
+            (void)memcpy(m, &item->msg[offset], part);
+        }
+    }
+    
+    if(r == (blocks - 1U)){
+        
+        if(part == BLOCK_SIZE){
+            
+            LoraBlock_xor128(m, item->subkeys->k1);
+        }
+        else{
+            
+            m[part] = 0x80U;
+            LoraBlock_xor128(m, item->subkeys->k2);
+        }
+    }
 }
+#endif
 
 #endif
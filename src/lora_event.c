@@ -24,6 +24,116 @@
 #include "lora_system.h"
 #include <string.h>
 
+#if defined(LORA_AVR)
+    #include <util/atomic.h>
+#endif
+
+/* timers and IO events share the 16 bit slot number in event_handle_t */
+#if LORA_EVENT_NUM_TIMERS > 0xff00U
+    #error "LORA_EVENT_NUM_TIMERS is too large"
+#endif
+
+#if LORA_EVENT_NUM_TIMERS < 1U
+    #error "LORA_EVENT_NUM_TIMERS must be at least 1"
+#endif
+
+#if ((LORA_EVENT_QUEUE_SIZE & (LORA_EVENT_QUEUE_SIZE - 1U)) != 0U) || (LORA_EVENT_QUEUE_SIZE > 128U)
+    #error "LORA_EVENT_QUEUE_SIZE must be a power of two no larger than 128"
+#endif
+
+/* slot numbers in a handle start from 1 so that a handle is never EVENT_HANDLE_NONE */
+#define HANDLE(GEN, SLOT) ((((event_handle_t)(GEN)) << 16) | ((event_handle_t)(SLOT) + 1U))
+#define HANDLE_GEN(H) ((uint16_t)((H) >> 16))
+#define HANDLE_SLOT(H) ((size_t)((H) & 0xffffU) - 1U)
+
+/* static variables ***************************************************/
+
+#if defined(LORA_EVENT_VIRTUAL_TIME)
+static uint64_t virtualTime;
+#endif
+
+/* static function prototypes *****************************************/
+
+#if defined(LORA_EVENT_GROUP)
+
+/* reorder a member in its group after its deadline may have changed */
+static void groupUpdate(struct lora_event *self);
+
+/* link a member onto its group `signalled` list (ISR) */
+static void groupSignal(struct lora_event_group *group, struct lora_event *self);
+
+/* take the whole `signalled` list (mainloop) */
+static struct lora_event *groupTakeSignalled(struct lora_event_group *self);
+
+/* peek at the `signalled` list */
+static bool groupIsSignalled(const struct lora_event_group *self);
+
+/* clear a member's `signalled` flag once it has been taken from the list */
+static void groupClearSignalled(struct lora_event *self);
+
+static void groupUp(struct lora_event_group *self, uint16_t pos);
+static void groupDown(struct lora_event_group *self, uint16_t pos);
+
+#else
+
+#define groupUpdate(SELF)
+
+#endif
+
+#if defined(LORA_EVENT_STATS)
+/* count a dispatch in the handler's statistics */
+static void recordStats(struct lora_event *self, event_handler_t handler, uint64_t error);
+#endif
+
+/* read the clock for Event_tick() 
+ * 
+ * @param[in] self
+ * @param[in] first true for the first read of a tick
+ * 
+ * */
+static uint64_t readClock(struct lora_event *self, bool first);
+
+/* read a queue index (acquire) */
+static uint8_t loadIndex(const event_queue_index_t *index);
+
+/* write a queue index (release) */
+static void storeIndex(event_queue_index_t *index, uint8_t value);
+
+/* return a timer to the pool and make handles to it stale */
+static void releaseTimer(struct lora_event *self, struct on_timeout *to);
+
+/* get the pending timer with the earliest deadline (or NULL) */
+static struct on_timeout *peekTimer(const struct lora_event *self);
+
+/* get the next timer to service at `time` (high priority first, or NULL) */
+static struct on_timeout *nextDue(const struct lora_event *self, uint64_t time);
+
+/* add a timer to the pending set */
+static void insertTimer(struct lora_event *self, struct on_timeout *to);
+
+/* remove a timer from the pending set 
+ * 
+ * @retval true timer was pending and has been removed
+ * 
+ * */
+static bool removeTimer(struct lora_event *self, struct on_timeout *to);
+
+/* sorted list of timers */
+static void listInsert(struct on_timeout **head, struct on_timeout *to);
+static bool listRemove(struct on_timeout **head, struct on_timeout *to);
+
+/* pending set of normal priority timers (list or heap) */
+static struct on_timeout *peekNormal(const struct lora_event *self);
+static void insertNormal(struct lora_event *self, struct on_timeout *to);
+static bool removeNormal(struct lora_event *self, struct on_timeout *to);
+
+#if defined(LORA_EVENT_HEAP)
+
+static bool heapBefore(const struct on_timeout *a, const struct on_timeout *b);
+static void heapUp(struct lora_event *self, uint16_t pos);
+static void heapDown(struct lora_event *self, uint16_t pos);
+
+#endif
 
 /* functions **********************************************************/
 
@@ -34,6 +144,7 @@ void Event_init(struct lora_event *self)
     (void)memset(self, 0, sizeof(*self));
     
     self->free = self->pool;
+    self->dispatching = (uint8_t)EVENT_NUM_EVENTS;
 
     for(i=0U; i < sizeof(self->pool)/sizeof(*self->pool)-1U; i++){
         
@@ -43,120 +154,170 @@ void Event_init(struct lora_event *self)
 
 void Event_receive(struct lora_event *self, enum on_input_types type, uint64_t time)
 {
-    if(!self->onInput[type].state){
+    struct on_input_event *e;
+    uint8_t head = loadIndex(&self->queue.head);
+    uint8_t depth;
+#if defined(LORA_EVENT_GROUP)
+    struct lora_event_group *group;
+#endif
+    
+    /* indices run freely and are masked on access */
+    depth = (uint8_t)(head - loadIndex(&self->queue.tail));
     
-        self->onInput[type].time = time;
-        self->onInput[type].state = true;
-    }        
+    if(depth < LORA_EVENT_QUEUE_SIZE){
+        
+        depth++;
+        
+        if(depth > self->queue.highWater){
+            
+            self->queue.highWater = depth;
+        }
+        
+        e = &self->queue.buffer[head & (LORA_EVENT_QUEUE_SIZE - 1U)];
+        
+        e->time = time;
+        e->type = (uint8_t)type;
+        
+        storeIndex(&self->queue.head, head + 1U);
+        
+#if defined(LORA_EVENT_GROUP)
+        group = self->group;
+        
+        if(group != NULL){
+            
+            groupSignal(group, self);
+        }
+#endif
+    }
+    else{
+        
+        self->queue.dropped++;
+    }
 }
 
 void Event_tick(struct lora_event *self)
 {
     uint64_t time;
-    size_t i;
+    uint64_t deadline;
     struct on_timeout to;
-    struct on_timeout *ptr = self->head;
-    struct on_timeout *prev = NULL;
+    struct on_timeout *ptr;
+    struct on_input_event e;
+    event_handler_t handler;
+    void *receiver;
+    uint8_t head;
+    uint8_t tail;
+    
+    self->clockReads = 0U;
+    
+    time = readClock(self, true);
     
     do{
     
-        time = System_time();
-        
         /* timeouts */
-        while((ptr != NULL) && (time >= ptr->time)){
+        for(ptr = nextDue(self, time); ptr != NULL; ptr = nextDue(self, time)){
             
             to = *ptr;
                 
-            if(prev == NULL){
-                
-                self->head = ptr->next;
-            }
-            else{
-                
-                prev->next = ptr->next;                
-            }
-             
-            ptr->next = self->free;
-            self->free = ptr;         
-            ptr = to.next;
-            
-            time = System_time();
+            (void)removeTimer(self, ptr);
+            releaseTimer(self, ptr);
             
+#if defined(LORA_EVENT_STATS)
+            recordStats(self, to.handler, time - to.time);
+#endif
             to.handler(to.receiver, time, time - to.time);        
+            
+#if !defined(LORA_EVENT_BATCH_TIME)
+            /* a high priority timer may have come due while the handler ran */
+            time = readClock(self, false);
+#endif            
         }
         
-        /* io events */
-        for(i=0U; i < sizeof(self->onInput)/sizeof(struct on_input); i++){
+        /* io events in the order received (events nobody is waiting for are discarded) */
+        head = loadIndex(&self->queue.head);
+        tail = loadIndex(&self->queue.tail);
+        
+        while(tail != head){
             
-            if((self->onInput[i].handler != NULL) && self->onInput[i].state){
-                
-                LORA_ASSERT(time >= self->onInput[i].time)
+            e = self->queue.buffer[tail & (LORA_EVENT_QUEUE_SIZE - 1U)];
+            
+            tail++;
+            storeIndex(&self->queue.tail, tail);
+            
+            if((e.type < EVENT_NUM_EVENTS) && (self->onInput[e.type].handler != NULL)){
                 
-                event_handler_t handler = self->onInput[i].handler;
-                self->onInput[i].handler = NULL;
+                handler = self->onInput[e.type].handler;
+                receiver = self->onInput[e.type].receiver;
+                self->onInput[e.type].handler = NULL;
+                self->onInput[e.type].gen++;
                 
-                time = System_time();
+#if defined(LORA_EVENT_BATCH_TIME)
+                /* received after this round sampled the time */
+                if(e.time > time){
+                    
+                    time = readClock(self, false);
+                }
+#else
+                time = readClock(self, false);
+#endif                
+                LORA_ASSERT(time >= e.time)
                 
-                handler(self->onInput[i].receiver, time, time - self->onInput[i].time);       
+#if defined(LORA_EVENT_STATS)
+                recordStats(self, handler, time - e.time);
+#endif
+                self->dispatching = e.type;
+                handler(receiver, time, time - e.time);       
+                self->dispatching = (uint8_t)EVENT_NUM_EVENTS;
             }
         }    
+        
+        deadline = Event_nextDeadline(self);
+        
+#if defined(LORA_EVENT_BATCH_TIME)
+        /* another round without reading the clock if a timer is already due */
+        if((deadline == 0U) || (deadline > time)){
+            
+            time = readClock(self, false);
+        }
+#else
+        time = readClock(self, false);
+#endif
     } 
-    while(Event_intervalUntilNext(self) == 0U);
+    while(deadline <= time);
+    
+    groupUpdate(self);
+}
+
+event_handle_t Event_onTimeout(struct lora_event *self, uint64_t timeout, void *receiver, event_handler_t handler)
+{
+    return Event_onTimeoutWithPriority(self, timeout, EVENT_PRIORITY_NORMAL, receiver, handler);
 }
 
-void *Event_onTimeout(struct lora_event *self, uint64_t timeout, void *receiver, event_handler_t handler)
+event_handle_t Event_onTimeoutWithPriority(struct lora_event *self, uint64_t timeout, enum event_priority priority, void *receiver, event_handler_t handler)
 {
-    void *retval = NULL;
+    event_handle_t retval = EVENT_HANDLE_NONE;
         
     if(self->free != NULL){
 
         struct on_timeout *to = self->free;
-        struct on_timeout *ptr = self->head;
-        struct on_timeout *prev = NULL;
         self->free = self->free->next;
         
         to->time = timeout;
         to->handler = handler;
         to->receiver = receiver;
+        to->priority = (uint8_t)priority;
         to->next = NULL;
         
-        if(ptr == NULL){
-
-            self->head = to;
-        }
-        else{
-
-            while(ptr != NULL){
-
-                if(to->time < ptr->time){
-                    
-                    if(prev == NULL){
-                        
-                        self->head = to;
-                    }
-                    else{
-                        
-                        prev->next = to;                                                        
-                    }
-                    
-                    to->next = ptr;
-
-                    break;
-                }
-                else{
-
-                    prev = ptr;
-                    ptr = ptr->next;
-                    
-                    if(ptr == NULL){
-                        
-                        prev->next = to;
-                    }
-                }
-            }
+        self->timersPending++;
+        
+        if(self->timersPending > self->timersHighWater){
+            
+            self->timersHighWater = self->timersPending;
         }
+        
+        insertTimer(self, to);
+        groupUpdate(self);
 
-        retval = (void *)to;
+        retval = HANDLE(to->gen, EVENT_NUM_EVENTS + (size_t)(to - self->pool));
     }
     else{
         
@@ -167,62 +328,72 @@ void *Event_onTimeout(struct lora_event *self, uint64_t timeout, void *receiver,
     return retval;
 }
 
-void *Event_onInput(struct lora_event *self, enum on_input_types event, void *receiver, event_handler_t handler)
+event_handle_t Event_onInput(struct lora_event *self, enum on_input_types event, void *receiver, event_handler_t handler)
 {
-    self->onInput[event].state = false;
+    uint8_t head;
+    uint8_t tail;
+    
+    /* events of this type already queued were for a previous registration
+     * (unless a handler is asking for the rest of its burst) */
+    head = loadIndex(&self->queue.head);
+    tail = (self->dispatching == (uint8_t)event) ? head : loadIndex(&self->queue.tail);
+    
+    while(tail != head){
+        
+        /* entries between tail and head belong to the consumer */
+        if(self->queue.buffer[tail & (LORA_EVENT_QUEUE_SIZE - 1U)].type == (uint8_t)event){
+            
+            self->queue.buffer[tail & (LORA_EVENT_QUEUE_SIZE - 1U)].type = (uint8_t)EVENT_NUM_EVENTS;
+        }
+        
+        tail++;
+    }
+    
+    /* replaces any previous registration */
+    self->onInput[event].gen++;
+    
     self->onInput[event].handler = handler;
     self->onInput[event].receiver = receiver;
     
-    return (void *)&self->onInput[event];
+    return HANDLE(self->onInput[event].gen, event);
 }
 
-void Event_cancel(struct lora_event *self, void **event)
+void Event_cancel(struct lora_event *self, event_handle_t *event)
 {
-    size_t i;
+    size_t slot;
     
-    if((event != NULL) && (*event != NULL)){
+    if((event != NULL) && (*event != EVENT_HANDLE_NONE)){
         
-        for(i=0U; i < sizeof(self->onInput)/sizeof(struct on_input); i++){
-                
-            if(*event == &self->onInput[i]){
+        slot = HANDLE_SLOT(*event);
+        
+        if(slot < EVENT_NUM_EVENTS){
+            
+            struct on_input *in = &self->onInput[slot];
+            
+            if((in->gen == HANDLE_GEN(*event)) && (in->handler != NULL)){
                 
-                self->onInput[i].handler = NULL;
-                *event = NULL;
-                break;    
-            }            
+                in->handler = NULL;
+                in->gen++;
+            }
         }
-        
-        if(*event != NULL){
+        else if((slot - EVENT_NUM_EVENTS) < EVENT_NUM_TIMERS){
             
-            struct on_timeout *prev = NULL;
-            struct on_timeout *ptr = self->head;
+            struct on_timeout *to = &self->pool[slot - EVENT_NUM_EVENTS];
             
-            while(ptr != NULL){
+            /* generation only matches while the timer is pending */
+            if(to->gen == HANDLE_GEN(*event)){
                 
-                if(*event == ptr){
-                    
-                    if(prev == NULL){
-                        
-                        self->head = ptr->next;                        
-                    }
-                    else{
-                        
-                        prev->next = ptr->next;
-                    }
-                    
-                    ptr->next = self->free;                    
-                    self->free = ptr;
-                    break;
-                }                
-                else{
-                    
-                    prev = ptr;
-                    ptr = ptr->next;
-                }
+                (void)removeTimer(self, to);
+                releaseTimer(self, to);
+                groupUpdate(self);
             }
+        }
+        else{
             
-            *event = NULL;
-        }        
+            LORA_ERROR("invalid event handle")
+        }
+        
+        *event = EVENT_HANDLE_NONE;
     }
 }
 
@@ -230,35 +401,793 @@ uint64_t Event_intervalUntilNext(struct lora_event *self)
 {
     uint64_t retval;
     uint64_t time;
-    size_t i;
+    uint64_t deadline = Event_nextDeadline(self);
+        
+    if(deadline == UINT64_MAX){
+        
+        retval = UINT64_MAX;
+    }
+    else if(deadline == 0U){
+        
+        retval = 0U;
+    }
+    else{
         
-    retval = UINT64_MAX;
+        time = System_time();
+        
+        retval = (deadline > time) ? (deadline - time) : 0U;
+    }
+    
+    return retval;
+}
+
+uint64_t Event_budget(struct lora_event *self)
+{
+    uint64_t retval = UINT64_MAX;
+    uint64_t time;
+    
+    if(self->urgent != NULL){
+        
+        time = System_time();
+        
+        retval = (self->urgent->time > time) ? (self->urgent->time - time) : 0U;
+    }
+    
+    return retval;
+}
+
+uint64_t Event_nextDeadline(const struct lora_event *self)
+{
+    uint64_t retval = UINT64_MAX;
+    const struct on_timeout *next;
+    
+    if(loadIndex(&self->queue.head) != loadIndex(&self->queue.tail)){
+        
+        retval = 0U;
+    }
+    else{
+        
+        /* the earliest timer is always at the front of the lists/heap */
+        next = peekTimer(self);
+        
+        if(next != NULL){
+            
+            retval = next->time;
+        }
+    }
+    
+    return retval;
+}
+
+#if defined(LORA_EVENT_GROUP)
+
+void EventGroup_init(struct lora_event_group *self)
+{
+    (void)memset(self, 0, sizeof(*self));
+}
+
+bool EventGroup_add(struct lora_event_group *self, struct lora_event *event)
+{
+    bool retval = false;
+    
+    if((event->group == NULL) && (self->heapLen < LORA_EVENT_GROUP_SIZE)){
+        
+        event->groupKey = Event_nextDeadline(event);
+        event->groupPos = self->heapLen;
+        event->signalNext = NULL;
+        
+        self->heap[self->heapLen] = event;
+        self->heapLen++;
+        
+        groupUp(self, event->groupPos);
+        
+        /* the ISR may now link this member */
+        event->group = self;
+        
+        retval = true;
+    }
+    
+    return retval;
+}
+
+void EventGroup_remove(struct lora_event_group *self, struct lora_event *event)
+{
+    struct lora_event *ptr;
+    struct lora_event *next;
+    uint16_t pos;
     
-     for(i=0U; i < sizeof(self->onInput)/sizeof(struct on_input); i++){
+    if(event->group == self){
+        
+        event->group = NULL;
+        
+        /* the member may be on the signalled list; take the list and
+         * put the other members back at the front of the heap */
+        for(ptr = groupTakeSignalled(self); ptr != NULL; ptr = next){
             
-        if((self->onInput[i].handler != NULL) && self->onInput[i].state){
+            next = ptr->signalNext;
+            groupClearSignalled(ptr);
+            groupUpdate(ptr);
+        }
+        
+        pos = event->groupPos;
+        self->heapLen--;
+        
+        if(pos < self->heapLen){
             
-            retval = 0U;
-            break;
-        }         
+            self->heap[pos] = self->heap[self->heapLen];
+            self->heap[pos]->groupPos = pos;
+            groupUp(self, pos);
+            groupDown(self, self->heap[pos]->groupPos);
+        }
+    }
+}
+
+void EventGroup_tick(struct lora_event_group *self)
+{
+    struct lora_event *ptr;
+    struct lora_event *next;
+    uint64_t time = System_time();
+    
+    do{
+        
+        for(ptr = groupTakeSignalled(self); ptr != NULL; ptr = next){
+            
+            next = ptr->signalNext;
+            groupClearSignalled(ptr);
+            groupUpdate(ptr);
+        }
+        
+        /* Event_tick() moves the member back into deadline order */
+        while((self->heapLen > 0U) && (self->heap[0]->groupKey <= time)){
+            
+            Event_tick(self->heap[0]);
+        }
+    }
+    while(groupIsSignalled(self));
+}
+
+uint64_t EventGroup_nextDeadline(const struct lora_event_group *self)
+{
+    uint64_t retval = UINT64_MAX;
+    
+    if(groupIsSignalled(self)){
+        
+        retval = 0U;
+    }
+    else if(self->heapLen > 0U){
+        
+        retval = self->heap[0]->groupKey;
+    }
+    
+    return retval;
+}
+
+#endif
+
+#if defined(LORA_EVENT_VIRTUAL_TIME)
+
+uint64_t System_time(void)
+{
+    return virtualTime;
+}
+
+uint32_t System_time32(void)
+{
+    return (uint32_t)virtualTime;
+}
+
+void Event_setTime(uint64_t time)
+{
+    virtualTime = time;
+}
+
+void Event_advance(struct lora_event *self, uint64_t until)
+{
+    uint64_t deadline;
+    
+    for(deadline = Event_nextDeadline(self); deadline <= until; deadline = Event_nextDeadline(self)){
+        
+        if(deadline > virtualTime){
+            
+            virtualTime = deadline;
+        }
+        
+        Event_tick(self);
     }
     
-    if(retval > 0U){
+    if(until > virtualTime){
+        
+        virtualTime = until;
+    }
+}
+
+#if defined(LORA_EVENT_GROUP)
+void EventGroup_advance(struct lora_event_group *self, uint64_t until)
+{
+    uint64_t deadline;
     
-        if(self->head != NULL){
+    for(deadline = EventGroup_nextDeadline(self); deadline <= until; deadline = EventGroup_nextDeadline(self)){
+        
+        if(deadline > virtualTime){
             
-            time = System_time();
+            virtualTime = deadline;
+        }
+        
+        EventGroup_tick(self);
+    }
+    
+    if(until > virtualTime){
+        
+        virtualTime = until;
+    }
+}
+#endif
+
+#endif
+
+#if defined(LORA_EVENT_STATS)
+
+bool Event_getStats(const struct lora_event *self, event_handler_t handler, struct lora_event_stats *stats)
+{
+    bool retval = false;
+    size_t i;
+    
+    for(i=0U; i < LORA_EVENT_STATS_HANDLERS; i++){
+        
+        if((handler != NULL) && (self->stats[i].handler == handler)){
             
-            if(self->head->time > time){
-             
-                retval = self->head->time - time;
-            }
-            else{
-                
-                retval = 0U;
-            }        
+            *stats = self->stats[i].stats;
+            retval = true;
+            break;
         }
     }
     
     return retval;
 }
+
+void Event_clearStats(struct lora_event *self)
+{
+    (void)memset(self->stats, 0, sizeof(self->stats));
+}
+
+#endif
+
+/* static functions ***************************************************/
+
+#if defined(LORA_EVENT_STATS)
+
+static void recordStats(struct lora_event *self, event_handler_t handler, uint64_t error)
+{
+    struct lora_event_stats *stats = NULL;
+    uint32_t late = (error > UINT32_MAX) ? UINT32_MAX : (uint32_t)error;
+    uint8_t bucket;
+    size_t i;
+    
+    for(i=0U; i < LORA_EVENT_STATS_HANDLERS; i++){
+        
+        if(self->stats[i].handler == handler){
+            
+            stats = &self->stats[i].stats;
+            break;
+        }
+        
+        if(self->stats[i].handler == NULL){
+            
+            self->stats[i].handler = handler;
+            stats = &self->stats[i].stats;
+            stats->min = UINT32_MAX;
+            break;
+        }
+    }
+    
+    if(stats != NULL){
+        
+        for(bucket=0U; (bucket < (EVENT_STATS_BUCKETS - 1U)) && ((late >> bucket) != 0U); bucket++);
+        
+        stats->count++;
+        stats->histogram[bucket]++;
+        
+        if(late >= LORA_EVENT_LATE_TICKS){
+            
+            stats->late++;
+        }
+        
+        if(late < stats->min){
+            
+            stats->min = late;
+        }
+        
+        if(late > stats->max){
+            
+            stats->max = late;
+        }
+    }
+}
+
+#endif
+
+static uint64_t readClock(struct lora_event *self, bool first)
+{
+    uint64_t retval;
+    
+#if defined(LORA_EVENT_TIME_DELTA)
+    /* the low bits extend the full time read at the start of the tick */
+    if(first){
+    
+        retval = System_time();
+        self->clockReads++;
+    }
+    else{
+        
+        retval = self->now + (uint32_t)(System_time32() - (uint32_t)self->now);
+    }
+    
+    self->now = retval;
+#else
+    (void)first;
+    
+    retval = System_time();
+    self->clockReads++;
+#endif
+    
+    return retval;
+}
+
+static uint8_t loadIndex(const event_queue_index_t *index)
+{
+#if defined(LORA_EVENT_C11_ATOMICS)
+    return (uint8_t)atomic_load_explicit(index, memory_order_acquire);
+#elif defined(LORA_AVR)
+    uint8_t retval;
+    
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+        
+        retval = *index;
+    }
+    
+    return retval;
+#elif defined(__GNUC__)
+    return __atomic_load_n(index, __ATOMIC_ACQUIRE);
+#else
+    #error "no atomics available for the IO event queue"
+#endif
+}
+
+static void storeIndex(event_queue_index_t *index, uint8_t value)
+{
+#if defined(LORA_EVENT_C11_ATOMICS)
+    atomic_store_explicit(index, value, memory_order_release);
+#elif defined(LORA_AVR)
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+        
+        *index = value;
+    }
+#elif defined(__GNUC__)
+    __atomic_store_n(index, value, __ATOMIC_RELEASE);
+#else
+    #error "no atomics available for the IO event queue"
+#endif
+}
+
+#if defined(LORA_EVENT_GROUP)
+
+static void groupUpdate(struct lora_event *self)
+{
+    struct lora_event_group *group = self->group;
+    uint64_t key;
+    
+    if(group != NULL){
+        
+        key = Event_nextDeadline(self);
+        
+        if(key < self->groupKey){
+            
+            self->groupKey = key;
+            groupUp(group, self->groupPos);
+        }
+        else if(key > self->groupKey){
+            
+            self->groupKey = key;
+            groupDown(group, self->groupPos);
+        }
+        else{
+            
+            /* no change */
+        }
+    }
+}
+
+static void groupSignal(struct lora_event_group *group, struct lora_event *self)
+{
+#if defined(LORA_EVENT_C11_ATOMICS)
+    struct lora_event *head;
+    
+    if(!atomic_exchange_explicit(&self->signalled, true, memory_order_acq_rel)){
+        
+        head = atomic_load_explicit(&group->signalled, memory_order_relaxed);
+        
+        do{
+            
+            self->signalNext = head;
+        }
+        while(!atomic_compare_exchange_weak_explicit(&group->signalled, &head, self, memory_order_release, memory_order_relaxed));
+    }
+#elif defined(LORA_AVR)
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+        
+        if(!self->signalled){
+            
+            self->signalled = true;
+            self->signalNext = group->signalled;
+            group->signalled = self;
+        }
+    }
+#elif defined(__GNUC__)
+    struct lora_event *head;
+    
+    if(!__atomic_exchange_n(&self->signalled, true, __ATOMIC_ACQ_REL)){
+        
+        head = __atomic_load_n(&group->signalled, __ATOMIC_RELAXED);
+        
+        do{
+            
+            self->signalNext = head;
+        }
+        while(!__atomic_compare_exchange_n(&group->signalled, &head, self, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+    }
+#else
+    #error "no atomics available for the event group"
+#endif
+}
+
+static struct lora_event *groupTakeSignalled(struct lora_event_group *self)
+{
+#if defined(LORA_EVENT_C11_ATOMICS)
+    return atomic_exchange_explicit(&self->signalled, NULL, memory_order_acquire);
+#elif defined(LORA_AVR)
+    struct lora_event *retval;
+    
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+        
+        retval = self->signalled;
+        self->signalled = NULL;
+    }
+    
+    return retval;
+#elif defined(__GNUC__)
+    return __atomic_exchange_n(&self->signalled, NULL, __ATOMIC_ACQUIRE);
+#else
+    #error "no atomics available for the event group"
+#endif
+}
+
+static bool groupIsSignalled(const struct lora_event_group *self)
+{
+#if defined(LORA_EVENT_C11_ATOMICS)
+    /* C11 atomic_load does not take a pointer to const */
+    return atomic_load_explicit((event_group_link_t *)&self->signalled, memory_order_relaxed) != NULL;
+#elif defined(LORA_AVR)
+    bool retval;
+    
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+        
+        retval = (self->signalled != NULL);
+    }
+    
+    return retval;
+#elif defined(__GNUC__)
+    return __atomic_load_n(&self->signalled, __ATOMIC_RELAXED) != NULL;
+#else
+    #error "no atomics available for the event group"
+#endif
+}
+
+static void groupClearSignalled(struct lora_event *self)
+{
+#if defined(LORA_EVENT_C11_ATOMICS)
+    atomic_store_explicit(&self->signalled, false, memory_order_release);
+#elif defined(LORA_AVR)
+    self->signalled = false;
+#elif defined(__GNUC__)
+    __atomic_store_n(&self->signalled, false, __ATOMIC_RELEASE);
+#else
+    #error "no atomics available for the event group"
+#endif
+}
+
+static void groupUp(struct lora_event_group *self, uint16_t pos)
+{
+    struct lora_event *event = self->heap[pos];
+    uint16_t parent;
+    
+    while(pos > 0U){
+        
+        parent = (pos - 1U) / 2U;
+        
+        if(event->groupKey >= self->heap[parent]->groupKey){
+            
+            break;
+        }
+        
+        self->heap[pos] = self->heap[parent];
+        self->heap[pos]->groupPos = pos;
+        pos = parent;
+    }
+    
+    self->heap[pos] = event;
+    event->groupPos = pos;
+}
+
+static void groupDown(struct lora_event_group *self, uint16_t pos)
+{
+    struct lora_event *event = self->heap[pos];
+    uint16_t child;
+    
+    for(;;){
+        
+        child = (2U * pos) + 1U;
+        
+        if(child >= self->heapLen){
+            
+            break;
+        }
+        
+        if(((child + 1U) < self->heapLen) && (self->heap[child + 1U]->groupKey < self->heap[child]->groupKey)){
+            
+            child++;
+        }
+        
+        if(event->groupKey <= self->heap[child]->groupKey){
+            
+            break;
+        }
+        
+        self->heap[pos] = self->heap[child];
+        self->heap[pos]->groupPos = pos;
+        pos = child;
+    }
+    
+    self->heap[pos] = event;
+    event->groupPos = pos;
+}
+
+#endif
+
+static void releaseTimer(struct lora_event *self, struct on_timeout *to)
+{
+    to->gen++;
+    to->next = self->free;
+    self->free = to;
+    self->timersPending--;
+}
+
+static struct on_timeout *peekTimer(const struct lora_event *self)
+{
+    struct on_timeout *retval = peekNormal(self);
+    
+    if((self->urgent != NULL) && ((retval == NULL) || (self->urgent->time < retval->time))){
+        
+        retval = self->urgent;
+    }
+    
+    return retval;
+}
+
+static struct on_timeout *nextDue(const struct lora_event *self, uint64_t time)
+{
+    struct on_timeout *retval = NULL;
+    
+    if((self->urgent != NULL) && (time >= self->urgent->time)){
+        
+        retval = self->urgent;
+    }
+    else{
+        
+        retval = peekNormal(self);
+        
+        if((retval != NULL) && (time < retval->time)){
+            
+            retval = NULL;
+        }
+    }
+    
+    return retval;
+}
+
+static void insertTimer(struct lora_event *self, struct on_timeout *to)
+{
+    if(to->priority == (uint8_t)EVENT_PRIORITY_HIGH){
+        
+        listInsert(&self->urgent, to);
+    }
+    else{
+        
+        insertNormal(self, to);
+    }
+}
+
+static bool removeTimer(struct lora_event *self, struct on_timeout *to)
+{
+    return (to->priority == (uint8_t)EVENT_PRIORITY_HIGH) ? listRemove(&self->urgent, to) : removeNormal(self, to);
+}
+
+static void listInsert(struct on_timeout **head, struct on_timeout *to)
+{
+    struct on_timeout *ptr = *head;
+    struct on_timeout *prev = NULL;
+    
+    /* insert after any timer with the same deadline */
+    while((ptr != NULL) && (to->time >= ptr->time)){
+        
+        prev = ptr;
+        ptr = ptr->next;
+    }
+    
+    to->next = ptr;
+    
+    if(prev == NULL){
+        
+        *head = to;
+    }
+    else{
+        
+        prev->next = to;
+    }
+}
+
+static bool listRemove(struct on_timeout **head, struct on_timeout *to)
+{
+    bool retval = false;
+    struct on_timeout *prev = NULL;
+    struct on_timeout *ptr = *head;
+    
+    while(ptr != NULL){
+        
+        if(ptr == to){
+            
+            if(prev == NULL){
+                
+                *head = ptr->next;                        
+            }
+            else{
+                
+                prev->next = ptr->next;
+            }
+            
+            retval = true;
+            break;
+        }                
+        
+        prev = ptr;
+        ptr = ptr->next;
+    }
+    
+    return retval;
+}
+
+#if defined(LORA_EVENT_HEAP)
+
+static struct on_timeout *peekNormal(const struct lora_event *self)
+{
+    return (self->heapLen > 0U) ? self->heap[0] : NULL;
+}
+
+static void insertNormal(struct lora_event *self, struct on_timeout *to)
+{
+    to->seq = self->seq;
+    self->seq++;
+    
+    to->pos = self->heapLen;
+    self->heap[self->heapLen] = to;
+    self->heapLen++;
+    
+    heapUp(self, to->pos);
+}
+
+static bool removeNormal(struct lora_event *self, struct on_timeout *to)
+{
+    bool retval = false;
+    uint16_t pos = to->pos;
+    
+    /* a timer that is not pending may still hold a stale position */
+    if((pos < self->heapLen) && (self->heap[pos] == to)){
+        
+        self->heapLen--;
+        
+        if(pos < self->heapLen){
+            
+            self->heap[pos] = self->heap[self->heapLen];
+            self->heap[pos]->pos = pos;
+            
+            heapUp(self, pos);
+            heapDown(self, self->heap[pos]->pos);
+        }
+        
+        to->pos = UINT16_MAX;
+        
+        retval = true;
+    }
+    
+    return retval;
+}
+
+static bool heapBefore(const struct on_timeout *a, const struct on_timeout *b)
+{
+    /* seq is compared as a difference so that wrapping is harmless */
+    return (a->time < b->time) || ((a->time == b->time) && ((int32_t)(a->seq - b->seq) < 0));
+}
+
+static void heapUp(struct lora_event *self, uint16_t pos)
+{
+    struct on_timeout *to = self->heap[pos];
+    uint16_t parent;
+    
+    while(pos > 0U){
+        
+        parent = (pos - 1U) >> 1;
+        
+        if(!heapBefore(to, self->heap[parent])){
+            
+            break;
+        }
+        
+        self->heap[pos] = self->heap[parent];
+        self->heap[pos]->pos = pos;
+        pos = parent;
+    }
+    
+    self->heap[pos] = to;
+    to->pos = pos;
+}
+
+static void heapDown(struct lora_event *self, uint16_t pos)
+{
+    struct on_timeout *to = self->heap[pos];
+    uint32_t child;
+    
+    for(;;){
+        
+        child = ((uint32_t)pos << 1) + 1U;
+        
+        if(child >= self->heapLen){
+            
+            break;
+        }
+        
+        if(((child + 1U) < self->heapLen) && heapBefore(self->heap[child + 1U], self->heap[child])){
+            
+            child++;
+        }
+        
+        if(!heapBefore(self->heap[child], to)){
+            
+            break;
+        }
+        
+        self->heap[pos] = self->heap[child];
+        self->heap[pos]->pos = pos;
+        pos = (uint16_t)child;
+    }
+    
+    self->heap[pos] = to;
+    to->pos = pos;
+}
+
+#else
+
+static struct on_timeout *peekNormal(const struct lora_event *self)
+{
+    return self->head;
+}
+
+static void insertNormal(struct lora_event *self, struct on_timeout *to)
+{
+    listInsert(&self->head, to);
+}
+
+static bool removeNormal(struct lora_event *self, struct on_timeout *to)
+{
+    return listRemove(&self->head, to);
+}
+
+#endif
@@ -28,14 +28,38 @@
 
 #include <stdio.h>
 
+/* defines ************************************************************/
+
+#ifndef LORA_DEVICE
+/* frames handed to LoraCMAC_batch at once */
+#define FRAME_MIC_LANES 8U
+#endif
+
+/* keys for decode() (NULL if the caller does not have them) */
+struct decode_keys {
+    
+    const struct lora_aes_ctx *appKey;
+    const struct lora_cmac_subkeys *appKeySubkeys;
+    const struct lora_aes_ctx *nwkSKey;
+    const struct lora_cmac_subkeys *nwkSKeySubkeys;
+    const struct lora_aes_ctx *appSKey;
+};
+
 /* static function prototypes *****************************************/
 
-static void cipherData(enum lora_frame_type type, const uint8_t *key, uint32_t devAddr, uint16_t counter, uint8_t *data, size_t len);
+static size_t putData(enum lora_frame_type type, const struct lora_aes_ctx *nwkSKey, const struct lora_cmac_subkeys *nwkSKeySubkeys, const struct lora_aes_ctx *appSKey, const struct lora_frame_data *f, void *out, size_t max);
+static size_t putJoinRequest(const struct lora_aes_ctx *appKey, const struct lora_cmac_subkeys *appKeySubkeys, const struct lora_frame_join_request *f, void *out, size_t max);
+static bool decode(const struct decode_keys *keys, void *in, size_t len, struct lora_frame *f);
 
-static uint32_t cmacData(enum lora_frame_type type, const uint8_t *key, uint32_t devAddr, uint16_t counter, const uint8_t *msg, size_t len);
-static uint32_t cmacJoin(const uint8_t *key, const uint8_t *msg, size_t len);
+static void cipherData(enum lora_frame_type type, const struct lora_aes_ctx *key, uint32_t devAddr, uint16_t counter, uint8_t *data, size_t len);
 
-static void xor128(uint8_t *acc, const uint8_t *op);
+static uint32_t cmacData(enum lora_frame_type type, const struct lora_aes_ctx *key, const struct lora_cmac_subkeys *subkeys, uint32_t devAddr, uint16_t counter, const uint8_t *msg, size_t len);
+static uint32_t cmacJoin(const struct lora_aes_ctx *key, const struct lora_cmac_subkeys *subkeys, const uint8_t *msg, size_t len);
+static void initB0(uint8_t *b, enum lora_frame_type type, uint32_t devAddr, uint16_t counter, uint8_t len);
+
+#ifndef LORA_DEVICE
+static bool prepareMIC(const struct lora_frame_mic *frame, struct lora_cmac_batch *item, uint8_t *buffer, const uint8_t **mic);
+#endif
 
 #ifndef LORA_DEVICE
 static size_t getEUI(const uint8_t *in, size_t max, uint8_t *value);
@@ -46,7 +70,7 @@ static size_t getU16(const uint8_t *in, size_t max, uint16_t *value);
 static size_t getU8(const uint8_t *in, size_t max, uint8_t *value);
 static size_t putEUI(uint8_t *out, size_t max, const uint8_t *value);
 static size_t putU32(uint8_t *out, size_t max, uint32_t value);
-#ifndef LORA_DEVICE
+#if !defined(LORA_DEVICE) && !defined(LORA_AES_NO_DECRYPT)
 static size_t putU24(uint8_t *out, size_t max, uint32_t value);
 #endif
 static size_t putU16(uint8_t *out, size_t max, uint16_t value);
@@ -54,68 +78,61 @@ static size_t putU8(uint8_t *out, size_t max, uint8_t value);
 
 /* functions **********************************************************/
 
-size_t Frame_putData(enum lora_frame_type type, const void *nwkSKey, const void *appSKey, const struct lora_frame_data *f, void *out, size_t max)
+void Frame_initKeys(struct lora_frame_keys *keys, const void *appKey, const void *nwkSKey, const void *appSKey)
 {
-    size_t pos = 0U;
-    uint8_t *ptr = (uint8_t *)out;
-    
-    if(f->optsLen <= 0xfU){
-        
-        if((6U + (size_t)f->optsLen + 3U + (size_t)f->dataLen + 4U) <= max){
-
-            pos += putU8(&ptr[pos], max - pos, ((uint8_t)type) << 5);            
-            pos += putU32(&ptr[pos], max - pos, f->devAddr);            
-            pos += putU8(&ptr[pos], max - pos, (f->adr ? 0x80U : 0U) | (f->adrAckReq ? 0x40U : 0U) | (f->ack ? 0x20U : 0U) | (f->pending ? 0x10U : 0U) | (f->optsLen & 0xfU));
-            pos += putU16(&ptr[pos], max - pos, f->counter);            
-            (void)memcpy(&ptr[pos], f->opts, f->optsLen);
-            pos += f->optsLen;
-
-            if(f->data != NULL){
-
-                pos += putU8(&ptr[pos], max - pos, f->port);
-
-                (void)memcpy(&ptr[pos], f->data, f->dataLen);
-                cipherData(type, (f->port == 0U) ? nwkSKey : appSKey, f->devAddr, f->counter, &ptr[pos], f->dataLen);
-                pos += f->dataLen;                                
-            }
+    Frame_initAppKey(keys, appKey);
+    Frame_initSessionKeys(&keys->session, nwkSKey, appSKey);
+}
 
-            pos += putU32(&ptr[pos], max - pos, cmacData(type, nwkSKey, f->devAddr, f->counter, ptr, pos));            
-        }
-        else{
+void Frame_initAppKey(struct lora_frame_keys *keys, const void *appKey)
+{
+    LoraAES_init(&keys->appKey, appKey);
+    LoraCMAC_initSubkeys(&keys->appKeySubkeys, &keys->appKey);
+}
 
-            LORA_INFO("frame size is too large")
-        }
-    }
-    else{
+void Frame_initSessionKeys(struct lora_frame_session_keys *keys, const void *nwkSKey, const void *appSKey)
+{
+    LoraAES_init(&keys->nwkSKey, nwkSKey);
+    LoraCMAC_initSubkeys(&keys->nwkSKeySubkeys, &keys->nwkSKey);
+    LoraAES_init(&keys->appSKey, appSKey);
+}
 
-        LORA_INFO("foptslen must be in range (0..15)")
+size_t Frame_putData(enum lora_frame_type type, const void *nwkSKey, const void *appSKey, const struct lora_frame_data *f, void *out, size_t max)
+{
+    struct lora_aes_ctx nwkSKeyCtx;
+    struct lora_aes_ctx appSKeyCtx;
+    
+    LoraAES_init(&nwkSKeyCtx, nwkSKey);
+    
+    /* appSKey is only needed to encrypt application data */
+    if((f->data != NULL) && (f->port != 0U)){
+        
+        LoraAES_init(&appSKeyCtx, appSKey);
     }
     
-    return pos;
+    return putData(type, &nwkSKeyCtx, NULL, &appSKeyCtx, f, out, max);
+}
+
+size_t Frame_putDataWithKeys(enum lora_frame_type type, const struct lora_frame_session_keys *keys, const struct lora_frame_data *f, void *out, size_t max)
+{
+    return putData(type, &keys->nwkSKey, &keys->nwkSKeySubkeys, &keys->appSKey, f, out, max);
 }
 
 size_t Frame_putJoinRequest(const void *key, const struct lora_frame_join_request *f, void *out, size_t max)
 {
-    size_t pos = 0U;    
-    uint8_t *ptr = (uint8_t *)out;
-    
-    if(max >= 23U){
+    struct lora_aes_ctx ctx;
     
-        pos += putU8(&ptr[pos], max - pos, ((uint8_t)FRAME_TYPE_JOIN_REQ) << 5);
-        pos += putEUI(&ptr[pos], max - pos, f->appEUI);
-        pos += putEUI(&ptr[pos], max - pos, f->devEUI);
-        pos += putU16(&ptr[pos], max - pos, f->devNonce);            
-        pos += putU32(&ptr[pos], max - pos, cmacJoin(key, out, pos));        
-    }
-    else{
-        
-        LORA_INFO("buffer too short for join request message")
-    }
+    LoraAES_init(&ctx, key);
     
-    return pos;
+    return putJoinRequest(&ctx, NULL, f, out, max);
 }
 
-#ifndef LORA_DEVICE
+size_t Frame_putJoinRequestWithKeys(const struct lora_frame_keys *keys, const struct lora_frame_join_request *f, void *out, size_t max)
+{
+    return putJoinRequest(&keys->appKey, &keys->appKeySubkeys, f, out, max);
+}
+
+#if !defined(LORA_DEVICE) && !defined(LORA_AES_NO_DECRYPT)
 size_t Frame_putJoinAccept(const void *key, const struct lora_frame_join_accept *f, void *out, size_t max)
 {
     size_t pos = 0U;    
@@ -143,9 +160,10 @@ size_t Frame_putJoinAccept(const void *key, const struct lora_frame_join_accept
             pos += putU8(&ptr[pos], max - pos, 0U);
         }
         
-        pos += putU32(&ptr[pos], max - pos, cmacJoin(key, ptr, pos));
-    
         LoraAES_init(&aes_ctx, key);
+        
+        pos += putU32(&ptr[pos], max - pos, cmacJoin(&aes_ctx, NULL, ptr, pos));
+    
         LoraAES_decrypt(&aes_ctx, &ptr[1]);
         
         if(f->cfListPresent){
@@ -163,6 +181,194 @@ size_t Frame_putJoinAccept(const void *key, const struct lora_frame_join_accept
 #endif
 
 bool Frame_decode(const void *appKey, const void *nwkSKey, const void *appSKey, void *in, size_t len, struct lora_frame *f)
+{
+    struct decode_keys keys;
+    struct lora_aes_ctx ctx[2U];
+    uint8_t type = (len > 0U) ? (((const uint8_t *)in)[0] >> 5) : 0U;
+    
+    (void)memset(&keys, 0, sizeof(keys));
+    
+    /* expand only the keys this frame needs */
+    if((type == (uint8_t)FRAME_TYPE_JOIN_REQ) || (type == (uint8_t)FRAME_TYPE_JOIN_ACCEPT)){
+        
+        if(appKey != NULL){
+            
+            LoraAES_init(&ctx[0], appKey);
+            keys.appKey = &ctx[0];
+        }
+    }
+    else if((nwkSKey != NULL) && (appSKey != NULL)){
+        
+        LoraAES_init(&ctx[0], nwkSKey);
+        LoraAES_init(&ctx[1], appSKey);
+        keys.nwkSKey = &ctx[0];
+        keys.appSKey = &ctx[1];
+    }
+    
+    return decode(&keys, in, len, f);
+}
+
+bool Frame_decodeWithKeys(const struct lora_frame_keys *keys, void *in, size_t len, struct lora_frame *f)
+{
+    struct decode_keys k;
+    
+    k.appKey = &keys->appKey;
+    k.appKeySubkeys = &keys->appKeySubkeys;
+    k.nwkSKey = &keys->session.nwkSKey;
+    k.nwkSKeySubkeys = &keys->session.nwkSKeySubkeys;
+    k.appSKey = &keys->session.appSKey;
+    
+    return decode(&k, in, len, f);
+}
+
+bool Frame_decodeDataWithKeys(const struct lora_frame_session_keys *keys, void *in, size_t len, struct lora_frame *f)
+{
+    struct decode_keys k;
+    
+    k.appKey = NULL;
+    k.appKeySubkeys = NULL;
+    k.nwkSKey = &keys->nwkSKey;
+    k.nwkSKeySubkeys = &keys->nwkSKeySubkeys;
+    k.appSKey = &keys->appSKey;
+    
+    return decode(&k, in, len, f);
+}
+
+#ifndef LORA_DEVICE
+void Frame_verifyMICs(struct lora_frame_mic *frames, size_t n)
+{
+    LORA_PEDANTIC((n == 0U) || (frames != NULL))
+    
+    struct lora_cmac_batch batch[FRAME_MIC_LANES];
+    struct lora_frame_mic *pending[FRAME_MIC_LANES];
+    const uint8_t *mic[FRAME_MIC_LANES];
+    
+    /* B0 for data frames or the decrypted join accept */
+    uint8_t buffer[FRAME_MIC_LANES][33U];
+    
+    size_t count = 0U;
+    size_t i;
+    size_t j;
+    
+    for(i=0U; i < n; i++){
+        
+        frames[i].valid = false;
+        
+        if(prepareMIC(&frames[i], &batch[count], buffer[count], &mic[count])){
+            
+            pending[count] = &frames[i];
+            count++;
+        }
+        
+        if((count == FRAME_MIC_LANES) || ((count > 0U) && (i == (n - 1U)))){
+            
+            LoraCMAC_batch(batch, count);
+            
+            for(j=0U; j < count; j++){
+                
+                pending[j]->valid = (memcmp(batch[j].mac, mic[j], sizeof(uint32_t)) == 0);
+            }
+            
+            count = 0U;
+        }
+    }
+}
+#endif
+
+#if 0
+// appears to be useless
+size_t Frame_getPhyPayloadSize(size_t dataLen, size_t optsLen)
+{
+    /* MHDR + DevAddr + Fctrl + Fcnt + MIC */
+    return (1U + 4U + 1U + 2U + 4U) + ((dataLen > 0U) ? 1U : 0U) + dataLen + optsLen;
+}
+#endif
+
+bool Frame_isUpstream(enum lora_frame_type type)
+{
+    bool retval;
+    
+    switch(type){
+    case FRAME_TYPE_JOIN_REQ:
+    case FRAME_TYPE_DATA_UNCONFIRMED_UP:
+    case FRAME_TYPE_DATA_CONFIRMED_UP:
+        retval = true;
+        break;
+    case FRAME_TYPE_JOIN_ACCEPT:    
+    case FRAME_TYPE_DATA_UNCONFIRMED_DOWN:    
+    case FRAME_TYPE_DATA_CONFIRMED_DOWN:
+    default:
+        retval = false;
+        break;
+    }
+    
+    return retval;
+}
+
+/* static functions ***************************************************/
+
+static size_t putData(enum lora_frame_type type, const struct lora_aes_ctx *nwkSKey, const struct lora_cmac_subkeys *nwkSKeySubkeys, const struct lora_aes_ctx *appSKey, const struct lora_frame_data *f, void *out, size_t max)
+{
+    size_t pos = 0U;
+    uint8_t *ptr = (uint8_t *)out;
+    
+    if(f->optsLen <= 0xfU){
+        
+        if((6U + (size_t)f->optsLen + 3U + (size_t)f->dataLen + 4U) <= max){
+
+            pos += putU8(&ptr[pos], max - pos, ((uint8_t)type) << 5);            
+            pos += putU32(&ptr[pos], max - pos, f->devAddr);            
+            pos += putU8(&ptr[pos], max - pos, (f->adr ? 0x80U : 0U) | (f->adrAckReq ? 0x40U : 0U) | (f->ack ? 0x20U : 0U) | (f->pending ? 0x10U : 0U) | (f->optsLen & 0xfU));
+            pos += putU16(&ptr[pos], max - pos, f->counter);            
+            (void)memcpy(&ptr[pos], f->opts, f->optsLen);
+            pos += f->optsLen;
+
+            if(f->data != NULL){
+
+                pos += putU8(&ptr[pos], max - pos, f->port);
+
+                (void)memcpy(&ptr[pos], f->data, f->dataLen);
+                cipherData(type, (f->port == 0U) ? nwkSKey : appSKey, f->devAddr, f->counter, &ptr[pos], f->dataLen);
+                pos += f->dataLen;                                
+            }
+
+            pos += putU32(&ptr[pos], max - pos, cmacData(type, nwkSKey, nwkSKeySubkeys, f->devAddr, f->counter, ptr, pos));            
+        }
+        else{
+
+            LORA_INFO("frame size is too large")
+        }
+    }
+    else{
+
+        LORA_INFO("foptslen must be in range (0..15)")
+    }
+    
+    return pos;
+}
+
+static size_t putJoinRequest(const struct lora_aes_ctx *appKey, const struct lora_cmac_subkeys *appKeySubkeys, const struct lora_frame_join_request *f, void *out, size_t max)
+{
+    size_t pos = 0U;    
+    uint8_t *ptr = (uint8_t *)out;
+    
+    if(max >= 23U){
+    
+        pos += putU8(&ptr[pos], max - pos, ((uint8_t)FRAME_TYPE_JOIN_REQ) << 5);
+        pos += putEUI(&ptr[pos], max - pos, f->appEUI);
+        pos += putEUI(&ptr[pos], max - pos, f->devEUI);
+        pos += putU16(&ptr[pos], max - pos, f->devNonce);            
+        pos += putU32(&ptr[pos], max - pos, cmacJoin(appKey, appKeySubkeys, out, pos));        
+    }
+    else{
+        
+        LORA_INFO("buffer too short for join request message")
+    }
+    
+    return pos;
+}
+
+static bool decode(const struct decode_keys *keys, void *in, size_t len, struct lora_frame *f)
 {
     static const enum lora_frame_type types[] = {
         FRAME_TYPE_JOIN_REQ,
@@ -175,7 +381,7 @@ bool Frame_decode(const void *appKey, const void *nwkSKey, const void *appSKey,
 
     uint8_t *ptr = (uint8_t *)in;
     size_t pos = 0U;
-    uint32_t mic;        
+    uint32_t mic = 0U;        
     bool retval = false;
 
     (void)memset(f, 0, sizeof(*f));
@@ -198,6 +404,10 @@ bool Frame_decode(const void *appKey, const void *nwkSKey, const void *appSKey,
             
             LORA_INFO("unknown frame type")
         }
+        else if((((tag >> 5) == (uint8_t)FRAME_TYPE_JOIN_REQ) || ((tag >> 5) == (uint8_t)FRAME_TYPE_JOIN_ACCEPT)) ? (keys->appKey == NULL) : (keys->nwkSKey == NULL)){
+            
+            LORA_INFO("no key for frame type")
+        }
         else{
 
             f->type = types[(tag >> 5)];
@@ -216,7 +426,7 @@ bool Frame_decode(const void *appKey, const void *nwkSKey, const void *appSKey,
                     pos += getU16(&ptr[pos], len - pos, &f->fields.joinRequest.devNonce);
                     pos += getU32(&ptr[pos], len - pos, &mic);
                     
-                    f->valid = (mic == cmacJoin(appKey, ptr, pos - sizeof(mic)));                    
+                    f->valid = (mic == cmacJoin(keys->appKey, keys->appKeySubkeys, ptr, pos - sizeof(mic)));                    
                     
                     retval = true;
                 }
@@ -232,13 +442,11 @@ bool Frame_decode(const void *appKey, const void *nwkSKey, const void *appSKey,
                 if(((len-pos) == 16U) || ((len-pos) == 32U)){
                     
                     uint8_t dlSettings = 0U;
-                    struct lora_aes_ctx aes_ctx;   
                                  
-                    LoraAES_init(&aes_ctx, appKey);
-                    LoraAES_encrypt(&aes_ctx, &ptr[pos]);
+                    LoraAES_encrypt(keys->appKey, &ptr[pos]);
                     if((len-pos) == 32U){                        
                         
-                        LoraAES_encrypt(&aes_ctx, &ptr[pos+16U]);
+                        LoraAES_encrypt(keys->appKey, &ptr[pos+16U]);
                     }
                     
                     pos += getU24(&ptr[pos], len - pos, &f->fields.joinAccept.appNonce);
@@ -268,7 +476,7 @@ bool Frame_decode(const void *appKey, const void *nwkSKey, const void *appSKey,
                     
                     pos += getU32(&ptr[pos], len - pos, &mic);
                     
-                    f->valid = (mic == cmacJoin(appKey, ptr, pos - sizeof(mic)));                    
+                    f->valid = (mic == cmacJoin(keys->appKey, keys->appKeySubkeys, ptr, pos - sizeof(mic)));                    
                     
                     retval = true;
                 }
@@ -286,7 +494,7 @@ bool Frame_decode(const void *appKey, const void *nwkSKey, const void *appSKey,
                 if((len-pos) >= (4U + 1U + 2U + 4U)){
             
                     uint8_t fhdr = 0U;
-                    const uint8_t *key;
+                    const struct lora_aes_ctx *key;
 
                     pos += getU32(&ptr[pos], len - pos, &f->fields.data.devAddr);
                     pos += getU8(&ptr[pos], len - pos, &fhdr);
@@ -316,14 +524,14 @@ bool Frame_decode(const void *appKey, const void *nwkSKey, const void *appSKey,
                         
                         pos += getU32(&ptr[pos], len - pos, &mic);
                         
-                        key = ((f->fields.data.data != NULL) && (f->fields.data.port != 0U)) ? appSKey : nwkSKey;
+                        key = ((f->fields.data.data != NULL) && (f->fields.data.port != 0U)) ? keys->appSKey : keys->nwkSKey;
                         
-                        f->valid = (cmacData(f->type, nwkSKey, f->fields.data.devAddr, f->fields.data.counter, ptr, pos - sizeof(mic)) == mic);
+                        f->valid = (cmacData(f->type, keys->nwkSKey, keys->nwkSKeySubkeys, f->fields.data.devAddr, f->fields.data.counter, ptr, pos - sizeof(mic)) == mic);
                         
                         cipherData(f->type, key, f->fields.data.devAddr, f->fields.data.counter, &ptr[pos - f->fields.data.dataLen - sizeof(mic)], f->fields.data.dataLen);
         
                         /* see spec 4.3.1.6 Frame options (FOptsLen in FCtrl, FOpts) */
-                        if((f->fields.data.optsLen == 0U) || ((f->fields.data.data != NULL) && (f->fields.data.port > 0U))){
+                        if((f->fields.data.optsLen == 0U) || (f->fields.data.data == NULL) || (f->fields.data.port > 0U)){
                                         
                             retval = true;
                         }
@@ -349,48 +557,9 @@ bool Frame_decode(const void *appKey, const void *nwkSKey, const void *appSKey,
     return retval;
 }
 
-#if 0
-// appears to be useless
-size_t Frame_getPhyPayloadSize(size_t dataLen, size_t optsLen)
-{
-    /* MHDR + DevAddr + Fctrl + Fcnt + MIC */
-    return (1U + 4U + 1U + 2U + 4U) + ((dataLen > 0U) ? 1U : 0U) + dataLen + optsLen;
-}
-#endif
-
-bool Frame_isUpstream(enum lora_frame_type type)
-{
-    bool retval;
-    
-    switch(type){
-    case FRAME_TYPE_JOIN_REQ:
-    case FRAME_TYPE_DATA_UNCONFIRMED_UP:
-    case FRAME_TYPE_DATA_CONFIRMED_UP:
-        retval = true;
-        break;
-    case FRAME_TYPE_JOIN_ACCEPT:    
-    case FRAME_TYPE_DATA_UNCONFIRMED_DOWN:    
-    case FRAME_TYPE_DATA_CONFIRMED_DOWN:
-    default:
-        retval = false;
-        break;
-    }
-    
-    return retval;
-}
-
-/* static functions ***************************************************/
-
-static void cipherData(enum lora_frame_type type, const uint8_t *key, uint32_t devAddr, uint16_t counter, uint8_t *data, size_t len)
+static void cipherData(enum lora_frame_type type, const struct lora_aes_ctx *key, uint32_t devAddr, uint16_t counter, uint8_t *data, size_t len)
 {
-    struct lora_aes_ctx ctx;
     uint8_t a[16];
-    uint8_t s[16];
-    uint8_t pld[16];
-    size_t k = (len / 16U) + (((len % 16U) != 0U) ? 1U : 0U);
-    size_t i;
-    size_t pos = 0U;
-    size_t size;
 
     a[0] = 1U;
     a[1] = 0U;
@@ -407,56 +576,28 @@ static void cipherData(enum lora_frame_type type, const uint8_t *key, uint32_t d
     a[12] = 0U;
     a[13] = 0U;
     a[14] = 0U;
-    a[15] = 0U;
-
-    LoraAES_init(&ctx, key);
-
-    for(i=0; i < k; i++){
-
-        size = (i == (k-1U)) ? (len % sizeof(a)) : sizeof(a);
-
-        xor128(pld, pld);
-        
-        (void)memcpy(pld, &data[pos], size);
-        
-        a[15] = (uint8_t)(i+1U);
-
-        (void)memcpy(s, a, sizeof(s));
-        LoraAES_encrypt(&ctx, s);
+    a[15] = 1U;
 
-        xor128(pld, s);
-
-        (void)memcpy(&data[pos], pld, size);
-        pos += sizeof(a);
-    }
+    /* block index in a[15] is the low byte of the counter */
+    LoraAES_ctr(key, a, data, len);
 }
 
-static uint32_t cmacData(enum lora_frame_type type, const uint8_t *key, uint32_t devAddr, uint16_t counter, const uint8_t *msg, size_t len)
+static uint32_t cmacData(enum lora_frame_type type, const struct lora_aes_ctx *key, const struct lora_cmac_subkeys *subkeys, uint32_t devAddr, uint16_t counter, const uint8_t *msg, size_t len)
 {
     uint8_t b[16];
-    struct lora_aes_ctx aes_ctx;
     struct lora_cmac_ctx ctx;
     uint32_t mic;
     
-    b[0] = 0x49U;
-    b[1] = 0U;
-    b[2] = 0U;
-    b[3] = 0U;
-    b[4] = 0U;
-    b[5] = (Frame_isUpstream(type) ? 0U : 1U);
-    b[6] = (uint8_t)devAddr;
-    b[7] = (uint8_t)(devAddr >> 8);
-    b[8] = (uint8_t)(devAddr >> 16);
-    b[9] = (uint8_t)(devAddr >> 24);
-    b[10] = (uint8_t)counter;
-    b[11] = (uint8_t)(counter >> 8);
-    b[12] = 0U;
-    b[13] = 0U;
-    b[14] = 0U;
-    b[15] = (uint8_t)len;
+    initB0(b, type, devAddr, counter, (uint8_t)len);
 
-    LoraAES_init(&aes_ctx, key);
-    LoraCMAC_init(&ctx, &aes_ctx);
+    if(subkeys != NULL){
+        
+        LoraCMAC_initWithSubkeys(&ctx, key, subkeys);
+    }
+    else{
+        
+        LoraCMAC_init(&ctx, key);
+    }
     LoraCMAC_update(&ctx, b, sizeof(b));
     LoraCMAC_update(&ctx, msg, len);
     LoraCMAC_finish(&ctx, b, sizeof(mic));
@@ -466,15 +607,20 @@ static uint32_t cmacData(enum lora_frame_type type, const uint8_t *key, uint32_t
     return mic;
 }
 
-static uint32_t cmacJoin(const uint8_t *key, const uint8_t *msg, size_t len)
+static uint32_t cmacJoin(const struct lora_aes_ctx *key, const struct lora_cmac_subkeys *subkeys, const uint8_t *msg, size_t len)
 {
-    struct lora_aes_ctx aes_ctx;
     struct lora_cmac_ctx ctx;    
     uint32_t mic;
     uint8_t b[sizeof(mic)];
 
-    LoraAES_init(&aes_ctx, key);
-    LoraCMAC_init(&ctx, &aes_ctx);
+    if(subkeys != NULL){
+        
+        LoraCMAC_initWithSubkeys(&ctx, key, subkeys);
+    }
+    else{
+        
+        LoraCMAC_init(&ctx, key);
+    }
     LoraCMAC_update(&ctx, msg, len);
     LoraCMAC_finish(&ctx, b, sizeof(mic));
     
@@ -483,25 +629,113 @@ static uint32_t cmacJoin(const uint8_t *key, const uint8_t *msg, size_t len)
     return mic;
 }
 
-static void xor128(uint8_t *acc, const uint8_t *op)
+static void initB0(uint8_t *b, enum lora_frame_type type, uint32_t devAddr, uint16_t counter, uint8_t len)
 {
-    acc[0] ^= op[0];
-    acc[1] ^= op[1];
-    acc[2] ^= op[2];
-    acc[3] ^= op[3];
-    acc[4] ^= op[4];
-    acc[5] ^= op[5];
-    acc[6] ^= op[6];
-    acc[7] ^= op[7];
-    acc[8] ^= op[8];
-    acc[9] ^= op[9];
-    acc[10] ^= op[10];
-    acc[11] ^= op[11];
-    acc[12] ^= op[12];
-    acc[13] ^= op[13];
-    acc[14] ^= op[14];
-    acc[15] ^= op[15];
+    b[0] = 0x49U;
+    b[1] = 0U;
+    b[2] = 0U;
+    b[3] = 0U;
+    b[4] = 0U;
+    b[5] = (Frame_isUpstream(type) ? 0U : 1U);
+    b[6] = (uint8_t)devAddr;
+    b[7] = (uint8_t)(devAddr >> 8);
+    b[8] = (uint8_t)(devAddr >> 16);
+    b[9] = (uint8_t)(devAddr >> 24);
+    b[10] = (uint8_t)counter;
+    b[11] = (uint8_t)(counter >> 8);
+    b[12] = 0U;
+    b[13] = 0U;
+    b[14] = 0U;
+    b[15] = len;
+}
+
+#ifndef LORA_DEVICE
+static bool prepareMIC(const struct lora_frame_mic *frame, struct lora_cmac_batch *item, uint8_t *buffer, const uint8_t **mic)
+{
+    const uint8_t *ptr = (const uint8_t *)frame->in;
+    enum lora_frame_type type;
+    uint32_t devAddr;
+    uint16_t counter;
+    bool retval = false;
+    
+    /* only the MHDR and length are checked, the rest is left to decode */
+    if((frame->len == 0U) || (frame->len > UINT8_MAX) || ((ptr[0] & 0x1fU) != 0U) || ((ptr[0] >> 5) > (uint8_t)FRAME_TYPE_DATA_CONFIRMED_DOWN)){
+        
+        LORA_INFO("not a frame")
+    }
+    else{
+        
+        type = (enum lora_frame_type)(ptr[0] >> 5);
+        
+        item->prefix = NULL;
+        
+        switch(type){
+        default:
+        case FRAME_TYPE_JOIN_REQ:
+        
+            if(frame->len == 23U){
+                
+                item->aes_ctx = &frame->keys->appKey;
+                item->subkeys = &frame->keys->appKeySubkeys;
+                item->msg = ptr;
+                retval = true;
+            }
+            break;
+        
+        case FRAME_TYPE_JOIN_ACCEPT:
+        
+            if((frame->len == 17U) || (frame->len == 33U)){
+                
+                (void)memcpy(buffer, ptr, frame->len);
+                
+                LoraAES_encrypt(&frame->keys->appKey, &buffer[1]);
+                if(frame->len == 33U){
+                    
+                    LoraAES_encrypt(&frame->keys->appKey, &buffer[17]);
+                }
+                
+                item->aes_ctx = &frame->keys->appKey;
+                item->subkeys = &frame->keys->appKeySubkeys;
+                item->msg = buffer;
+                retval = true;
+            }
+            break;
+            
+        case FRAME_TYPE_DATA_UNCONFIRMED_UP:
+        case FRAME_TYPE_DATA_UNCONFIRMED_DOWN:
+        case FRAME_TYPE_DATA_CONFIRMED_UP:
+        case FRAME_TYPE_DATA_CONFIRMED_DOWN:
+        
+            if(frame->len >= (1U + 4U + 1U + 2U + 4U)){
+                
+                (void)getU32(&ptr[1], frame->len - 1U, &devAddr);
+                (void)getU16(&ptr[6], frame->len - 6U, &counter);
+                
+                initB0(buffer, type, devAddr, counter, (uint8_t)(frame->len - sizeof(uint32_t)));
+                
+                item->aes_ctx = &frame->keys->session.nwkSKey;
+                item->subkeys = &frame->keys->session.nwkSKeySubkeys;
+                item->prefix = buffer;
+                item->msg = ptr;
+                retval = true;
+            }
+            break;
+        }
+        
+        if(retval){
+            
+            item->len = (uint8_t)(frame->len - sizeof(uint32_t));
+            *mic = &item->msg[item->len];
+        }
+        else{
+            
+            LORA_INFO("unexpected frame length")
+        }
+    }
+    
+    return retval;
 }
+#endif
 
 static size_t putU8(uint8_t *out, size_t max, uint8_t value)
 {
@@ -531,7 +765,7 @@ static size_t putU16(uint8_t *out, size_t max, uint16_t value)
     return retval;
 }
 
-#ifndef LORA_DEVICE
+#if !defined(LORA_DEVICE) && !defined(LORA_AES_NO_DECRYPT)
 static size_t putU24(uint8_t *out, size_t max, uint32_t value)
 {
     size_t retval = 0U;
@@ -24,10 +24,36 @@
 #include "lora_debug.h"
 #include "lora_aes.h"
 #include "lora_system.h"
+#include "lora_airtime.h"
 #include "lora_mac_commands.h"
+#include "lora_stream.h"
 
 #include <string.h>
 
+#if LORA_EVENT_NUM_TIMERS < LORA_MAC_NUM_TIMERS
+    #error "LORA_EVENT_NUM_TIMERS is smaller than LORA_MAC_NUM_TIMERS"
+#endif
+
+/* largest FOpts field */
+#define FOPTS_MAX 15U
+
+/* LinkADRReq commands in a row are one transaction (see linkADRAdd()) */
+struct link_adr_block {
+    
+    uint8_t mask[(LORA_MAC_MAX_CHANNELS + 7U) / 8U];    /* channels enabled */
+    uint8_t count;                                      /* LinkADRReq in the block */
+    uint8_t rate;
+    uint8_t power;
+    uint8_t nbTrans;
+    bool maskOK;
+};
+
+/* state of the commands in one downlink */
+struct command_state {
+    
+    struct lora_mac *self;
+    struct link_adr_block adr;
+};
 
 /* static function prototypes *****************************************/
 
@@ -38,17 +64,45 @@ static void rxStart(void *receiver, uint64_t time, uint64_t error);
 static void rxReady(void *receiver, uint64_t time, uint64_t error);
 static void rxTimeout(void *receiver, uint64_t time, uint64_t error);
 static void rxFinish(struct lora_mac *self);
+static bool repeatUp(struct lora_mac *self);
 
 static bool collect(struct lora_mac *self, struct lora_frame *frame);
 
+#if !defined(LORA_MAC_NO_KEY_CACHE)
+static const struct lora_frame_session_keys *getKeys(struct lora_mac *self);
+#endif
+
 static void handleCommands(void *receiver, const struct lora_downstream_cmd *cmd);
 static void processCommands(struct lora_mac *self, const uint8_t *data, uint8_t len);
 
+/* add a LinkADRReq to the block */
+static void linkADRAdd(struct lora_mac *self, struct link_adr_block *block, const struct lora_link_adr_req *req);
+
+/* apply the block if every part of it is valid and answer each LinkADRReq */
+static void linkADREnd(struct lora_mac *self, struct link_adr_block *block);
+
+/* count an uplink against ADR_ACK_LIMIT and ADR_ACK_DELAY */
+static void adrUp(struct lora_mac *self, bool ackReq);
+
+/* take the next step to regain connectivity */
+static void adrBackoff(struct lora_mac *self);
+
+/* enable every channel that exists */
+static void resetChannels(struct lora_mac *self);
+
+static bool channelExists(struct lora_mac *self, uint8_t chIndex, uint8_t *minRate, uint8_t *maxRate);
+static void countStat(uint16_t *value);
+
 static bool selectChannel(struct lora_mac *self, uint64_t timeNow, uint8_t rate, uint8_t prevChIndex, uint8_t *chIndex, uint32_t *freq);
 static void registerTime(struct lora_mac *self, uint32_t freq, uint64_t timeNow, uint32_t airTime);
 static void addDefaultChannel(void *receiver, uint8_t chIndex, uint32_t freq, uint8_t minRate, uint8_t maxRate);
 static bool getChannel(struct lora_mac *self, uint8_t chIndex, uint32_t *freq, uint8_t *minRate, uint8_t *maxRate);
-static bool isAvailable(struct lora_mac *self, uint8_t chIndex, uint64_t timeNow, uint8_t rate);
+
+/* get the cached bitmap of unmasked channels that support `rate` */
+static const uint8_t *enabledChannels(struct lora_mac *self, uint8_t rate);
+static void loadChannels(struct lora_mac *self);
+static uint8_t numChannels(struct lora_mac *self);
+static uint8_t countBits(uint8_t value);
 
 static uint64_t timeBase(uint8_t value);
 
@@ -56,6 +110,25 @@ static uint64_t timeNextAvailable(struct lora_mac *self, uint64_t timeNow, uint8
 
 static uint32_t transmitTime(enum lora_signal_bandwidth bw, enum lora_spreading_factor sf, uint8_t size, bool crc);
 
+/* encode a data frame and schedule it (MAC command answers go in FOpts if they fit) */
+static bool dataUp(struct lora_mac *self, enum lora_mac_operation op, uint8_t port, const uint8_t *data, uint8_t len);
+
+/* schedule the next uplink the MAC starts itself if it is idle */
+static void idle(struct lora_mac *self);
+
+/* send MAC command answers that do not fit in FOpts on port 0 */
+static void answerSend(void *receiver, uint64_t time, uint64_t error);
+
+#if defined(LORA_MAC_QUEUE)
+
+/* send the next frame from the uplink queue */
+static void queueSend(void *receiver, uint64_t time, uint64_t error);
+
+/* remove messages from the head of the uplink queue */
+static void queueRemove(struct lora_mac *self, uint8_t count, uint16_t len);
+
+#endif
+
 //static void restoreDefaults(struct lora_mac *self);
 
 /* functions **********************************************************/
@@ -66,6 +139,7 @@ void MAC_init(struct lora_mac *self, void *system, enum lora_region region, stru
     LORA_PEDANTIC(radio != NULL)
     LORA_PEDANTIC(cb != NULL)
     LORA_PEDANTIC(Region_supported(region))
+    LORA_PEDANTIC(Region_numChannels(region) <= LORA_MAC_MAX_CHANNELS)
     
     (void)memset(self, 0, sizeof(*self));
     
@@ -91,63 +165,13 @@ bool MAC_send(struct lora_mac *self, bool confirmed, uint8_t port, const void *d
     
     bool retval = false;
     
-    struct lora_frame_data f;
-    uint8_t nwkSKey[16U];
-    uint8_t appSKey[16U];
-    uint64_t timeNow = System_time();
-    uint8_t maxPayload;
-    
     if(self->status.joined){
     
         if(self->state == IDLE){
         
             if((port > 0U) && (port <= 223U)){
                 
-                if(Region_getPayload(self->region, System_getTXRate(self->system), &maxPayload)){
-                
-                    if(len <= maxPayload){
-                
-                        if(selectChannel(self, timeNow, System_getTXRate(self->system), self->tx.chIndex, &self->tx.chIndex, &self->tx.freq)){
-                    
-                            f.devAddr = System_getDevAddr(self->system);
-                            f.counter = System_incrementUp(self->system);
-                            f.ack = false;
-                            f.adr = false;
-                            f.adrAckReq = false;
-                            f.pending = false;
-                            f.opts = NULL;
-                            f.optsLen = 0U;
-                            f.port = port;
-                            f.data = ((len > 0U) ? (const uint8_t *)data : NULL);
-                            f.dataLen = len;
-                                
-                            System_getNwkSKey(self->system, nwkSKey);                            
-                            System_getAppSKey(self->system, appSKey);
-                            
-                            self->bufferLen = Frame_putData(FRAME_TYPE_DATA_UNCONFIRMED_UP, nwkSKey, appSKey, &f, self->buffer, sizeof(self->buffer));
-                            
-                            (void)Event_onTimeout(&self->events, 0U, self, tx);
-                            
-                            self->state = WAIT_TX;
-                            
-                            self->op = confirmed ? LORA_OP_DATA_CONFIRMED : LORA_OP_DATA_UNCONFIRMED;
-                            
-                            retval = true;                    
-                        }
-                        else{
-                            
-                            LORA_ERROR("no channel available")
-                        }                    
-                    }
-                    else{
-                        
-                        LORA_ERROR("payload too large")
-                    }
-                }
-                else{
-                    
-                    LORA_ERROR("invalid rate");
-                }
+                retval = dataUp(self, confirmed ? LORA_OP_DATA_CONFIRMED : LORA_OP_DATA_UNCONFIRMED, port, (const uint8_t *)data, len);
             }
             else{
                 
@@ -191,12 +215,18 @@ bool MAC_join(struct lora_mac *self)
             
             f.devNonce = self->devNonce;
 
+            /* AppKey is only needed to join so it is not kept expanded */
             self->bufferLen = Frame_putJoinRequest(appKey, &f, self->buffer, sizeof(self->buffer));
             
-            (void)Event_onTimeout(&self->events, 0U, self, tx);
+            (void)Event_onTimeoutWithPriority(&self->events, 0U, EVENT_PRIORITY_HIGH, self, tx);
             
             self->state = WAIT_TX;
             self->op = LORA_OP_JOINING;
+            self->tx.repeats = 0U;
+            
+            /* answers belong to the previous session */
+            self->answersLen = 0U;
+            Event_cancel(&self->events, &self->nextUp);
             
             retval = true;        
         }
@@ -255,6 +285,111 @@ uint64_t MAC_ticksUntilNextEvent(struct lora_mac *self)
     return Event_intervalUntilNext(&self->events);
 }
 
+uint64_t MAC_nextDeadline(const struct lora_mac *self)
+{
+    return Event_nextDeadline(&self->events);
+}
+
+uint64_t MAC_budget(struct lora_mac *self)
+{
+    return Event_budget(&self->events);
+}
+
+#if defined(LORA_EVENT_GROUP)
+bool MAC_attach(struct lora_mac *self, struct lora_event_group *group)
+{
+    return EventGroup_add(group, &self->events);
+}
+
+void MAC_detach(struct lora_mac *self)
+{
+    if(self->events.group != NULL){
+        
+        EventGroup_remove(self->events.group, &self->events);
+    }
+}
+#endif
+
+#if defined(LORA_MAC_QUEUE)
+bool MAC_queue(struct lora_mac *self, bool confirmed, uint8_t port, const void *data, uint8_t len)
+{
+    LORA_PEDANTIC(self != NULL)
+    LORA_PEDANTIC((len == 0) || (data != NULL))
+    
+    bool retval = false;
+    
+    if((port > 0U) && (port <= 223U)){
+        
+        if((self->queue.count < LORA_MAC_QUEUE_DEPTH) && ((LORA_MAC_QUEUE_SIZE - self->queue.used) >= len)){
+            
+            self->queue.msg[self->queue.count].port = port;
+            self->queue.msg[self->queue.count].len = len;
+            self->queue.msg[self->queue.count].confirmed = confirmed;
+            
+            if(len > 0U){
+                
+                (void)memcpy(&self->queue.data[self->queue.used], data, len);
+            }
+            
+            self->queue.count++;
+            self->queue.used += len;
+            
+            idle(self);
+            
+            retval = true;
+        }
+        else{
+            
+            LORA_ERROR("uplink queue is full")
+        }
+    }
+    else{
+        
+        LORA_ERROR("application port must be in range 1..223")
+    }
+    
+    return retval;
+}
+
+uint8_t MAC_queueLength(const struct lora_mac *self)
+{
+    return self->queue.count;
+}
+
+void MAC_clearQueue(struct lora_mac *self)
+{
+    Event_cancel(&self->events, &self->nextUp);
+    
+    self->queue.count = 0U;
+    self->queue.used = 0U;
+    
+    /* answers may still be waiting */
+    idle(self);
+}
+#endif
+
+#if defined(LORA_EVENT_STATS)
+bool MAC_getEventStats(const struct lora_mac *self, enum lora_mac_handler handler, struct lora_event_stats *stats)
+{
+    static const event_handler_t map[] = {
+        tx,
+        txComplete,
+        rxStart,
+        rxReady,
+        rxTimeout
+    };
+    
+    bool retval = false;
+    
+    if((size_t)handler < (sizeof(map)/sizeof(*map))){
+        
+        retval = Event_getStats(&self->events, map[handler], stats);
+    }
+    
+    return retval;
+}
+#endif
+
 bool MAC_setRate(struct lora_mac *self, uint8_t rate)
 {
     bool retval = false;
@@ -281,6 +416,37 @@ bool MAC_setPower(struct lora_mac *self, uint8_t power)
     return retval;    
 }
 
+void MAC_setADR(struct lora_mac *self, bool value)
+{
+    LORA_PEDANTIC(self != NULL)
+    
+    self->status.adr = value;
+    self->adrAckCounter = 0U;
+}
+
+bool MAC_getADR(const struct lora_mac *self)
+{
+    LORA_PEDANTIC(self != NULL)
+    
+    return self->status.adr;
+}
+
+void MAC_getADRStats(const struct lora_mac *self, struct lora_mac_adr_stats *stats)
+{
+    LORA_PEDANTIC(self != NULL)
+    LORA_PEDANTIC(stats != NULL)
+    
+    *stats = self->adrStats;
+    stats->ackCounter = self->adrAckCounter;
+}
+
+void MAC_clearADRStats(struct lora_mac *self)
+{
+    LORA_PEDANTIC(self != NULL)
+    
+    (void)memset(&self->adrStats, 0, sizeof(self->adrStats));
+}
+
 uint64_t MAC_ticksUntilNextChannel(struct lora_mac *self)
 {
     uint64_t timeNow = System_time();
@@ -303,11 +469,18 @@ uint64_t MAC_ticksUntilNextChannel(struct lora_mac *self)
     return retval;
 }
 
+void MAC_reloadChannels(struct lora_mac *self)
+{
+    self->channels.valid = false;
+    self->channels.enabledValid = false;
+}
+
 void MAC_restoreDefaults(struct lora_mac *self)
 {
     LORA_PEDANTIC(self != NULL)
     
     Region_getDefaultChannels(self->region, self->system, addDefaultChannel);    
+    MAC_reloadChannels(self);
         
     System_setRX1DROffset(self->system, Region_getRX1Offset(self->region));
     System_setRX1Delay(self->system, Region_getRX1Delay(self->region));
@@ -319,6 +492,16 @@ void MAC_restoreDefaults(struct lora_mac *self)
     
     System_setTXPower(self->system, Region_getTXPower(self->region));
     System_setTXRate(self->system, Region_getTXRate(self->region));
+    System_setNbTrans(self->system, 1U);
+}
+
+void MAC_reloadKeys(struct lora_mac *self)
+{
+    LORA_PEDANTIC(self != NULL)
+    
+#if !defined(LORA_MAC_NO_KEY_CACHE)    
+    self->status.keysReady = false;
+#endif
 }
 
 /* static functions ***************************************************/
@@ -348,140 +531,317 @@ static uint32_t bwToNumber(enum lora_signal_bandwidth bw)
 }
 #endif
 
-static uint32_t transmitTime(enum lora_signal_bandwidth bw, enum lora_spreading_factor sf, uint8_t size, bool crc)
-{
-    /* from 4.1.1.7 of sx1272 datasheet
-     *
-     * Ts (symbol period)
-     * Rs (symbol rate)
-     * PL (payload length)
-     * SF (spreading factor
-     * CRC (presence of trailing CRC)
-     * IH (presence of implicit header)
-     * DE (presence of data rate optimize)
-     * CR (coding rate 1..4)
-     * 
-     *
-     * Ts = 1 / Rs
-     * Tpreamble = ( Npreamble x 4.25 ) x Tsym
-     *
-     * Npayload = 8 + max( ceil[( 8PL - 4SF + 28 + 16CRC + 20IH ) / ( 4(SF - 2DE) )] x (CR + 4), 0 )
-     *
-     * Tpayload = Npayload x Ts
-     *
-     * Tpacket = Tpreamble + Tpayload
-     *
-     * Implementation details:
-     *
-     * - calculated in microseconds then converted to ticks
-     * 
-     * */
-
-    uint32_t Tpacket = 0U;
-
-    if((bw != BW_FSK) && (sf != SF_FSK)){
-
-        // for now hardcode this according to this recommendation
-        bool lowDataRateOptimize = ((bw == BW_125) && ((sf == SF_11) || (sf == SF_12))) ? true : false;
-        //bool crc = true;    // true for uplink, false for downlink
-        bool header = true; 
-
-        uint32_t Ts = ((1U << sf) * 1000000U) / (uint32_t)bw;     //symbol rate (us)
-        uint32_t Tpreamble = (Ts * 12U) +  (Ts / 4U);   //preamble (us)
-
-        uint32_t numerator = (8U * (uint32_t)size) - (4U * (uint32_t)sf) + 28U + ( crc ? 16U : 0U ) - ( header ? 20U : 0U );
-        uint32_t denom = 4U * ((uint32_t)sf - ( lowDataRateOptimize ? 2U : 0U ));
-
-        uint32_t Npayload = 8U + ((((numerator / denom) + (((numerator % denom) != 0U) ? 1U : 0U)) * ((uint32_t)CR_5 + 4U)));
-
-        uint32_t Tpayload = Npayload * Ts;
-
-        Tpacket = Tpreamble + Tpayload;
-    }
-
-    return Tpacket / (1000000U/LORA_TICKS_PER_SECOND);
-}
-
-static void tx(void *receiver, uint64_t time, uint64_t error)
+static bool dataUp(struct lora_mac *self, enum lora_mac_operation op, uint8_t port, const uint8_t *data, uint8_t len)
 {
-    struct lora_mac *self = (struct lora_mac *)receiver;            
-    
-    LORA_PEDANTIC(receiver != NULL)
-    LORA_PEDANTIC(self->op != LORA_OP_NONE)
-    
-    struct lora_radio_tx_setting radio_setting;
+    bool retval = false;
     
-    if(Region_getRate(self->region, System_getTXRate(self->system), &radio_setting.sf, &radio_setting.bw)){
+    struct lora_frame_data f;
+    uint64_t timeNow = System_time();
+    uint8_t maxPayload;
     
-        radio_setting.freq = self->tx.freq;
-        radio_setting.cr = CR_5;
-        radio_setting.power = System_getTXPower(self->system);
-        radio_setting.preamble = 8U;
-        radio_setting.channel = self->tx.chIndex;
+    if(Region_getPayload(self->region, System_getTXRate(self->system), &maxPayload)){
     
-        LORA_PEDANTIC(self->state == WAIT_TX)
+        if(len <= maxPayload){
     
-        if(Radio_transmit(self->radio, &radio_setting, self->buffer, self->bufferLen)){
-
-            registerTime(self, self->tx.freq, System_time(), transmitTime(radio_setting.bw, radio_setting.sf, self->bufferLen, true));
-            
-            self->state = TX;
+            if(selectChannel(self, timeNow, System_getTXRate(self->system), self->tx.chIndex, &self->tx.chIndex, &self->tx.freq)){
+        
+                f.devAddr = System_getDevAddr(self->system);
+                f.counter = System_incrementUp(self->system);
+                f.ack = false;
+                f.adr = self->status.adr;
+                /* nothing to gain from a request once every step has been taken */
+                f.adrAckReq = self->status.adr && (self->adrAckCounter >= Region_getADRAckLimit(self->region)) && 
+                    ((System_getTXRate(self->system) > 0U) || (System_getTXPower(self->system) != Region_getTXPower(self->region)));
+                f.pending = false;
+                f.opts = NULL;
+                f.optsLen = 0U;
+                f.port = port;
+                f.data = ((len > 0U) ? data : NULL);
+                f.dataLen = len;
+                
+                /* FOpts count towards the maximum payload */
+                if((port > 0U) && (self->answersLen > 0U) && (self->answersLen <= FOPTS_MAX) && (((uint16_t)len + self->answersLen) <= maxPayload)){
+                    
+                    f.opts = self->answers;
+                    f.optsLen = self->answersLen;
+                }
+                    
+#if defined(LORA_MAC_NO_KEY_CACHE)
+                {
+                    uint8_t nwkSKey[16U];
+                    uint8_t appSKey[16U];
+                    
+                    System_getNwkSKey(self->system, nwkSKey);
+                    System_getAppSKey(self->system, appSKey);
+                    
+                    self->bufferLen = Frame_putData(FRAME_TYPE_DATA_UNCONFIRMED_UP, nwkSKey, appSKey, &f, self->buffer, sizeof(self->buffer));
+                }
+#else
+                self->bufferLen = Frame_putDataWithKeys(FRAME_TYPE_DATA_UNCONFIRMED_UP, getKeys(self), &f, self->buffer, sizeof(self->buffer));
+#endif
+                
+                if(f.opts != NULL){
+                    
+                    self->answersLen = 0U;
+                }
+                
+                if(self->status.adr){
+                    
+                    adrUp(self, f.adrAckReq);
+                }
                 
-            (void)Event_onInput(&self->events, EVENT_TX_COMPLETE, self, txComplete);        
+                /* unconfirmed frames are sent NbTrans times unless there is a downlink */
+                self->tx.repeats = 0U;
+                
+                if((op != LORA_OP_DATA_CONFIRMED) && (System_getNbTrans(self->system) > 1U)){
+                    
+                    self->tx.repeats = System_getNbTrans(self->system) - 1U;
+                }
+                
+                (void)Event_onTimeoutWithPriority(&self->events, 0U, EVENT_PRIORITY_HIGH, self, tx);
+                
+                self->state = WAIT_TX;
+                self->op = op;
+                
+                /* anything the MAC was going to send waits until this has finished */
+                Event_cancel(&self->events, &self->nextUp);
+                
+                retval = true;                    
+            }
+            else{
+                
+                LORA_ERROR("no channel available")
+            }                    
         }
         else{
             
-            LORA_INFO("radio rejected parameters")            
-            self->state = IDLE;
+            LORA_ERROR("payload too large")
         }
     }
     else{
         
-        LORA_INFO("invalid rate")            
-        self->state = IDLE;
+        LORA_ERROR("invalid rate");
     }
+    
+    return retval;
 }
 
-static void txComplete(void *receiver, uint64_t time, uint64_t error)
+static void idle(struct lora_mac *self)
 {
-    struct lora_mac *self = (struct lora_mac *)receiver;            
-    
-    LORA_PEDANTIC(receiver != NULL)
-    LORA_PEDANTIC(self->state == TX)
-    LORA_PEDANTIC(self->op != LORA_OP_NONE)
+    event_handler_t handler;
+    uint64_t next;
     
-    uint32_t rx1Time;
+    if((self->state == IDLE) && self->status.joined && (self->nextUp == EVENT_HANDLE_NONE)){
         
-    Radio_sleep(self->radio);
-    
-    self->state = WAIT_RX1;                
-    rx1Time = time + timeBase((self->op == LORA_OP_JOINING) ? Region_getJA1Delay(self->region) : System_getRX1Delay(self->system)) - error;
-
-    (void)Event_onTimeout(&self->events, rx1Time, self, rxStart);    
-    self->rx2Ready = Event_onTimeout(&self->events, rx1Time + timeBase(1U), self, rxStart);
+        if(self->answersLen > FOPTS_MAX){
+            
+            handler = answerSend;
+        }
+#if defined(LORA_MAC_QUEUE)
+        else if(self->queue.count > 0U){
+            
+            handler = queueSend;
+        }
+#endif
+        else{
+            
+            handler = NULL;
+        }
+        
+        if(handler != NULL){
+        
+            next = timeNextAvailable(self, System_time(), System_getTXRate(self->system));
+            
+            if(next != UINT64_MAX){
+                
+                self->nextUp = Event_onTimeout(&self->events, next, self, handler);
+            }
+            else{
+                
+                LORA_ERROR("no channel available")
+            }
+        }
+    }
 }
 
-static void rxStart(void *receiver, uint64_t time, uint64_t error)
+static void answerSend(void *receiver, uint64_t time, uint64_t error)
 {
-    struct lora_mac *self = (struct lora_mac *)receiver;    
+    struct lora_mac *self = (struct lora_mac *)receiver;
+    uint8_t maxPayload;
     
     LORA_PEDANTIC(receiver != NULL)
-    LORA_PEDANTIC((self->state == WAIT_RX1) || (self->state == WAIT_RX2) || (self->state == RX2)||(self->state == RX1))
-    LORA_PEDANTIC(self->op != LORA_OP_NONE)
     
-    struct lora_radio_rx_setting radio_setting;
-    
-    uint8_t rate;
-    uint32_t freq;
+    self->nextUp = EVENT_HANDLE_NONE;
     
-    /* ignore RX2 if it fires while RX1 is active */
-    if(self->state != RX1){
-        
-        #ifndef RX_MARGIN
-        #define RX_MARGIN 100
-        #endif
-       
-        if(error < RX_MARGIN){
+    if(Region_getPayload(self->region, System_getTXRate(self->system), &maxPayload)){
+        
+        if(self->answersLen > maxPayload){
+            
+            LORA_ERROR("MAC command answers too large for rate")
+            self->answersLen = 0U;
+        }
+        else if(dataUp(self, LORA_OP_ANSWER, 0U, self->answers, self->answersLen)){
+            
+            self->answersLen = 0U;
+        }
+        else{
+            
+            /* try again when a channel is available */
+        }
+    }
+    
+    idle(self);
+}
+
+#if defined(LORA_MAC_QUEUE)
+static void queueSend(void *receiver, uint64_t time, uint64_t error)
+{
+    struct lora_mac *self = (struct lora_mac *)receiver;
+    uint8_t maxPayload;
+    uint8_t count = 0U;
+    uint16_t len = 0U;
+    
+    LORA_PEDANTIC(receiver != NULL)
+    LORA_PEDANTIC(self->queue.count > 0U)
+    
+    self->nextUp = EVENT_HANDLE_NONE;
+    
+    if(Region_getPayload(self->region, System_getTXRate(self->system), &maxPayload)){
+        
+        /* consecutive messages for the same port that fit in one frame */
+        while(
+            (count < self->queue.count) && 
+            (self->queue.msg[count].port == self->queue.msg[0].port) &&
+            (self->queue.msg[count].confirmed == self->queue.msg[0].confirmed) &&
+            ((len + self->queue.msg[count].len) <= maxPayload)
+        ){
+            len += self->queue.msg[count].len;
+            count++;
+        }
+        
+        if(count == 0U){
+            
+            LORA_ERROR("queued message too large for rate")
+            queueRemove(self, 1U, self->queue.msg[0].len);
+        }
+        else if(MAC_send(self, self->queue.msg[0].confirmed, self->queue.msg[0].port, self->queue.data, (uint8_t)len)){
+            
+            /* MAC_send() has encoded the frame */
+            queueRemove(self, count, len);
+        }
+        else{
+            
+            /* try again when a channel is available */
+        }
+    }
+    
+    idle(self);
+}
+
+static void queueRemove(struct lora_mac *self, uint8_t count, uint16_t len)
+{
+    (void)memmove(self->queue.msg, &self->queue.msg[count], (size_t)(self->queue.count - count) * sizeof(*self->queue.msg));
+    (void)memmove(self->queue.data, &self->queue.data[len], (size_t)(self->queue.used - len));
+    
+    self->queue.count -= count;
+    self->queue.used -= len;
+}
+#endif
+
+static uint32_t transmitTime(enum lora_signal_bandwidth bw, enum lora_spreading_factor sf, uint8_t size, bool crc)
+{
+    uint8_t options = crc ? (uint8_t)LORA_AIRTIME_CRC : 0U;
+    
+    if(Airtime_lowDataRateOptimize(sf, bw)){
+        
+        options |= (uint8_t)LORA_AIRTIME_LDRO;
+    }
+    
+    return Airtime_ticks(sf, bw, CR_5, options, size);
+}
+
+static void tx(void *receiver, uint64_t time, uint64_t error)
+{
+    struct lora_mac *self = (struct lora_mac *)receiver;            
+    
+    LORA_PEDANTIC(receiver != NULL)
+    LORA_PEDANTIC(self->op != LORA_OP_NONE)
+    
+    struct lora_radio_tx_setting radio_setting;
+    
+    if(Region_getRate(self->region, System_getTXRate(self->system), &radio_setting.sf, &radio_setting.bw)){
+    
+        radio_setting.freq = self->tx.freq;
+        radio_setting.cr = CR_5;
+        radio_setting.power = System_getTXPower(self->system);
+        radio_setting.preamble = 8U;
+        radio_setting.channel = self->tx.chIndex;
+    
+        LORA_PEDANTIC(self->state == WAIT_TX)
+    
+        /* registering discards stale events so it must come before the radio can interrupt */
+        event_handle_t txEvent = Event_onInput(&self->events, EVENT_TX_COMPLETE, self, txComplete);
+    
+        if(Radio_transmit(self->radio, &radio_setting, self->buffer, self->bufferLen)){
+
+            registerTime(self, self->tx.freq, System_time(), transmitTime(radio_setting.bw, radio_setting.sf, self->bufferLen, true));
+            
+            self->state = TX;
+        }
+        else{
+            
+            LORA_INFO("radio rejected parameters")            
+            Event_cancel(&self->events, &txEvent);
+            self->state = IDLE;
+        }
+    }
+    else{
+        
+        LORA_INFO("invalid rate")            
+        self->state = IDLE;
+    }
+}
+
+static void txComplete(void *receiver, uint64_t time, uint64_t error)
+{
+    struct lora_mac *self = (struct lora_mac *)receiver;            
+    
+    LORA_PEDANTIC(receiver != NULL)
+    LORA_PEDANTIC(self->state == TX)
+    LORA_PEDANTIC(self->op != LORA_OP_NONE)
+    
+    uint32_t rx1Time;
+        
+    Radio_sleep(self->radio);
+    
+    self->state = WAIT_RX1;                
+    rx1Time = time + timeBase((self->op == LORA_OP_JOINING) ? Region_getJA1Delay(self->region) : System_getRX1Delay(self->system)) - error;
+
+    (void)Event_onTimeoutWithPriority(&self->events, rx1Time, EVENT_PRIORITY_HIGH, self, rxStart);    
+    self->rx2Ready = Event_onTimeoutWithPriority(&self->events, rx1Time + timeBase(1U), EVENT_PRIORITY_HIGH, self, rxStart);
+}
+
+static void rxStart(void *receiver, uint64_t time, uint64_t error)
+{
+    struct lora_mac *self = (struct lora_mac *)receiver;    
+    
+    LORA_PEDANTIC(receiver != NULL)
+    LORA_PEDANTIC((self->state == WAIT_RX1) || (self->state == WAIT_RX2) || (self->state == RX2)||(self->state == RX1))
+    LORA_PEDANTIC(self->op != LORA_OP_NONE)
+    
+    struct lora_radio_rx_setting radio_setting;
+    
+    uint8_t rate;
+    uint32_t freq;
+    
+    /* ignore RX2 if it fires while RX1 is active */
+    if(self->state != RX1){
+        
+        #ifndef RX_MARGIN
+        #define RX_MARGIN 100
+        #endif
+       
+        if(error < RX_MARGIN){
         
             switch(self->state){
             default:
@@ -507,14 +867,15 @@ static void rxStart(void *receiver, uint64_t time, uint64_t error)
             radio_setting.preamble = 8U;
             radio_setting.timeout = (radio_setting.sf <= SF_9) ? 8U : 5U;
             
-            if(Radio_receive(self->radio, &radio_setting)){
-                 
-                self->rxComplete = Event_onInput(&self->events, EVENT_RX_READY, self, rxReady);        
-                self->rxTimeout = Event_onInput(&self->events, EVENT_RX_TIMEOUT, self, rxTimeout);                            
-            }
-            else{
+            /* registering discards stale events so it must come before the radio can interrupt */
+            self->rxComplete = Event_onInput(&self->events, EVENT_RX_READY, self, rxReady);        
+            self->rxTimeout = Event_onInput(&self->events, EVENT_RX_TIMEOUT, self, rxTimeout);                            
+            
+            if(!Radio_receive(self->radio, &radio_setting)){
                 
                 LORA_INFO("could not apply radio settings")
+                Event_cancel(&self->events, &self->rxComplete);
+                Event_cancel(&self->events, &self->rxTimeout);
                 self->state = IDLE;
             }         
         }
@@ -540,11 +901,16 @@ static void rxReady(void *receiver, uint64_t time, uint64_t error)
     
     Radio_sleep(self->radio);
     
+    /* the frame to repeat is overwritten by whatever is received */
+    self->tx.repeats = 0U;
+    
     if(collect(self, &frame)){
         
         Event_cancel(&self->events, &self->rx2Ready);
         
         switch(self->op){
+        case LORA_OP_ANSWER:
+            break;
         default:
         case LORA_OP_NONE:
         case LORA_OP_DATA_UNCONFIRMED:
@@ -560,6 +926,8 @@ static void rxReady(void *receiver, uint64_t time, uint64_t error)
         
         self->state = IDLE;           
         self->op = LORA_OP_NONE;
+        
+        idle(self);
     }
     else{
         
@@ -586,27 +954,63 @@ static void rxFinish(struct lora_mac *self)
 {
     if(self->state == RX2){
         
-        switch(self->op){
-        default:
-        case LORA_OP_NONE:
-            break;
-        case LORA_OP_DATA_UNCONFIRMED:
-            self->responseHandler(self->responseReceiver, LORA_MAC_READY, NULL);            
-            break;
-        case LORA_OP_JOINING:
-        case LORA_OP_DATA_CONFIRMED:
-            self->responseHandler(self->responseReceiver, LORA_MAC_TIMEOUT, NULL);
-            break;
-        }
+        /* nothing was received so an unconfirmed frame may be sent again */
+        if(!repeatUp(self)){
         
-        self->state = IDLE;
-        self->op = LORA_OP_NONE;       
+            switch(self->op){
+            default:
+            case LORA_OP_NONE:
+            case LORA_OP_ANSWER:
+                break;
+            case LORA_OP_DATA_UNCONFIRMED:
+                self->responseHandler(self->responseReceiver, LORA_MAC_READY, NULL);            
+                break;
+            case LORA_OP_JOINING:
+            case LORA_OP_DATA_CONFIRMED:
+                self->responseHandler(self->responseReceiver, LORA_MAC_TIMEOUT, NULL);
+                break;
+            }
+            
+            self->state = IDLE;
+            self->op = LORA_OP_NONE;       
+            
+            idle(self);
+        }
     }
     else{
         
         self->state = WAIT_RX2;
     }                
 }
+
+static bool repeatUp(struct lora_mac *self)
+{
+    bool retval = false;
+    uint8_t rate = System_getTXRate(self->system);
+    uint64_t next;
+    
+    if(self->tx.repeats > 0U){
+        
+        self->tx.repeats--;
+        
+        next = timeNextAvailable(self, System_time(), rate);
+        
+        /* same frame (and so the same FCnt) on a newly selected channel */
+        if((next != UINT64_MAX) && selectChannel(self, next, rate, self->tx.chIndex, &self->tx.chIndex, &self->tx.freq)){
+            
+            (void)Event_onTimeoutWithPriority(&self->events, next, EVENT_PRIORITY_HIGH, self, tx);
+            
+            self->state = WAIT_TX;
+            retval = true;
+        }
+        else{
+            
+            LORA_ERROR("no channel available")
+        }
+    }
+    
+    return retval;
+}
         
 static bool collect(struct lora_mac *self, struct lora_frame *frame)
 {
@@ -615,14 +1019,30 @@ static bool collect(struct lora_mac *self, struct lora_frame *frame)
     uint8_t appKey[16U];
     uint8_t appSKey[16U];
     uint8_t nwkSKey[16U];
-        
-    System_getAppKey(self->system, appKey);
-    System_getAppSKey(self->system, appSKey);
-    System_getNwkSKey(self->system, nwkSKey);
+    bool decoded;
     
     self->bufferLen = Radio_collect(self->radio, self->buffer, sizeof(self->buffer));        
     
-    if(Frame_decode(appKey, nwkSKey, appSKey, self->buffer, self->bufferLen, frame)){
+    /* only expect a join accept while joining, and then only expand AppKey */
+    if(self->op == LORA_OP_JOINING){
+        
+        System_getAppKey(self->system, appKey);
+        
+        decoded = Frame_decode(appKey, NULL, NULL, self->buffer, self->bufferLen, frame);
+    }
+    else{
+        
+#if defined(LORA_MAC_NO_KEY_CACHE)
+        System_getNwkSKey(self->system, nwkSKey);
+        System_getAppSKey(self->system, appSKey);
+        
+        decoded = Frame_decode(NULL, nwkSKey, appSKey, self->buffer, self->bufferLen, frame);
+#else
+        decoded = Frame_decodeDataWithKeys(getKeys(self), self->buffer, self->bufferLen, frame);
+#endif
+    }
+    
+    if(decoded){
         
         if(frame->valid){
             
@@ -638,6 +1058,8 @@ static bool collect(struct lora_mac *self, struct lora_frame *frame)
                     System_resetUp(self->system);
                     System_resetDown(self->system);
                     
+                    self->adrAckCounter = 0U;
+                    
                     MAC_restoreDefaults(self);
                     
                     System_setRX1DROffset(self->system, frame->fields.joinAccept.rx1DataRateOffset);
@@ -655,11 +1077,10 @@ static bool collect(struct lora_mac *self, struct lora_frame *frame)
                             
                             (void)System_setChannel(self->system, chIndex, frame->fields.joinAccept.cfList[i], 0U, 5U);
                         }
+                        
+                        MAC_reloadChannels(self);
                     }   
                     
-                    struct lora_aes_ctx ctx;
-                    LoraAES_init(&ctx, appKey);
-                    
                     (void)memset(nwkSKey, 0U, sizeof(nwkSKey));
                     
                     nwkSKey[0] = 1U;                
@@ -676,11 +1097,21 @@ static bool collect(struct lora_mac *self, struct lora_frame *frame)
                     
                     appSKey[0] = 2U;                
                     
-                    LoraAES_encrypt(&ctx, nwkSKey);
-                    LoraAES_encrypt(&ctx, appSKey);
+                    {
+                        struct lora_aes_ctx ctx;
+                        
+                        LoraAES_init(&ctx, appKey);
+                        LoraAES_encrypt(&ctx, nwkSKey);
+                        LoraAES_encrypt(&ctx, appSKey);
+                    }
                                     
                     System_setNwkSKey(self->system, nwkSKey);                
                     System_setAppSKey(self->system, appSKey);
+                    
+#if !defined(LORA_MAC_NO_KEY_CACHE)
+                    Frame_initSessionKeys(&self->keys, nwkSKey, appSKey);
+                    self->status.keysReady = true;
+#endif
                     System_setDevAddr(self->system, frame->fields.joinAccept.devAddr);                                        
                 }
                 else{
@@ -698,6 +1129,9 @@ static bool collect(struct lora_mac *self, struct lora_frame *frame)
                     
                         if(System_receiveDown(self->system, frame->fields.data.counter, Region_getMaxFCNTGap(self->region))){
                         
+                            /* network can hear us */
+                            self->adrAckCounter = 0U;
+                            
                             processCommands(self, frame->fields.data.opts, frame->fields.data.optsLen);
                             
                             if(frame->fields.data.data != NULL){
@@ -749,9 +1183,41 @@ static bool collect(struct lora_mac *self, struct lora_frame *frame)
     return retval;
 }
 
+#if !defined(LORA_MAC_NO_KEY_CACHE)
+static const struct lora_frame_session_keys *getKeys(struct lora_mac *self)
+{
+    uint8_t nwkSKey[16U];
+    uint8_t appSKey[16U];
+    
+    if(!self->status.keysReady){
+        
+        System_getNwkSKey(self->system, nwkSKey);
+        System_getAppSKey(self->system, appSKey);
+        
+        Frame_initSessionKeys(&self->keys, nwkSKey, appSKey);
+        
+        self->status.keysReady = true;
+    }
+    
+    return &self->keys;
+}
+#endif
+
 static void handleCommands(void *receiver, const struct lora_downstream_cmd *cmd)
 {
-    struct lora_mac *self = (struct lora_mac *)receiver;
+    struct command_state *state = (struct command_state *)receiver;
+    struct lora_mac *self = state->self;
+    struct lora_stream s;
+    bool answered = true;
+    
+    /* the first other command ends a LinkADRReq block */
+    if((cmd->type != LINK_ADR) && (state->adr.count > 0U)){
+        
+        linkADREnd(self, &state->adr);
+    }
+    
+    /* answers accumulate until the next uplink */
+    (void)Stream_init(&s, &self->answers[self->answersLen], sizeof(self->answers) - self->answersLen);
     
     switch(cmd->type){
     default:
@@ -761,29 +1227,61 @@ static void handleCommands(void *receiver, const struct lora_downstream_cmd *cmd
         break;
         
     case LINK_ADR:                    
-        //these need be processed as a transaction
+    
+        linkADRAdd(self, &state->adr, &cmd->fields.linkADRReq);
         break;
     
     case DUTY_CYCLE:                
+    
         System_setMaxDutyCycle(self->system, cmd->fields.dutyCycleReq.maxDutyCycle);
+        answered = MAC_putDutyCycleAns(&s);
         break;
     
     case RX_PARAM_SETUP:
+    {
+        struct lora_rx_param_setup_ans ans;
+        enum lora_spreading_factor sf;
+        enum lora_signal_bandwidth bw;
+        uint8_t rate;
+        uint8_t band;
+        
+        ans.rx1DROffsetOK = Region_getRX1DataRate(self->region, System_getTXRate(self->system), cmd->fields.rxParamSetupReq.rx1DROffset, &rate);
+        ans.rx2DataRateOK = Region_getRate(self->region, cmd->fields.rxParamSetupReq.rx2DataRate, &sf, &bw);
+        ans.channelOK = Region_getBand(self->region, cmd->fields.rxParamSetupReq.freq, &band);
+        
+        /* all or nothing */
+        if(ans.rx1DROffsetOK && ans.rx2DataRateOK && ans.channelOK){
+            
+            System_setRX1DROffset(self->system, cmd->fields.rxParamSetupReq.rx1DROffset);
+            System_setRX2DataRate(self->system, cmd->fields.rxParamSetupReq.rx2DataRate);
+            System_setRX2Freq(self->system, cmd->fields.rxParamSetupReq.freq);
+        }
         
+        answered = MAC_putRXParamSetupAns(&s, &ans);
+    }
         break;
     
     case DEV_STATUS:
     {
-        //ans.battery = System_getBatteryLevel(self->system);
-        //ans.margin = 0U;
+        struct lora_dev_status_ans ans;
+        
+        ans.battery = System_getBatteryLevel(self->system);
+        
+        /* the radio does not report SNR of the last downlink */
+        ans.margin = 0U;
+        
+        answered = MAC_putDevStatusAns(&s, &ans);
     }
         break;
         
     case NEW_CHANNEL:    
-    
-        if(Region_isDynamic(self->region)){
+    {
+        struct lora_new_channel_ans ans;
         
-            struct lora_new_channel_ans ans;
+        ans.dataRateRangeOK = false;
+        ans.channelFrequencyOK = false;
+        
+        if(Region_isDynamic(self->region)){
         
             ans.dataRateRangeOK = Region_validateRate(self->region, cmd->fields.newChannelReq.chIndex, cmd->fields.newChannelReq.minDR, cmd->fields.newChannelReq.maxDR);        
             ans.channelFrequencyOK = Region_validateFreq(self->region, cmd->fields.newChannelReq.chIndex, cmd->fields.newChannelReq.freq);
@@ -791,24 +1289,330 @@ static void handleCommands(void *receiver, const struct lora_downstream_cmd *cmd
             if(ans.dataRateRangeOK && ans.channelFrequencyOK){
                 
                 (void)System_setChannel(self->system, cmd->fields.newChannelReq.chIndex, cmd->fields.newChannelReq.freq, cmd->fields.newChannelReq.minDR, cmd->fields.newChannelReq.maxDR);                        
+                MAC_reloadChannels(self);
             }            
         }
+        
+        answered = MAC_putNewChannelAns(&s, &ans);
+    }
         break;        
+        
     case DL_CHANNEL:            
+    {
+        struct lora_dl_channel_ans ans;
+        uint32_t freq;
+        uint8_t minRate;
+        uint8_t maxRate;
+        
+        /* separate downlink frequencies are not supported */
+        ans.uplinkFreqOK = getChannel(self, cmd->fields.dlChannelReq.chIndex, &freq, &minRate, &maxRate);
+        ans.channelFrequencyOK = false;
+        
+        answered = MAC_putDLChannelAns(&s, &ans);
+    }
         break;
     
     case RX_TIMING_SETUP:    
     
+        /* zero means one second */
+        System_setRX1Delay(self->system, (cmd->fields.rxTimingSetupReq.delay == 0U) ? 1U : cmd->fields.rxTimingSetupReq.delay);
+        answered = MAC_putRXTimingSetupAns(&s);
         break;
     
     case TX_PARAM_SETUP:        
         break;
     }    
+    
+    if(answered){
+        
+        self->answersLen += (uint8_t)Stream_tell(&s);
+    }
+    else{
+        
+        LORA_ERROR("no space for MAC command answer")
+    }
 }
 
 static void processCommands(struct lora_mac *self, const uint8_t *data, uint8_t len)
 {
-    (void)MAC_eachDownstreamCommand(self, data, len, handleCommands);
+    struct command_state state;
+    
+    state.self = self;
+    state.adr.count = 0U;
+    
+    (void)MAC_eachDownstreamCommand(&state, data, len, handleCommands);
+    
+    if(state.adr.count > 0U){
+        
+        linkADREnd(self, &state.adr);
+    }
+}
+
+static void linkADRAdd(struct lora_mac *self, struct link_adr_block *block, const struct lora_link_adr_req *req)
+{
+    enum lora_region_mask_fill fill;
+    uint8_t first;
+    uint8_t minRate;
+    uint8_t maxRate;
+    uint8_t i;
+    bool on;
+    bool change;
+    
+    /* start from the channels enabled now */
+    if(block->count == 0U){
+        
+        (void)memset(block->mask, 0, sizeof(block->mask));
+        
+        for(i=0U; i < numChannels(self); i++){
+            
+            if(!System_channelIsMasked(self->system, i)){
+                
+                block->mask[i / 8U] |= (uint8_t)(1U << (i % 8U));
+            }
+        }
+        
+        block->maskOK = true;
+    }
+    
+    if(Region_getChannelMask(self->region, req->channelMaskControl, &first, &fill)){
+    
+        for(i=0U; i < numChannels(self); i++){
+            
+            change = true;
+            on = false;
+            
+            if((i >= first) && ((uint8_t)(i - first) < 16U)){
+                
+                on = ((req->channelMask & (1U << (i - first))) != 0U);
+                
+                if(on && !channelExists(self, i, &minRate, &maxRate)){
+                    
+                    LORA_INFO("LinkADRReq enables a channel that does not exist")
+                    block->maskOK = false;
+                }
+            }
+            else if(fill == LORA_MASK_FILL_ON){
+                
+                on = channelExists(self, i, &minRate, &maxRate);
+            }
+            else if(fill == LORA_MASK_FILL_OFF){
+                
+                on = false;
+            }
+            else{
+                
+                change = false;
+            }
+            
+            if(change){
+            
+                if(on){
+                    
+                    block->mask[i / 8U] |= (uint8_t)(1U << (i % 8U));
+                }
+                else{
+                    
+                    block->mask[i / 8U] &= (uint8_t)~(1U << (i % 8U));
+                }
+            }
+        }
+    }
+    else{
+        
+        LORA_INFO("LinkADRReq ChMaskCntl is RFU")
+        block->maskOK = false;
+    }
+    
+    /* the last LinkADRReq of the block sets these */
+    block->rate = req->dataRate;
+    block->power = req->txPower;
+    block->nbTrans = req->nbTrans;
+    
+    block->count++;
+}
+
+static void linkADREnd(struct lora_mac *self, struct link_adr_block *block)
+{
+    struct lora_link_adr_ans ans;
+    struct lora_stream s;
+    enum lora_spreading_factor sf;
+    enum lora_signal_bandwidth bw;
+    uint8_t minRate;
+    uint8_t maxRate;
+    uint8_t rate;
+    uint8_t power;
+    uint8_t len = 0U;
+    bool enabled = false;
+    uint8_t i;
+    
+    LORA_PEDANTIC(block->count > 0U)
+    
+    /* 0xf keeps the current setting */
+    rate = (block->rate == 0xfU) ? System_getTXRate(self->system) : block->rate;
+    power = (block->power == 0xfU) ? System_getTXPower(self->system) : block->power;
+    
+    ans.dataRateOK = false;
+    
+    /* the rate must be allowed on at least one enabled channel */
+    for(i=0U; i < numChannels(self); i++){
+        
+        if(((block->mask[i / 8U] & (1U << (i % 8U))) != 0U) && channelExists(self, i, &minRate, &maxRate)){
+            
+            enabled = true;
+            
+            if((rate >= minRate) && (rate <= maxRate) && Region_getRate(self->region, rate, &sf, &bw)){
+                
+                ans.dataRateOK = true;
+            }
+        }
+    }
+    
+    ans.channelMaskOK = block->maskOK && enabled;
+    ans.powerOK = (power <= Region_getMaxTXPower(self->region));
+    
+    /* all or nothing */
+    if(ans.channelMaskOK && ans.dataRateOK && ans.powerOK){
+        
+        for(i=0U; i < numChannels(self); i++){
+            
+            if((block->mask[i / 8U] & (1U << (i % 8U))) != 0U){
+                
+                (void)System_unmaskChannel(self->system, i);
+            }
+            else{
+                
+                (void)System_maskChannel(self->system, i);
+            }
+        }
+        
+        MAC_reloadChannels(self);
+        
+        System_setTXRate(self->system, rate);
+        System_setTXPower(self->system, power);
+        
+        /* zero keeps the current setting */
+        if(block->nbTrans > 0U){
+            
+            System_setNbTrans(self->system, block->nbTrans);
+        }
+        
+        countStat(&self->adrStats.linkADRAccepted);
+    }
+    else{
+        
+        countStat(&self->adrStats.linkADRRejected);
+    }
+    
+    self->adrStats.lastStatus = (ans.powerOK ? 4U : 0U) | (ans.dataRateOK ? 2U : 0U) | (ans.channelMaskOK ? 1U : 0U);
+    
+    /* one answer for each request */
+    (void)Stream_init(&s, &self->answers[self->answersLen], sizeof(self->answers) - self->answersLen);
+    
+    for(i=0U; i < block->count; i++){
+        
+        if(!MAC_putLinkADRAns(&s, &ans)){
+            
+            LORA_ERROR("no space for MAC command answer")
+            break;
+        }
+        
+        len = (uint8_t)Stream_tell(&s);
+    }
+    
+    self->answersLen += len;
+    block->count = 0U;
+}
+
+static void adrUp(struct lora_mac *self, bool ackReq)
+{
+    uint8_t limit = Region_getADRAckLimit(self->region);
+    uint8_t delay = Region_getADRAckDelay(self->region);
+    
+    if(ackReq){
+        
+        countStat(&self->adrStats.ackReq);
+    }
+    
+    countStat(&self->adrAckCounter);
+    
+    /* no downlink within ADR_ACK_DELAY uplinks of requesting one */
+    if((delay > 0U) && (self->adrAckCounter >= ((uint16_t)limit + delay)) && (((self->adrAckCounter - limit) % delay) == 0U)){
+        
+        adrBackoff(self);
+    }
+}
+
+static void adrBackoff(struct lora_mac *self)
+{
+    uint8_t rate = System_getTXRate(self->system);
+    
+    if(System_getTXPower(self->system) != Region_getTXPower(self->region)){
+        
+        LORA_INFO("ADR backoff: default TX power")
+        
+        System_setTXPower(self->system, Region_getTXPower(self->region));
+        countStat(&self->adrStats.powerReset);
+    }
+    else if(rate > 0U){
+        
+        LORA_INFO("ADR backoff: lower rate")
+        
+        rate--;
+        
+        System_setTXRate(self->system, rate);
+        countStat(&self->adrStats.rateDecreased);
+        
+        /* the channel mask may not allow the lower rate */
+        if(timeNextAvailable(self, 0U, rate) == UINT64_MAX){
+            
+            resetChannels(self);
+        }
+    }
+    else{
+        
+        resetChannels(self);
+    }
+}
+
+static void resetChannels(struct lora_mac *self)
+{
+    uint8_t minRate;
+    uint8_t maxRate;
+    uint8_t i;
+    bool changed = false;
+    
+    for(i=0U; i < numChannels(self); i++){
+        
+        if(System_channelIsMasked(self->system, i) && channelExists(self, i, &minRate, &maxRate)){
+            
+            (void)System_unmaskChannel(self->system, i);
+            changed = true;
+        }
+    }
+    
+    if(changed){
+        
+        LORA_INFO("ADR backoff: all channels")
+        
+        MAC_reloadChannels(self);
+        countStat(&self->adrStats.channelsReset);
+    }
+}
+
+static bool channelExists(struct lora_mac *self, uint8_t chIndex, uint8_t *minRate, uint8_t *maxRate)
+{
+    uint32_t freq;
+    
+    /* dynamic regions may have no frequency set */
+    return getChannel(self, chIndex, &freq, minRate, maxRate) && (freq != 0U);
+}
+
+static void countStat(uint16_t *value)
+{
+    if(*value < UINT16_MAX){
+        
+        (*value)++;
+    }
 }
 
 static void registerTime(struct lora_mac *self, uint32_t freq, uint64_t timeNow, uint32_t airTime)
@@ -831,139 +1635,177 @@ static void addDefaultChannel(void *receiver, uint8_t chIndex, uint32_t freq, ui
 static bool selectChannel(struct lora_mac *self, uint64_t timeNow, uint8_t rate, uint8_t prevChIndex, uint8_t *chIndex, uint32_t *freq)
 {
     bool retval = false;
-    uint8_t i;    
-    uint8_t available = 0U;
-    uint8_t j = 0U;
+    const uint8_t *enabled = enabledChannels(self, rate);
+    uint8_t available[sizeof(self->channels.enabled)];
+    uint8_t count = 0U;
+    uint8_t index;
     uint8_t minRate;
     uint8_t maxRate;    
-    uint8_t except = UINT8_MAX;
+    uint8_t band;
+    uint8_t bits;
+    size_t i;
     
-    for(i=0U; i < Region_numChannels(self->region); i++){
-        
-        if(isAvailable(self, i, timeNow, rate)){
+    (void)memset(available, 0, sizeof(available));
+    
+    /* channels in bands that are ready */
+    for(band=0U; band < LORA_MAC_NUM_BANDS; band++){
         
-            if(i == prevChIndex){
+        if(timeNow >= self->bands[band]){
+            
+            for(i=0U; i < sizeof(available); i++){
                 
-                except = i;
+                available[i] |= enabled[i] & self->channels.band[band][i];
             }
-        
-            available++;            
-        }            
+        }
     }
     
-    if(available > 0U){
-    
-        uint8_t index;
-    
-        if(except != UINT8_MAX){
-    
-            if(available == 1U){
-                
-                except = UINT8_MAX;
-            }
-            else{
-                
-                available--;
-            }
-        }
+    for(i=0U; i < sizeof(available); i++){
+        
+        count += countBits(available[i]);
+    }
     
-        index = System_rand() % available;
+    /* avoid the previous channel if there is another */
+    if((count > 1U) && (prevChIndex < numChannels(self)) && ((available[prevChIndex / 8U] & (1U << (prevChIndex % 8U))) != 0U)){
         
-        available = 0U;
+        available[prevChIndex / 8U] &= ~(1U << (prevChIndex % 8U));
+        count--;
+    }
+    
+    if(count > 0U){
         
-        for(i=0U; i < Region_numChannels(self->region); i++){
+        index = System_rand() % count;
         
-            if(isAvailable(self, i, timeNow, rate)){
+        /* skip whole bytes and then find the nth bit */
+        for(i=0U; index >= countBits(available[i]); i++){
             
-                if(except != i){
+            index -= countBits(available[i]);
+        }
+        
+        for(bits = available[i]; index > 0U; index--){
             
-                    if(index == j){
-                        
-                        if(getChannel(self, i, freq, &minRate, &maxRate)){
-                            
-                            *chIndex = i;
-                            retval = true;
-                            break;
-                        }                        
-                    }
+            bits &= bits - 1U;
+        }
+        
+        /* lowest bit left */
+        index = (uint8_t)((i * 8U) + countBits((uint8_t)((bits & -bits) - 1U)));
+        
+        if(getChannel(self, index, freq, &minRate, &maxRate)){
             
-                    j++;            
-                }
-            }            
+            *chIndex = index;
+            retval = true;
         }
     }
 
     return retval;
 }
 
-static bool isAvailable(struct lora_mac *self, uint8_t chIndex, uint64_t timeNow, uint8_t rate)
+static uint64_t timeNextAvailable(struct lora_mac *self, uint64_t timeNow, uint8_t rate)
 {
-    bool retval = false;
-    uint32_t freq;
-    uint8_t minRate;    
-    uint8_t maxRate;    
+    const uint8_t *enabled = enabledChannels(self, rate);
+    uint8_t nextBand = UINT8_MAX;
     uint8_t band;
+    size_t i;
     
-    if(!System_channelIsMasked(self->system, chIndex)){
-    
-        if(getChannel(self, chIndex, &freq, &minRate, &maxRate)){
-            
-            if((rate >= minRate) && (rate <= maxRate)){
+    for(band=0U; band < LORA_MAC_NUM_BANDS; band++){
+        
+        for(i=0U; i < sizeof(self->channels.enabled); i++){
             
-                if(Region_getBand(self->region, freq, &band)){
+            if((enabled[i] & self->channels.band[band][i]) != 0U){
                 
-                    if(timeNow >= self->bands[band]){
+                if((nextBand == UINT8_MAX) || (self->bands[band] < self->bands[nextBand])){
                     
-                        retval = true;                    
-                    }
+                    nextBand = band;
                 }
+                
+                break;
             }
         }
     }
     
-    return retval;
+    return (nextBand == UINT8_MAX) ? UINT64_MAX : self->bands[nextBand];
 }
 
-static uint64_t timeNextAvailable(struct lora_mac *self, uint64_t timeNow, uint8_t rate)
+static const uint8_t *enabledChannels(struct lora_mac *self, uint8_t rate)
+{
+    uint8_t i;
+    uint8_t band;
+    
+    if(!self->channels.valid){
+        
+        loadChannels(self);
+    }
+    
+    if(!self->channels.enabledValid || (self->channels.rate != rate)){
+        
+        (void)memset(self->channels.enabled, 0, sizeof(self->channels.enabled));
+        
+        for(band=0U; band < LORA_MAC_NUM_BANDS; band++){
+            
+            for(i=0U; i < sizeof(self->channels.enabled); i++){
+                
+                self->channels.enabled[i] |= self->channels.band[band][i];
+            }
+        }
+        
+        for(i=0U; i < numChannels(self); i++){
+            
+            if((rate < (self->channels.rates[i] >> 4)) || (rate > (self->channels.rates[i] & 0xfU))){
+                
+                self->channels.enabled[i / 8U] &= ~(1U << (i % 8U));
+            }
+        }
+        
+        self->channels.rate = rate;
+        self->channels.enabledValid = true;
+    }
+    
+    return self->channels.enabled;
+}
+
+static void loadChannels(struct lora_mac *self)
 {
     uint8_t i;
     uint32_t freq;
     uint8_t minRate;
-    uint8_t band;
     uint8_t maxRate;
-    uint8_t nextBand = UINT8_MAX;
+    uint8_t band;
     
-    for(i=0U; i < Region_numChannels(self->region); i++){
-     
-        if(!System_channelIsMasked(self->system, i)){
+    (void)memset(self->channels.rates, 0, sizeof(self->channels.rates));
+    (void)memset(self->channels.band, 0, sizeof(self->channels.band));
+    
+    for(i=0U; i < numChannels(self); i++){
         
+        if(!System_channelIsMasked(self->system, i)){
+    
             if(getChannel(self, i, &freq, &minRate, &maxRate)){
                 
-                if((rate >= minRate) && (rate <= maxRate)){
-                
-                    if(Region_getBand(self->region, freq, &band)){
-                
-                        if(nextBand == UINT8_MAX){
-                            
-                            nextBand = band;
-                        }
-                        else{
-                        
-                            if(nextBand != band){
-                                
-                                if(self->bands[band] < self->bands[nextBand]){
-                                    
-                                    nextBand = band;
-                                }
-                            }
-                        }                                                    
-                    }
+                if(Region_getBand(self->region, freq, &band) && (band < LORA_MAC_NUM_BANDS)){
+                    
+                    LORA_PEDANTIC((minRate <= 0xfU) && (maxRate <= 0xfU))
+                    
+                    self->channels.rates[i] = (uint8_t)((minRate << 4) | (maxRate & 0xfU));
+                    self->channels.band[band][i / 8U] |= (uint8_t)(1U << (i % 8U));
                 }
             }
         }
     }
     
-    return (nextBand == UINT8_MAX) ? UINT64_MAX : self->bands[nextBand];
+    self->channels.valid = true;
+    self->channels.enabledValid = false;
+}
+
+static uint8_t numChannels(struct lora_mac *self)
+{
+    uint8_t retval = Region_numChannels(self->region);
+    
+    return (retval > LORA_MAC_MAX_CHANNELS) ? LORA_MAC_MAX_CHANNELS : retval;
+}
+
+static uint8_t countBits(uint8_t value)
+{
+    static const uint8_t nibble[] = {0U, 1U, 1U, 2U, 1U, 2U, 2U, 3U, 1U, 2U, 2U, 3U, 2U, 3U, 3U, 4U};
+    
+    return nibble[value & 0xfU] + nibble[value >> 4];
 }
 
 static bool getChannel(struct lora_mac *self, uint8_t chIndex, uint32_t *freq, uint8_t *minRate, uint8_t *maxRate)
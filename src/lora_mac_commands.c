@@ -206,7 +206,7 @@ bool MAC_putLinkADRReq(struct lora_stream *s, const struct lora_link_adr_req *va
             
             if(putU16(s, value->channelMask)){
                     
-                if(putU8(s, value->redundancy)){                                
+                if(putU8(s, ((value->channelMaskControl & 0x7U) << 4)|(value->nbTrans & 0xfU))){                                
                     
                     retval = true;                        
                 }                
@@ -645,8 +645,10 @@ static bool getLinkADRReq(struct lora_stream *s, struct lora_link_adr_req *value
     
         if(getU16(s, &value->channelMask)){
                     
-            if(getU8(s, &value->redundancy)){
+            if(getU8(s, &buf)){
                 
+                value->channelMaskControl = (buf >> 4) & 0x7U;
+                value->nbTrans = buf & 0xfU;
                 retval = true;                        
             }            
         }                    
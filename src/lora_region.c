@@ -715,6 +715,114 @@ uint8_t Region_getTXPower(enum lora_region region)
     return retval; 
 }
 
+uint8_t Region_getMaxTXPower(enum lora_region region)
+{
+    uint8_t retval;
+    
+    switch(region){
+    default:
+    case EU_863_870:
+    case AS_923:
+    case KR_920_923:
+    case CN_470_510:                      
+        retval = 7U;
+        break;
+    case EU_433:
+    case CN_779_787:
+        retval = 5U;
+        break;
+    case US_902_928:            
+    case AU_915_928:
+    case IN_865_867:
+        retval = 10U;
+        break;      
+    }
+    
+    return retval; 
+}
+
+bool Region_getChannelMask(enum lora_region region, uint8_t cntl, uint8_t *first, enum lora_region_mask_fill *fill)
+{
+    LORA_PEDANTIC(first != NULL)
+    LORA_PEDANTIC(fill != NULL)
+    
+    bool retval = false;
+    
+    switch(region){
+    default:
+    case EU_863_870:
+    case EU_433:
+    case AS_923:
+    case KR_920_923:
+    case CN_779_787:
+    case IN_865_867:
+    
+        if(cntl == 0U){
+            
+            *first = 0U;
+            *fill = LORA_MASK_FILL_NONE;
+            retval = true;
+        }
+        /* all channels on */
+        else if(cntl == 6U){
+            
+            *first = 16U;
+            *fill = LORA_MASK_FILL_ON;
+            retval = true;
+        }
+        else{
+            
+            /* RFU */
+        }
+        break;
+        
+    case US_902_928:            
+    case AU_915_928:
+    
+        if(cntl <= 4U){
+            
+            *first = cntl * 16U;
+            *fill = LORA_MASK_FILL_NONE;
+            retval = true;
+        }
+        /* all 125kHz channels on (6) or off (7) */
+        else if(cntl >= 6U){
+            
+            *first = 64U;
+            *fill = (cntl == 6U) ? LORA_MASK_FILL_ON : LORA_MASK_FILL_OFF;
+            retval = true;
+        }
+        else{
+            
+            /* RFU */
+        }
+        break;
+        
+    case CN_470_510:
+    
+        if(cntl <= 5U){
+            
+            *first = cntl * 16U;
+            *fill = LORA_MASK_FILL_NONE;
+            retval = true;
+        }
+        /* all channels on */
+        else if(cntl == 6U){
+            
+            *first = 96U;
+            *fill = LORA_MASK_FILL_ON;
+            retval = true;
+        }
+        else{
+            
+            /* RFU */
+        }
+        break;
+    }
+    
+    return retval;
+}
+
 /* static functions ***************************************************/
 
 static bool upRateRange(enum lora_region region, uint8_t chIndex, uint8_t *minRate, uint8_t *maxRate)
@@ -0,0 +1,23 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <time.h>
+#include <stdio.h>
+
+/* monotonic wall clock in seconds */
+static inline double bench_seconds(void)
+{
+    struct timespec ts;
+    
+    (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+    
+    return (double)ts.tv_sec + ((double)ts.tv_nsec / 1e9);
+}
+
+/* print a rate measurement in a consistent format */
+static inline void bench_report(const char *name, const char *unit, double count, double seconds)
+{
+    printf("%-32s %14.0f %s/s\n", name, count / seconds, unit);
+}
+
+#endif
@@ -0,0 +1,77 @@
+#include "lora_aes.h"
+#include "bench.h"
+
+#include <string.h>
+
+#if defined(LORA_AES_HW)
+    #define ENGINE "hw"
+#elif defined(LORA_AES_TTABLE)
+    #define ENGINE "ttable"
+#elif defined(LORA_AES_BITSLICE) && defined(LORA_AES_BITSLICE_32)
+    #define ENGINE "bitslice32"
+#elif defined(LORA_AES_BITSLICE)
+    #define ENGINE "bitslice"
+#else
+    #define ENGINE "byte"
+#endif
+
+#define BLOCKS 2000000UL
+
+/* stops the compiler discarding the work */
+static volatile uint8_t sink;
+
+int main(void)
+{
+    static const uint8_t key[] = {0x10,0xa5,0x88,0x69,0xd7,0x4b,0xe5,0xa3,0x74,0xcf,0x86,0x7c,0xfb,0x47,0x38,0x59};
+    struct lora_aes_ctx aes;
+    uint8_t block[AES_BLOCK_SIZE];
+    unsigned long i;
+    double start;
+    double encrypt;
+    double init;
+    double ctr;
+    static uint8_t frame[240U];
+
+    (void)memset(block, 0, sizeof(block));
+    
+    LoraAES_init(&aes, key);
+
+    start = bench_seconds();
+
+    /* chained so that each block depends on the previous result */
+    for(i=0U; i < BLOCKS; i++){
+
+        LoraAES_encrypt(&aes, block);
+    }
+
+    encrypt = bench_seconds() - start;
+
+    start = bench_seconds();
+
+    for(i=0U; i < BLOCKS; i++){
+
+        LoraAES_init(&aes, block);
+        block[0] ^= aes.k[175];
+    }
+
+    init = bench_seconds() - start;
+
+    start = bench_seconds();
+
+    /* frame sized messages as seen by cipherData */
+    for(i=0U; i < (BLOCKS / (sizeof(frame) / AES_BLOCK_SIZE)); i++){
+
+        LoraAES_ctr(&aes, block, frame, sizeof(frame));
+        block[0] ^= frame[0];
+    }
+
+    ctr = bench_seconds() - start;
+
+    bench_report("LoraAES_encrypt (" ENGINE ")", "blocks", (double)BLOCKS, encrypt);
+    bench_report("LoraAES_init (" ENGINE ")", "keys", (double)BLOCKS, init);
+    bench_report("LoraAES_ctr (" ENGINE ")", "blocks", (double)((BLOCKS / (sizeof(frame) / AES_BLOCK_SIZE)) * (sizeof(frame) / AES_BLOCK_SIZE)), ctr);
+
+    sink = block[0];
+
+    return 0;
+}
@@ -0,0 +1,82 @@
+#include "lora_aes.h"
+#include "lora_cmac.h"
+#include "bench.h"
+
+#include <string.h>
+
+#if defined(LORA_AES_HW)
+    #define ENGINE "hw"
+#elif defined(LORA_AES_TTABLE)
+    #define ENGINE "ttable"
+#elif defined(LORA_AES_BITSLICE)
+    #define ENGINE "bitslice"
+#else
+    #define ENGINE "byte"
+#endif
+
+#define MICS 1000000UL
+
+/* stops the compiler discarding the work */
+static volatile uint8_t sink;
+
+/* B0 block followed by a short uplink, as cmacData would see it */
+static void mic(const struct lora_aes_ctx *aes, const struct lora_cmac_subkeys *subkeys, uint8_t *b0, const uint8_t *msg, uint8_t len)
+{
+    struct lora_cmac_ctx ctx;
+
+    if(subkeys != NULL){
+
+        LoraCMAC_initWithSubkeys(&ctx, aes, subkeys);
+    }
+    else{
+
+        LoraCMAC_init(&ctx, aes);
+    }
+
+    LoraCMAC_update(&ctx, b0, AES_BLOCK_SIZE);
+    LoraCMAC_update(&ctx, msg, len);
+    LoraCMAC_finish(&ctx, b0, 4U);
+}
+
+int main(void)
+{
+    static const uint8_t key[] = {0x2b,0x7e,0x15,0x16,0x28,0xae,0xd2,0xa6,0xab,0xf7,0x15,0x88,0x09,0xcf,0x4f,0x3c};
+    static const uint8_t msg[] = {0x40,0x8f,0x77,0xbb,0x07,0x00,0x02,0x00,0x06,0x68,0x65,0x6c,0x6c,0x6f};
+    struct lora_aes_ctx aes;
+    struct lora_cmac_subkeys subkeys;
+    uint8_t b0[AES_BLOCK_SIZE];
+    unsigned long i;
+    double start;
+    double derived;
+    double cached;
+
+    (void)memset(b0, 0, sizeof(b0));
+
+    LoraAES_init(&aes, key);
+    LoraCMAC_initSubkeys(&subkeys, &aes);
+
+    start = bench_seconds();
+
+    for(i=0U; i < MICS; i++){
+
+        mic(&aes, NULL, b0, msg, sizeof(msg));
+    }
+
+    derived = bench_seconds() - start;
+
+    start = bench_seconds();
+
+    for(i=0U; i < MICS; i++){
+
+        mic(&aes, &subkeys, b0, msg, sizeof(msg));
+    }
+
+    cached = bench_seconds() - start;
+
+    bench_report("LoraCMAC (" ENGINE ")", "MICs", (double)MICS, derived);
+    bench_report("LoraCMAC subkeys (" ENGINE ")", "MICs", (double)MICS, cached);
+
+    sink = b0[0];
+
+    return 0;
+}
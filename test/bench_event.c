@@ -0,0 +1,76 @@
+#include "lora_event.h"
+#include "lora_system.h"
+#include "bench.h"
+
+#include <string.h>
+#include <stdlib.h>
+
+#if defined(LORA_EVENT_HEAP)
+    #define ENGINE "heap"
+#else
+    #define ENGINE "list"
+#endif
+
+/* timer operations measured at each pool occupancy */
+#define OPS 2000000UL
+
+uint64_t System_time(void)
+{
+    return 0U;
+}
+
+static void handler(void *receiver, uint64_t time, uint64_t error)
+{
+}
+
+/* fill the pool to `n` pending timers and then repeatedly cancel a
+ * random one and schedule a replacement with a random deadline */
+static void run(size_t n)
+{
+    static struct lora_event events;
+    static event_handle_t timers[LORA_EVENT_NUM_TIMERS];
+    char name[40U];
+    unsigned long i;
+    size_t j;
+    double start;
+    double elapsed;
+
+    Event_init(&events);
+    srand(42);
+
+    for(j=0U; j < n; j++){
+
+        timers[j] = Event_onTimeout(&events, (uint64_t)rand(), NULL, handler);
+    }
+
+    start = bench_seconds();
+
+    for(i=0U; i < OPS; i++){
+
+        j = (size_t)rand() % n;
+
+        Event_cancel(&events, &timers[j]);
+        timers[j] = Event_onTimeout(&events, (uint64_t)rand(), NULL, handler);
+    }
+
+    elapsed = bench_seconds() - start;
+
+    (void)snprintf(name, sizeof(name), "cancel+schedule (" ENGINE ", %u)", (unsigned)n);
+    bench_report(name, "ops", (double)OPS, elapsed);
+}
+
+int main(void)
+{
+    static const size_t sizes[] = {3U, 32U, 1024U};
+    size_t i;
+
+    for(i=0U; i < sizeof(sizes)/sizeof(*sizes); i++){
+
+        if(sizes[i] <= LORA_EVENT_NUM_TIMERS){
+
+            run(sizes[i]);
+        }
+    }
+
+    return 0;
+}
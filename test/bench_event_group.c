@@ -0,0 +1,114 @@
+#include "lora_event.h"
+#include "lora_system.h"
+#include "bench.h"
+
+#include <string.h>
+
+/* timer events dispatched at each number of members */
+#define OPS 200000UL
+
+/* ticks between deadlines of different members */
+#define SPACING 10U
+
+static uint64_t now;
+static struct lora_event members[LORA_EVENT_GROUP_SIZE];
+static size_t numMembers;
+
+uint64_t System_time(void)
+{
+    return now;
+}
+
+/* each member wakes up once per lap of all members */
+static void handler(void *receiver, uint64_t time, uint64_t error)
+{
+    (void)Event_onTimeout((struct lora_event *)receiver, time - error + (numMembers * SPACING), receiver, handler);
+}
+
+static void init(size_t n)
+{
+    size_t i;
+
+    numMembers = n;
+    now = 0U;
+
+    for(i=0U; i < n; i++){
+
+        Event_init(&members[i]);
+        (void)Event_onTimeout(&members[i], (i + 1U) * SPACING, &members[i], handler);
+    }
+}
+
+/* every member is ticked in turn as if each MAC were polled */
+static void run_polling(size_t n)
+{
+    char name[40U];
+    unsigned long i;
+    size_t j;
+    double start;
+
+    init(n);
+
+    start = bench_seconds();
+
+    for(i=0U; i < OPS; i++){
+
+        now += SPACING;
+
+        for(j=0U; j < n; j++){
+
+            Event_tick(&members[j]);
+        }
+    }
+
+    (void)snprintf(name, sizeof(name), "dispatch (polling, %u)", (unsigned)n);
+    bench_report(name, "events", (double)OPS, bench_seconds() - start);
+}
+
+/* only members with a deadline due are ticked */
+static void run_group(size_t n)
+{
+    static struct lora_event_group group;
+    char name[40U];
+    unsigned long i;
+    size_t j;
+    double start;
+
+    init(n);
+
+    EventGroup_init(&group);
+
+    for(j=0U; j < n; j++){
+
+        (void)EventGroup_add(&group, &members[j]);
+    }
+
+    start = bench_seconds();
+
+    for(i=0U; i < OPS; i++){
+
+        now += SPACING;
+
+        EventGroup_tick(&group);
+    }
+
+    (void)snprintf(name, sizeof(name), "dispatch (group, %u)", (unsigned)n);
+    bench_report(name, "events", (double)OPS, bench_seconds() - start);
+}
+
+int main(void)
+{
+    static const size_t sizes[] = {1U, 32U, 1024U};
+    size_t i;
+
+    for(i=0U; i < sizeof(sizes)/sizeof(*sizes); i++){
+
+        if(sizes[i] <= LORA_EVENT_GROUP_SIZE){
+
+            run_polling(sizes[i]);
+            run_group(sizes[i]);
+        }
+    }
+
+    return 0;
+}
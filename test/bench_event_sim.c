@@ -0,0 +1,194 @@
+/* Discrete event simulation of many class A devices in virtual time
+ *
+ * Each device sends an uplink, waits for the radio to finish, opens
+ * RX1 and RX2, and then waits long enough to respect a 1% duty cycle
+ * before the next uplink. Radio interrupts are simulated with timers
+ * that call Event_receive().
+ *
+ * The run is repeated with the same seed to show that it is
+ * reproducible; the digest covers the time of every dispatch.
+ *
+ * */
+
+#include "lora_event.h"
+#include "lora_system.h"
+#include "bench.h"
+
+#include <stdlib.h>
+
+#define TICKS_PER_SECOND 100000ULL
+
+#define NUM_DEVICES 1000U
+#define SIM_SECONDS (24ULL * 3600ULL)
+#define SEED 42U
+
+#define RX_DELAY TICKS_PER_SECOND          /* RX1 one second after TX */
+#define RX_WINDOW 2000U                     /* ~20ms of preamble detection */
+
+struct device {
+
+    struct lora_event events;
+    uint32_t airTime;
+};
+
+static struct device devices[NUM_DEVICES];
+static struct lora_event_group group;
+static uint32_t state;
+static uint64_t digest;
+static unsigned long dispatched;
+
+/* static function prototypes *****************************************/
+
+static uint32_t next(void);
+static void record(uint64_t time);
+static void interrupt(struct device *self, void (*cb)(void *, uint64_t, uint64_t), uint64_t time);
+static void txIRQ(void *receiver, uint64_t time, uint64_t error);
+static void rxIRQ(void *receiver, uint64_t time, uint64_t error);
+static void uplink(void *receiver, uint64_t time, uint64_t error);
+static void txComplete(void *receiver, uint64_t time, uint64_t error);
+static void rxStart(void *receiver, uint64_t time, uint64_t error);
+static void rxTimeout(void *receiver, uint64_t time, uint64_t error);
+static uint64_t simulate(double *elapsed);
+
+/* functions **********************************************************/
+
+int main(void)
+{
+    uint64_t first;
+    uint64_t second;
+    double elapsed;
+
+    first = simulate(&elapsed);
+
+    printf("%u devices, %llu simulated seconds, %lu events\n", NUM_DEVICES, (unsigned long long)SIM_SECONDS, dispatched);
+
+    bench_report("virtual time", "simulated-s", (double)SIM_SECONDS, elapsed);
+    bench_report("virtual time", "events", (double)dispatched, elapsed);
+
+    second = simulate(&elapsed);
+
+    printf("digest %016llx %s\n", (unsigned long long)first, (first == second) ? "(reproducible)" : "(NOT REPRODUCIBLE)");
+
+    return (first == second) ? 0 : 1;
+}
+
+/* static functions ***************************************************/
+
+/* xorshift32 */
+static uint32_t next(void)
+{
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+
+    return state;
+}
+
+/* FNV-1a over dispatch times */
+static void record(uint64_t time)
+{
+    size_t i;
+
+    for(i=0U; i < sizeof(time); i++){
+
+        digest ^= (uint8_t)(time >> (i * 8U));
+        digest *= 0x100000001b3ULL;
+    }
+
+    dispatched++;
+}
+
+/* the next uplink and RX2 are still pending when the RX1 interrupt is
+ * scheduled so this fills the default pool of three timers */
+static void interrupt(struct device *self, void (*cb)(void *, uint64_t, uint64_t), uint64_t time)
+{
+    if(Event_onTimeout(&self->events, time, self, cb) == EVENT_HANDLE_NONE){
+
+        printf("timer pool exhausted\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+static void txIRQ(void *receiver, uint64_t time, uint64_t error)
+{
+    Event_receive(&((struct device *)receiver)->events, EVENT_TX_COMPLETE, time);
+}
+
+static void rxIRQ(void *receiver, uint64_t time, uint64_t error)
+{
+    Event_receive(&((struct device *)receiver)->events, EVENT_RX_TIMEOUT, time);
+}
+
+static void uplink(void *receiver, uint64_t time, uint64_t error)
+{
+    struct device *self = (struct device *)receiver;
+
+    record(time);
+
+    /* SF7 to SF12 */
+    self->airTime = 5000U << (next() % 6U);
+
+    (void)Event_onInput(&self->events, EVENT_TX_COMPLETE, self, txComplete);
+
+    interrupt(self, txIRQ, time + self->airTime);
+}
+
+static void txComplete(void *receiver, uint64_t time, uint64_t error)
+{
+    struct device *self = (struct device *)receiver;
+    uint64_t sent = time - error;
+
+    record(time);
+
+    (void)Event_onTimeout(&self->events, sent + RX_DELAY, self, rxStart);
+    (void)Event_onTimeout(&self->events, sent + RX_DELAY + TICKS_PER_SECOND, self, rxStart);
+
+    /* 1% duty cycle plus up to a minute of jitter */
+    (void)Event_onTimeout(&self->events, sent + (99U * (uint64_t)self->airTime) + (next() % (60U * TICKS_PER_SECOND)), self, uplink);
+}
+
+static void rxStart(void *receiver, uint64_t time, uint64_t error)
+{
+    struct device *self = (struct device *)receiver;
+
+    record(time);
+
+    (void)Event_onInput(&self->events, EVENT_RX_TIMEOUT, self, rxTimeout);
+
+    interrupt(self, rxIRQ, time + RX_WINDOW);
+}
+
+static void rxTimeout(void *receiver, uint64_t time, uint64_t error)
+{
+    record(time);
+}
+
+static uint64_t simulate(double *elapsed)
+{
+    size_t i;
+    double start;
+
+    state = SEED;
+    digest = 0xcbf29ce484222325ULL;
+    dispatched = 0U;
+
+    Event_setTime(0U);
+    EventGroup_init(&group);
+
+    for(i=0U; i < NUM_DEVICES; i++){
+
+        Event_init(&devices[i].events);
+        (void)EventGroup_add(&group, &devices[i].events);
+
+        /* devices power up over the first minute */
+        (void)Event_onTimeout(&devices[i].events, next() % (60U * TICKS_PER_SECOND), &devices[i], uplink);
+    }
+
+    start = bench_seconds();
+
+    EventGroup_advance(&group, SIM_SECONDS * TICKS_PER_SECOND);
+
+    *elapsed = bench_seconds() - start;
+
+    return digest;
+}
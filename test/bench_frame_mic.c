@@ -0,0 +1,114 @@
+#include "lora_frame.h"
+#include "bench.h"
+
+#include <string.h>
+
+#if defined(LORA_AES_HW)
+    #define ENGINE "hw"
+#elif defined(LORA_AES_TTABLE)
+    #define ENGINE "ttable"
+#elif defined(LORA_AES_BITSLICE) && defined(LORA_AES_BITSLICE_32)
+    #define ENGINE "bitslice32"
+#elif defined(LORA_AES_BITSLICE)
+    #define ENGINE "bitslice"
+#else
+    #define ENGINE "byte"
+#endif
+
+#define DEVICES 64U
+#define ROUNDS 20000UL
+
+/* stops the compiler discarding the work */
+static volatile uint8_t sink;
+
+int main(void)
+{
+    static struct lora_frame_keys keys[DEVICES];
+    static uint8_t buffer[DEVICES][UINT8_MAX];
+    static struct lora_frame_mic frames[DEVICES];
+    static const uint8_t payload[] = "{\"name\":\"Turiphro\",\"count\":13,\"water\":true}";
+    uint8_t key[16U];
+    uint8_t copy[UINT8_MAX];
+    struct lora_frame_data f;
+    struct lora_frame decoded;
+    unsigned long r;
+    size_t i;
+    size_t valid = 0U;
+    double start;
+    double decode;
+    double serial;
+    double batch;
+
+    /* one uplink from each of many devices, each with its own keys */
+    for(i=0U; i < DEVICES; i++){
+
+        (void)memset(key, (int)i, sizeof(key));
+        Frame_initKeys(&keys[i], key, key, key);
+
+        (void)memset(&f, 0, sizeof(f));
+        f.devAddr = (uint32_t)i;
+        f.counter = (uint16_t)i;
+        f.port = 1U;
+        f.data = payload;
+        f.dataLen = sizeof(payload) - 1U;
+
+        frames[i].keys = &keys[i];
+        frames[i].in = buffer[i];
+        frames[i].len = Frame_putDataWithKeys(FRAME_TYPE_DATA_UNCONFIRMED_UP, &keys[i].session, &f, buffer[i], sizeof(buffer[i]));
+    }
+
+    start = bench_seconds();
+
+    for(r=0U; r < ROUNDS; r++){
+
+        for(i=0U; i < DEVICES; i++){
+
+            (void)memcpy(copy, buffer[i], frames[i].len);
+            (void)Frame_decodeWithKeys(&keys[i], copy, frames[i].len, &decoded);
+            valid += decoded.valid ? 1U : 0U;
+        }
+    }
+
+    decode = bench_seconds() - start;
+
+    start = bench_seconds();
+
+    for(r=0U; r < ROUNDS; r++){
+
+        for(i=0U; i < DEVICES; i++){
+
+            Frame_verifyMICs(&frames[i], 1U);
+            valid += frames[i].valid ? 1U : 0U;
+        }
+    }
+
+    serial = bench_seconds() - start;
+
+    start = bench_seconds();
+
+    for(r=0U; r < ROUNDS; r++){
+
+        Frame_verifyMICs(frames, DEVICES);
+
+        for(i=0U; i < DEVICES; i++){
+
+            valid += frames[i].valid ? 1U : 0U;
+        }
+    }
+
+    batch = bench_seconds() - start;
+
+    bench_report("Frame_decode (" ENGINE ")", "frames", (double)(ROUNDS * DEVICES), decode);
+    bench_report("Frame_verifyMICs x1 (" ENGINE ")", "frames", (double)(ROUNDS * DEVICES), serial);
+    bench_report("Frame_verifyMICs x64 (" ENGINE ")", "frames", (double)(ROUNDS * DEVICES), batch);
+
+    if(valid != (3U * ROUNDS * DEVICES)){
+
+        printf("MIC verification failed\n");
+        return 1;
+    }
+
+    sink = (uint8_t)valid;
+
+    return 0;
+}
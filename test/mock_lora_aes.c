@@ -14,6 +14,16 @@ void LoraAES_encrypt(const struct lora_aes_ctx *ctx, uint8_t *s)
 {
 }
 
+#if !defined(LORA_AES_NO_DECRYPT)
 void LoraAES_decrypt(const struct lora_aes_ctx *ctx, uint8_t *s)
 {
 }
+#endif
+
+void LoraAES_ctr(const struct lora_aes_ctx *ctx, const uint8_t *iv, void *data, size_t len)
+{
+}
+
+void LoraAES_encryptBlocks(const struct lora_aes_ctx *const *ctx, uint8_t *s, size_t n)
+{
+}
@@ -12,6 +12,14 @@ void LoraCMAC_init(struct lora_cmac_ctx *ctx, const struct lora_aes_ctx *aes_ctx
 {
 }
 
+void LoraCMAC_initSubkeys(struct lora_cmac_subkeys *subkeys, const struct lora_aes_ctx *aes_ctx)
+{
+}
+
+void LoraCMAC_initWithSubkeys(struct lora_cmac_ctx *ctx, const struct lora_aes_ctx *aes_ctx, const struct lora_cmac_subkeys *subkeys)
+{
+}
+
 void LoraCMAC_update(struct lora_cmac_ctx *ctx, const void *data, uint8_t len)
 {
 }
@@ -20,3 +28,15 @@ void LoraCMAC_finish(const struct lora_cmac_ctx *ctx, void *out, uint8_t outMax)
 {
     memset(out, 0, outMax);
 }
+
+#ifndef LORA_DEVICE
+void LoraCMAC_batch(struct lora_cmac_batch *batch, size_t n)
+{
+    size_t i;
+    
+    for(i=0U; i < n; i++){
+        
+        memset(batch[i].mac, 0, sizeof(batch[i].mac));
+    }
+}
+#endif
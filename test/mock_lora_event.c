@@ -19,17 +19,22 @@ void Event_tick(struct lora_event *self)
 {
 }
 
-void *Event_onInput(struct lora_event *self, enum on_input_types event, void *receiver, event_handler_t handler)
+event_handle_t Event_onInput(struct lora_event *self, enum on_input_types event, void *receiver, event_handler_t handler)
 {
-    return mock_ptr_type(void *);
+    return mock_type(event_handle_t);
 }
 
-void *Event_onTimeout(struct lora_event *self, uint64_t timeout, void *receiver, event_handler_t handler)
+event_handle_t Event_onTimeout(struct lora_event *self, uint64_t timeout, void *receiver, event_handler_t handler)
 {
-    return mock_ptr_type(void *);
+    return mock_type(event_handle_t);
 }
 
-void Event_cancel(struct lora_event *self, void **event)
+event_handle_t Event_onTimeoutWithPriority(struct lora_event *self, uint64_t timeout, enum event_priority priority, void *receiver, event_handler_t handler)
+{
+    return mock_type(event_handle_t);
+}
+
+void Event_cancel(struct lora_event *self, event_handle_t *event)
 {
 }
 
@@ -37,3 +42,13 @@ uint64_t Event_intervalUntilNext(struct lora_event *self)
 {
     return mock();
 }
+
+uint64_t Event_nextDeadline(const struct lora_event *self)
+{
+    return mock();
+}
+
+uint64_t Event_budget(struct lora_event *self)
+{
+    return mock();
+}
@@ -37,3 +37,37 @@ bool Frame_isUpstream(enum lora_frame_type type)
 {
     return mock_type(bool);
 }
+
+void Frame_initKeys(struct lora_frame_keys *keys, const void *appKey, const void *nwkSKey, const void *appSKey)
+{
+}
+
+void Frame_initAppKey(struct lora_frame_keys *keys, const void *appKey)
+{
+}
+
+void Frame_initSessionKeys(struct lora_frame_session_keys *keys, const void *nwkSKey, const void *appSKey)
+{
+}
+
+size_t Frame_putDataWithKeys(enum lora_frame_type type, const struct lora_frame_session_keys *keys, const struct lora_frame_data *f, void *out, size_t max)
+{
+    return mock_type(size_t);
+}
+
+size_t Frame_putJoinRequestWithKeys(const struct lora_frame_keys *keys, const struct lora_frame_join_request *f, void *out, size_t max)
+{
+    return mock_type(size_t);
+}
+
+bool Frame_decodeWithKeys(const struct lora_frame_keys *keys, void *in, size_t len, struct lora_frame *f)
+{
+    *f = *mock_ptr_type(struct lora_frame *);
+    return mock_type(bool);
+}
+
+bool Frame_decodeDataWithKeys(const struct lora_frame_session_keys *keys, void *in, size_t len, struct lora_frame *f)
+{
+    *f = *mock_ptr_type(struct lora_frame *);
+    return mock_type(bool);
+}
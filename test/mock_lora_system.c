@@ -178,6 +178,12 @@ uint8_t System_getNbTrans(void *receiver)
     return self->nb_trans;    
 }
 
+void System_setNbTrans(void *receiver, uint8_t value)
+{
+    struct mock_system_param *self = (struct mock_system_param *)receiver;    
+    self->nb_trans = value;
+}
+
 uint8_t System_getTXPower(void *receiver)
 {
     struct mock_system_param *self = (struct mock_system_param *)receiver;    
@@ -6,3 +6,8 @@ uint64_t System_time(void)
 {
     return system_time;
 }
+
+uint32_t System_time32(void)
+{
+    return (uint32_t)system_time;
+}
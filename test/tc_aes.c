@@ -32,6 +32,24 @@ static void test_LoraAES_encrypt(void **user)
     assert_memory_equal(ct, out, sizeof(ct));
 }
 
+static void test_LoraAES_encrypt_fips197(void **user)
+{
+    /* FIPS-197 appendix C.1 */
+    static const uint8_t key[] = {0x00,0x01,0x02,0x03,0x04,0x05,0x06,0x07,0x08,0x09,0x0a,0x0b,0x0c,0x0d,0x0e,0x0f};
+    static const uint8_t pt[] = {0x00,0x11,0x22,0x33,0x44,0x55,0x66,0x77,0x88,0x99,0xaa,0xbb,0xcc,0xdd,0xee,0xff};
+    static const uint8_t ct[] = {0x69,0xc4,0xe0,0xd8,0x6a,0x7b,0x04,0x30,0xd8,0xcd,0xb7,0x80,0x70,0xb4,0xc5,0x5a};
+
+    struct lora_aes_ctx aes;
+    uint8_t out[AES_BLOCK_SIZE];
+
+    memcpy(out, pt, sizeof(out));
+    LoraAES_init(&aes, key);
+    LoraAES_encrypt(&aes, out);
+
+    assert_memory_equal(ct, out, sizeof(ct));
+}
+
+#if !defined(LORA_AES_NO_DECRYPT)
 static void test_LoraAES_decrypt(void **user)
 {
     static const uint8_t key[] = {0x10,0xa5,0x88,0x69,0xd7,0x4b,0xe5,0xa3,0x74,0xcf,0x86,0x7c,0xfb,0x47,0x38,0x59};
@@ -47,13 +65,76 @@ static void test_LoraAES_decrypt(void **user)
 
     assert_memory_equal(pt, out, sizeof(pt));
 }
+#endif
+
+static void test_LoraAES_ctr(void **user)
+{
+    /* SP 800-38A F.5.1 (last block truncated) */
+    static const uint8_t key[] = {0x2b,0x7e,0x15,0x16,0x28,0xae,0xd2,0xa6,0xab,0xf7,0x15,0x88,0x09,0xcf,0x4f,0x3c};
+    static const uint8_t iv[] = {0xf0,0xf1,0xf2,0xf3,0xf4,0xf5,0xf6,0xf7,0xf8,0xf9,0xfa,0xfb,0xfc,0xfd,0xfe,0xff};
+    static const uint8_t pt[] = {
+        0x6b,0xc1,0xbe,0xe2,0x2e,0x40,0x9f,0x96,0xe9,0x3d,0x7e,0x11,0x73,0x93,0x17,0x2a,
+        0xae,0x2d,0x8a,0x57,0x1e,0x03,0xac,0x9c,0x9e,0xb7,0x6f,0xac,0x45,0xaf,0x8e,0x51,
+        0x30,0xc8,0x1c,0x46,0xa3,0x5c,0xe4,0x11,0xe5,0xfb,0xc1,0x19,0x1a,0x0a,0x52,0xef,
+        0xf6,0x9f,0x24,0x45,0xdf,0x4f,0x9b,0x17
+    };
+    static const uint8_t ct[] = {
+        0x87,0x4d,0x61,0x91,0xb6,0x20,0xe3,0x26,0x1b,0xef,0x68,0x64,0x99,0x0d,0xb6,0xce,
+        0x98,0x06,0xf6,0x6b,0x79,0x70,0xfd,0xff,0x86,0x17,0x18,0x7b,0xb9,0xff,0xfd,0xff,
+        0x5a,0xe4,0xdf,0x3e,0xdb,0xd5,0xd3,0x5e,0x5b,0x4f,0x09,0x02,0x0d,0xb0,0x3e,0xab,
+        0x1e,0x03,0x1d,0xda,0x2f,0xbe,0x03,0xd1
+    };
+
+    struct lora_aes_ctx aes;
+    uint8_t out[sizeof(pt)];
+
+    memcpy(out, pt, sizeof(out));
+    LoraAES_init(&aes, key);
+    LoraAES_ctr(&aes, iv, out, sizeof(out));
+
+    assert_memory_equal(ct, out, sizeof(ct));
+}
+
+static void test_LoraAES_encryptBlocks(void **user)
+{
+    /* SP 800-38A F.1.1 and FIPS-197 C.1 interleaved (odd count, mixed keys) */
+    static const uint8_t spKey[] = {0x2b,0x7e,0x15,0x16,0x28,0xae,0xd2,0xa6,0xab,0xf7,0x15,0x88,0x09,0xcf,0x4f,0x3c};
+    static const uint8_t fipsKey[] = {0x00,0x01,0x02,0x03,0x04,0x05,0x06,0x07,0x08,0x09,0x0a,0x0b,0x0c,0x0d,0x0e,0x0f};
+    static const uint8_t pt[] = {
+        0x6b,0xc1,0xbe,0xe2,0x2e,0x40,0x9f,0x96,0xe9,0x3d,0x7e,0x11,0x73,0x93,0x17,0x2a,
+        0x00,0x11,0x22,0x33,0x44,0x55,0x66,0x77,0x88,0x99,0xaa,0xbb,0xcc,0xdd,0xee,0xff,
+        0xae,0x2d,0x8a,0x57,0x1e,0x03,0xac,0x9c,0x9e,0xb7,0x6f,0xac,0x45,0xaf,0x8e,0x51
+    };
+    static const uint8_t ct[] = {
+        0x3a,0xd7,0x7b,0xb4,0x0d,0x7a,0x36,0x60,0xa8,0x9e,0xca,0xf3,0x24,0x66,0xef,0x97,
+        0x69,0xc4,0xe0,0xd8,0x6a,0x7b,0x04,0x30,0xd8,0xcd,0xb7,0x80,0x70,0xb4,0xc5,0x5a,
+        0xf5,0xd3,0xd5,0x85,0x03,0xb9,0x69,0x9d,0xe7,0x85,0x89,0x5a,0x96,0xfd,0xba,0xaf
+    };
+
+    struct lora_aes_ctx sp;
+    struct lora_aes_ctx fips;
+    const struct lora_aes_ctx *keys[] = {&sp, &fips, &sp};
+    uint8_t out[sizeof(pt)];
+
+    memcpy(out, pt, sizeof(out));
+    LoraAES_init(&sp, spKey);
+    LoraAES_init(&fips, fipsKey);
+    LoraAES_encryptBlocks(keys, out, 3U);
+
+    assert_memory_equal(ct, out, sizeof(ct));
+}
 
 int main(void)
 {
     const struct CMUnitTest tests[] = {
         cmocka_unit_test(test_LoraAES_init),
         cmocka_unit_test(test_LoraAES_encrypt),        
+        cmocka_unit_test(test_LoraAES_encrypt_fips197),        
+#if !defined(LORA_AES_NO_DECRYPT)
         cmocka_unit_test(test_LoraAES_decrypt),        
+#endif
+        cmocka_unit_test(test_LoraAES_ctr),        
+        cmocka_unit_test(test_LoraAES_encryptBlocks),        
     };
 
     return cmocka_run_group_tests(tests, NULL, NULL);
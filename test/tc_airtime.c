@@ -0,0 +1,92 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+
+#include "cmocka.h"
+
+#include "lora_airtime.h"
+#include "lora_mac.h"
+
+#include <math.h>
+
+/* helpers */
+
+/* 4.1.1.7 of the sx1272 datasheet in floating point (microseconds) */
+static double reference(enum lora_spreading_factor sf, enum lora_signal_bandwidth bw, enum lora_coding_rate cr, uint8_t options, uint8_t size)
+{
+    double Ts = ((double)(1UL << sf) * 1000000.0) / (double)bw;
+    double Tpreamble = ((double)LORA_AIRTIME_PREAMBLE + 4.25) * Ts;
+    double de = ((options & LORA_AIRTIME_LDRO) != 0U) ? 1.0 : 0.0;
+    double crc = ((options & LORA_AIRTIME_CRC) != 0U) ? 1.0 : 0.0;
+    double ih = ((options & LORA_AIRTIME_IMPLICIT_HEADER) != 0U) ? 1.0 : 0.0;
+    double blocks = ceil(((8.0 * size) - (4.0 * sf) + 28.0 + (16.0 * crc) - (20.0 * ih)) / (4.0 * (sf - (2.0 * de))));
+    double Npayload = 8.0 + (fmax(blocks, 0.0) * ((double)cr + 4.0));
+
+    return Tpreamble + (Npayload * Ts);
+}
+
+/* tests */
+
+static void us_shall_match_datasheet_for_all_settings(void **user)
+{
+    static const enum lora_signal_bandwidth bws[] = {BW_125, BW_250, BW_500};
+    enum lora_spreading_factor sf;
+    enum lora_coding_rate cr;
+    double expected;
+    size_t bw;
+    uint8_t options;
+    unsigned size;
+
+    for(sf=SF_7; sf <= SF_12; sf++){
+        for(bw=0U; bw < sizeof(bws)/sizeof(*bws); bw++){
+            for(cr=CR_5; cr <= CR_8; cr++){
+                for(options=0U; options < 8U; options++){
+                    for(size=0U; size <= 255U; size++){
+
+                        expected = reference(sf, bws[bw], cr, options, size);
+
+                        assert_int_equal((uint32_t)expected, Airtime_us(sf, bws[bw], cr, options, size));
+                        assert_int_equal((uint32_t)((expected * LORA_TICKS_PER_SECOND) / 1000000.0), Airtime_ticks(sf, bws[bw], cr, options, size));
+                    }
+                }
+            }
+        }
+    }
+}
+
+static void us_shall_match_known_lorawan_frames(void **user)
+{
+    /* 13 byte uplink (no application payload) */
+    assert_int_equal(46336U, Airtime_us(SF_7, BW_125, CR_5, LORA_AIRTIME_CRC, 13U));
+    assert_int_equal(1155072U, Airtime_us(SF_12, BW_125, CR_5, LORA_AIRTIME_CRC | LORA_AIRTIME_LDRO, 13U));
+}
+
+static void fsk_shall_have_no_airtime(void **user)
+{
+    assert_int_equal(0U, Airtime_us(SF_FSK, BW_125, CR_5, 0U, 10U));
+    assert_int_equal(0U, Airtime_ticks(SF_7, BW_FSK, CR_5, 0U, 10U));
+}
+
+static void ldro_shall_be_required_for_16ms_symbols(void **user)
+{
+    assert_false(Airtime_lowDataRateOptimize(SF_10, BW_125));
+    assert_true(Airtime_lowDataRateOptimize(SF_11, BW_125));
+    assert_true(Airtime_lowDataRateOptimize(SF_12, BW_125));
+    assert_false(Airtime_lowDataRateOptimize(SF_11, BW_250));
+    assert_true(Airtime_lowDataRateOptimize(SF_12, BW_250));
+    assert_false(Airtime_lowDataRateOptimize(SF_12, BW_500));
+}
+
+/* runner */
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(us_shall_match_datasheet_for_all_settings),
+        cmocka_unit_test(us_shall_match_known_lorawan_frames),
+        cmocka_unit_test(fsk_shall_have_no_airtime),
+        cmocka_unit_test(ldro_shall_be_required_for_16ms_symbols),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
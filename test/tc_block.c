@@ -0,0 +1,73 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+
+#include "cmocka.h"
+
+#include "lora_block.h"
+
+#include <string.h>
+
+static void test_LoraBlock_xor128(void **user)
+{
+    static const uint8_t a[] = {0x00,0x01,0x02,0x03,0x04,0x05,0x06,0x07,0x08,0x09,0x0a,0x0b,0x0c,0x0d,0x0e,0x0f};
+    static const uint8_t b[] = {0xff,0xfe,0xfd,0xfc,0xfb,0xfa,0xf9,0xf8,0x0f,0x0e,0x0d,0x0c,0x0b,0x0a,0x09,0x08};
+    static const uint8_t expected[] = {0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0x07,0x07,0x07,0x07,0x07,0x07,0x07,0x07};
+    uint8_t buf[1U + 16U];
+
+    /* unaligned accumulator */
+    memcpy(&buf[1], a, sizeof(a));
+    LoraBlock_xor128(&buf[1], b);
+
+    assert_memory_equal(expected, &buf[1], sizeof(expected));
+}
+
+static void test_LoraBlock_xor128_aliased(void **user)
+{
+    static const uint8_t a[] = {0x00,0x01,0x02,0x03,0x04,0x05,0x06,0x07,0x08,0x09,0x0a,0x0b,0x0c,0x0d,0x0e,0x0f};
+    static const uint8_t expected[16U] = {0};
+    uint8_t buf[16U];
+
+    memcpy(buf, a, sizeof(a));
+    LoraBlock_xor128(buf, buf);
+
+    assert_memory_equal(expected, buf, sizeof(expected));
+}
+
+static void test_LoraBlock_leftShift128(void **user)
+{
+    /* L to K1 from RFC 4493 (before the conditional XOR with Rb) */
+    static const uint8_t l[] = {0x7d,0xf7,0x6b,0x0c,0x1a,0xb8,0x99,0xb3,0x3e,0x42,0xf0,0x47,0xb9,0x1b,0x54,0x6f};
+    static const uint8_t expected[] = {0xfb,0xee,0xd6,0x18,0x35,0x71,0x33,0x66,0x7c,0x85,0xe0,0x8f,0x72,0x36,0xa8,0xde};
+    uint8_t buf[1U + 16U];
+
+    memcpy(&buf[1], l, sizeof(l));
+    LoraBlock_leftShift128(&buf[1]);
+
+    assert_memory_equal(expected, &buf[1], sizeof(expected));
+}
+
+static void test_LoraBlock_leftShift128_carry(void **user)
+{
+    /* top bit is discarded and every byte boundary carries */
+    static const uint8_t v[] = {0x80,0x80,0x80,0x80,0x80,0x80,0x80,0x80,0x80,0x80,0x80,0x80,0x80,0x80,0x80,0x81};
+    static const uint8_t expected[] = {0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x01,0x02};
+    uint8_t buf[16U];
+
+    memcpy(buf, v, sizeof(v));
+    LoraBlock_leftShift128(buf);
+
+    assert_memory_equal(expected, buf, sizeof(expected));
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_LoraBlock_xor128),
+        cmocka_unit_test(test_LoraBlock_xor128_aliased),
+        cmocka_unit_test(test_LoraBlock_leftShift128),
+        cmocka_unit_test(test_LoraBlock_leftShift128_carry),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
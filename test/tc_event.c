@@ -20,6 +20,41 @@ static void eventHandler(void *receiver, uint64_t time, uint64_t error)
     check_expected(error);
 }
 
+static uint64_t dispatched[EVENT_NUM_TIMERS];
+static size_t numDispatched;
+
+static void orderHandler(void *receiver, uint64_t time, uint64_t error)
+{
+    dispatched[numDispatched] = *(const uint64_t *)receiver;
+    numDispatched++;
+}
+
+#if !defined(LORA_EVENT_BATCH_TIME)
+/* takes 8 ticks to run */
+static void slowHandler(void *receiver, uint64_t time, uint64_t error)
+{
+    orderHandler(receiver, time, error);
+    system_time += 8U;
+}
+#endif
+
+static uint64_t burstTimes[2U];
+static size_t numBurst;
+
+/* registers itself again for the next event */
+static void burstHandler(void *receiver, uint64_t time, uint64_t error)
+{
+    struct lora_event *self = (struct lora_event *)receiver;
+    
+    burstTimes[numBurst] = time - error;
+    numBurst++;
+    
+    if(numBurst < 2U){
+        
+        (void)Event_onInput(self, EVENT_TX_COMPLETE, self, burstHandler);
+    }
+}
+
 /* setups */
 
 static int setup_event(void **user)
@@ -39,7 +74,7 @@ static int setup_event_and_register_timeout_at_42_ticks(void **user)
         
         struct lora_event *self = (struct lora_event *)(*user);    
                 
-        if(Event_onTimeout(self, 42U, self, eventHandler) == NULL){
+        if(Event_onTimeout(self, 42U, self, eventHandler) == EVENT_HANDLE_NONE){
             
             retval = -1;
         }
@@ -96,7 +131,7 @@ static void event_shall_be_initialised(void **user)
 static void onTimeout_shall_register_timout_handler(void **user)
 {    
     struct lora_event *self = (struct lora_event *)(*user);    
-    assert_true( Event_onTimeout(self, 0U, self, eventHandler) != NULL );    
+    assert_true( Event_onTimeout(self, 0U, self, eventHandler) != EVENT_HANDLE_NONE );    
 }
 
 static void onTimeout_shall_return_null_if_resource_not_available(void **user)
@@ -109,7 +144,7 @@ static void onTimeout_shall_return_null_if_resource_not_available(void **user)
         Event_onTimeout(self, 0U, self, eventHandler);
     }
     
-    assert_true( Event_onTimeout(self, 0U, self, eventHandler) == NULL );    
+    assert_true( Event_onTimeout(self, 0U, self, eventHandler) == EVENT_HANDLE_NONE );    
 }
 
 static void tick_shall_service_handler_at_timeout(void **user)
@@ -138,6 +173,36 @@ static void tick_shall_service_handler_after_timeout(void **user)
     Event_tick(self);    
 }
 
+static void tick_shall_count_clock_reads(void **user)
+{
+    struct lora_event *self = (struct lora_event *)(*user);    
+    
+    assert_true( Event_onTimeout(self, 40U, self, eventHandler) != EVENT_HANDLE_NONE );
+    
+    system_time = 50U;
+    
+    expect_value(eventHandler, receiver, self);
+    expect_value(eventHandler, time, system_time);
+    expect_value(eventHandler, error, 10U);
+    
+    expect_value(eventHandler, receiver, self);
+    expect_value(eventHandler, time, system_time);
+    expect_value(eventHandler, error, 8U);
+    
+    Event_tick(self);    
+    
+#if defined(LORA_EVENT_TIME_DELTA)
+    /* one full read, the rest from System_time32() */
+    assert_int_equal(1U, self->clockReads);
+#elif defined(LORA_EVENT_BATCH_TIME)
+    /* once per round and once to confirm nothing else is due */
+    assert_int_equal(2U, self->clockReads);
+#else
+    /* once per handler as well */
+    assert_int_equal(4U, self->clockReads);
+#endif
+}
+
 static void tick_shall_not_service_handler_before_timeout(void **user)
 {
     struct lora_event *self = (struct lora_event *)(*user);    
@@ -150,6 +215,7 @@ static void intervalUntilNext_shall_return_max_interval_if_no_event_is_pending(v
     struct lora_event *self = (struct lora_event *)(*user);    
     
     assert_true( Event_intervalUntilNext(self) == UINT64_MAX );
+    assert_true( Event_nextDeadline(self) == UINT64_MAX );
 }
 
 static void intervalUntilNext_shall_return_interval_until_next_pending_event(void **user)
@@ -167,27 +233,516 @@ static void intervalUntilNext_shall_return_interval_until_next_pending_event(voi
     assert_true( Event_intervalUntilNext(self) == 0U );
 }
 
+static void nextDeadline_shall_return_time_of_next_event(void **user)
+{
+    struct lora_event *self = (struct lora_event *)(*user);    
+    
+    assert_true( Event_nextDeadline(self) == 42U );
+    
+    /* does not depend on the clock */
+    system_time = 50U;
+    
+    assert_true( Event_nextDeadline(self) == 42U );
+    
+    assert_true( Event_onTimeout(self, 30U, self, eventHandler) != EVENT_HANDLE_NONE );
+    
+    assert_true( Event_nextDeadline(self) == 30U );
+    
+    Event_receive(self, EVENT_RX_READY, 50U);
+    
+    assert_true( Event_nextDeadline(self) == 0U );
+}
+
 static void cancel_shall_remove_timeout_handler(void **user)
 {
     struct lora_event *self = (struct lora_event *)(*user);    
     
-    void *ptr = Event_onTimeout(self, 42U, self, eventHandler);
+    event_handle_t ptr = Event_onTimeout(self, 42U, self, eventHandler);
     
-    assert_true( ptr != NULL );
+    assert_true( ptr != EVENT_HANDLE_NONE );
     assert_true( Event_intervalUntilNext(self) == 42U );
     
     Event_cancel(self, &ptr);
     
-    assert_true( ptr == NULL );
+    assert_true( ptr == EVENT_HANDLE_NONE );
     assert_true( Event_intervalUntilNext(self) == UINT64_MAX );    
 }
 
+static void tick_shall_service_handlers_in_deadline_order(void **user)
+{
+    struct lora_event *self = (struct lora_event *)(*user);    
+    static uint64_t timeouts[EVENT_NUM_TIMERS];
+    event_handle_t ptr[EVENT_NUM_TIMERS];
+    size_t i;
+    size_t expected = 0U;
+    
+    numDispatched = 0U;
+    
+    /* some deadlines are repeated */
+    for(i=0U; i < EVENT_NUM_TIMERS; i++){
+        
+        timeouts[i] = ((i * 7U) % 5U) + 1U;
+        ptr[i] = Event_onTimeout(self, timeouts[i], &timeouts[i], orderHandler);
+        assert_true( ptr[i] != EVENT_HANDLE_NONE );
+    }
+    
+    /* cancel one from the middle */
+    Event_cancel(self, &ptr[EVENT_NUM_TIMERS / 2U]);
+    assert_true( ptr[EVENT_NUM_TIMERS / 2U] == EVENT_HANDLE_NONE );
+    
+    system_time = 100U;
+    
+    Event_tick(self);
+    
+    assert_int_equal(EVENT_NUM_TIMERS - 1U, numDispatched);
+    
+    for(i=0U; i < numDispatched; i++){
+        
+        if(i > 0U){
+            
+            assert_true( dispatched[i-1U] <= dispatched[i] );
+        }
+        
+        expected += dispatched[i];
+    }
+    
+    for(i=0U; i < EVENT_NUM_TIMERS; i++){
+        
+        expected -= (i == (EVENT_NUM_TIMERS / 2U)) ? 0U : timeouts[i];
+    }
+    
+    assert_int_equal(0U, expected);
+    
+    /* every timer is returned to the pool */
+    for(i=0U; i < EVENT_NUM_TIMERS; i++){
+        
+        assert_true( Event_onTimeout(self, 200U, self, eventHandler) != EVENT_HANDLE_NONE );
+    }
+}
+
 static void cancel_shall_remove_input_handler(void **user)
 {
     struct lora_event *self = (struct lora_event *)(*user);    
     
-    void *ptr = Event_onInput(self, 42U, self, eventHandler);    
+    event_handle_t ptr = Event_onInput(self, EVENT_RX_READY, self, eventHandler);    
     Event_cancel(self, &ptr);    
+    
+    assert_true( ptr == EVENT_HANDLE_NONE );
+    
+    Event_receive(self, EVENT_RX_READY, 0U);
+    
+    /* eventHandler would fail on unexpected call */
+    Event_tick(self);
+}
+
+static void cancel_shall_ignore_stale_timeout_handle(void **user)
+{
+    struct lora_event *self = (struct lora_event *)(*user);    
+    size_t i;
+    
+    event_handle_t stale = Event_onTimeout(self, 0U, self, eventHandler);
+    event_handle_t copy = stale;
+    
+    Event_cancel(self, &copy);
+    
+    /* the freed slot is reused by one of these */
+    for(i=0U; i < EVENT_NUM_TIMERS; i++){
+        
+        assert_true( Event_onTimeout(self, 42U, self, eventHandler) != EVENT_HANDLE_NONE );
+    }
+    
+    Event_cancel(self, &stale);
+    
+    assert_true( stale == EVENT_HANDLE_NONE );
+    assert_true( Event_intervalUntilNext(self) == 42U );    
+}
+
+static void cancel_shall_ignore_stale_input_handle(void **user)
+{
+    struct lora_event *self = (struct lora_event *)(*user);    
+    
+    event_handle_t stale = Event_onInput(self, EVENT_RX_READY, self, eventHandler);
+    
+    (void)Event_onInput(self, EVENT_RX_READY, self, eventHandler);
+    
+    Event_cancel(self, &stale);
+    
+    system_time = 42U;
+    
+    Event_receive(self, EVENT_RX_READY, 42U);
+    
+    expect_value(eventHandler, receiver, self);
+    expect_value(eventHandler, time, 42U);
+    expect_value(eventHandler, error, 0U);
+    
+    Event_tick(self);
+}
+
+static void tick_shall_service_io_events_in_order_received(void **user)
+{
+    struct lora_event *self = (struct lora_event *)(*user);    
+    static uint8_t first;
+    static uint8_t second;
+    
+    (void)Event_onInput(self, EVENT_RX_READY, &second, eventHandler);
+    (void)Event_onInput(self, EVENT_RX_TIMEOUT, &first, eventHandler);
+    
+    Event_receive(self, EVENT_RX_TIMEOUT, 10U);
+    Event_receive(self, EVENT_RX_READY, 12U);
+    
+    system_time = 20U;
+    
+    assert_true( Event_intervalUntilNext(self) == 0U );
+    
+    expect_value(eventHandler, receiver, &first);
+    expect_value(eventHandler, time, 20U);
+    expect_value(eventHandler, error, 10U);
+    
+    expect_value(eventHandler, receiver, &second);
+    expect_value(eventHandler, time, 20U);
+    expect_value(eventHandler, error, 8U);
+    
+    Event_tick(self);
+    
+    assert_true( Event_intervalUntilNext(self) == UINT64_MAX );
+}
+
+static void tick_shall_keep_every_io_event_timestamp(void **user)
+{
+    struct lora_event *self = (struct lora_event *)(*user);    
+    
+    numBurst = 0U;
+    
+    (void)Event_onInput(self, EVENT_TX_COMPLETE, self, burstHandler);
+    
+    Event_receive(self, EVENT_TX_COMPLETE, 3U);
+    Event_receive(self, EVENT_TX_COMPLETE, 5U);
+    
+    system_time = 10U;
+    
+    Event_tick(self);
+    
+    assert_int_equal(2U, numBurst);
+    assert_int_equal(3U, burstTimes[0]);
+    assert_int_equal(5U, burstTimes[1]);
+}
+
+static void onInput_shall_discard_events_queued_before_registration(void **user)
+{
+    struct lora_event *self = (struct lora_event *)(*user);    
+    
+    (void)Event_onInput(self, EVENT_RX_TIMEOUT, self, eventHandler);
+    
+    Event_receive(self, EVENT_RX_READY, 3U);
+    Event_receive(self, EVENT_RX_TIMEOUT, 5U);
+    
+    (void)Event_onInput(self, EVENT_RX_READY, self, eventHandler);
+    
+    Event_receive(self, EVENT_RX_READY, 7U);
+    
+    system_time = 10U;
+    
+    /* the RX_READY at 3 was not for this handler */
+    expect_value(eventHandler, receiver, self);
+    expect_value(eventHandler, time, 10U);
+    expect_value(eventHandler, error, 5U);
+    
+    expect_value(eventHandler, receiver, self);
+    expect_value(eventHandler, time, 10U);
+    expect_value(eventHandler, error, 3U);
+    
+    Event_tick(self);
+}
+
+static void receive_shall_drop_events_when_queue_full(void **user)
+{
+    struct lora_event *self = (struct lora_event *)(*user);    
+    size_t i;
+    
+    for(i=0U; i < (LORA_EVENT_QUEUE_SIZE + 1U); i++){
+        
+        Event_receive(self, EVENT_RX_READY, i);
+    }
+    
+    assert_int_equal(1U, self->queue.dropped);
+    assert_int_equal(LORA_EVENT_QUEUE_SIZE, self->queue.highWater);
+    
+    /* nobody is waiting so these are discarded */
+    Event_tick(self);
+    
+    assert_true( Event_intervalUntilNext(self) == UINT64_MAX );
+}
+
+#if defined(LORA_EVENT_STATS)
+static void nopHandler(void *receiver, uint64_t time, uint64_t error)
+{
+}
+
+static void tick_shall_record_dispatch_lateness(void **user)
+{
+    struct lora_event *self = (struct lora_event *)(*user);    
+    struct lora_event_stats stats;
+    
+    assert_false( Event_getStats(self, nopHandler, &stats) );
+    
+    (void)Event_onTimeout(self, 10U, NULL, nopHandler);
+    system_time = 10U;
+    Event_tick(self);
+    
+    (void)Event_onTimeout(self, 20U, NULL, nopHandler);
+    system_time = 25U;
+    Event_tick(self);
+    
+    (void)Event_onTimeout(self, 30U, NULL, nopHandler);
+    system_time = 30U + LORA_EVENT_LATE_TICKS;
+    Event_tick(self);
+    
+    assert_true( Event_getStats(self, nopHandler, &stats) );
+    
+    assert_int_equal(3U, stats.count);
+    assert_int_equal(1U, stats.late);
+    assert_int_equal(0U, stats.min);
+    assert_int_equal(LORA_EVENT_LATE_TICKS, stats.max);
+    
+    /* 0, [4,8), [64,128) */
+    assert_int_equal(1U, stats.histogram[0U]);
+    assert_int_equal(1U, stats.histogram[3U]);
+    assert_int_equal(1U, stats.histogram[7U]);
+}
+
+static void tick_shall_record_io_event_lateness(void **user)
+{
+    struct lora_event *self = (struct lora_event *)(*user);    
+    struct lora_event_stats stats;
+    
+    (void)Event_onInput(self, EVENT_RX_READY, NULL, nopHandler);
+    
+    Event_receive(self, EVENT_RX_READY, 10U);
+    system_time = 11U;
+    Event_tick(self);
+    
+    assert_true( Event_getStats(self, nopHandler, &stats) );
+    
+    assert_int_equal(1U, stats.count);
+    assert_int_equal(0U, stats.late);
+    assert_int_equal(1U, stats.min);
+    assert_int_equal(1U, stats.max);
+    assert_int_equal(1U, stats.histogram[1U]);
+}
+
+static void clearStats_shall_forget_handlers(void **user)
+{
+    struct lora_event *self = (struct lora_event *)(*user);    
+    struct lora_event_stats stats;
+    
+    (void)Event_onTimeout(self, 0U, NULL, nopHandler);
+    Event_tick(self);
+    
+    assert_true( Event_getStats(self, nopHandler, &stats) );
+    
+    Event_clearStats(self);
+    
+    assert_false( Event_getStats(self, nopHandler, &stats) );
+}
+#endif
+
+#if defined(LORA_EVENT_GROUP)
+static struct lora_event members[3U];
+static struct lora_event_group group;
+
+static int setup_group(void **user)
+{
+    size_t i;
+    
+    EventGroup_init(&group);
+    
+    for(i=0U; i < sizeof(members)/sizeof(*members); i++){
+        
+        Event_init(&members[i]);
+        
+        if(!EventGroup_add(&group, &members[i])){
+            
+            return -1;
+        }
+    }
+    
+    *user = (void *)&group;
+    system_time = 0U;
+    
+    return 0;
+}
+
+static void groupTick_shall_only_visit_members_with_events_due(void **user)
+{
+    struct lora_event_group *self = (struct lora_event_group *)(*user);
+    static const uint64_t id[] = {0U, 1U, 2U};
+    
+    numDispatched = 0U;
+    
+    (void)Event_onTimeout(&members[0U], 30U, (void *)&id[0U], orderHandler);
+    (void)Event_onTimeout(&members[1U], 10U, (void *)&id[1U], orderHandler);
+    (void)Event_onTimeout(&members[2U], 20U, (void *)&id[2U], orderHandler);
+    
+    assert_true( EventGroup_nextDeadline(self) == 10U );
+    
+    system_time = 20U;
+    
+    EventGroup_tick(self);
+    
+    assert_int_equal(2U, numDispatched);
+    assert_true( dispatched[0U] == 1U );
+    assert_true( dispatched[1U] == 2U );
+    
+    /* never ticked */
+    assert_int_equal(0U, members[0U].clockReads);
+    
+    assert_true( EventGroup_nextDeadline(self) == 30U );
+}
+
+static void groupNextDeadline_shall_follow_cancel(void **user)
+{
+    struct lora_event_group *self = (struct lora_event_group *)(*user);
+    event_handle_t handle;
+    
+    handle = Event_onTimeout(&members[1U], 10U, NULL, orderHandler);
+    (void)Event_onTimeout(&members[2U], 20U, NULL, orderHandler);
+    
+    assert_true( EventGroup_nextDeadline(self) == 10U );
+    
+    Event_cancel(&members[1U], &handle);
+    
+    assert_true( EventGroup_nextDeadline(self) == 20U );
+}
+
+static void groupTick_shall_service_member_io_events(void **user)
+{
+    struct lora_event_group *self = (struct lora_event_group *)(*user);
+    
+    (void)Event_onTimeout(&members[0U], 100U, NULL, orderHandler);
+    (void)Event_onInput(&members[2U], EVENT_RX_READY, &members[2U], eventHandler);
+    
+    Event_receive(&members[2U], EVENT_RX_READY, 5U);
+    
+    assert_true( EventGroup_nextDeadline(self) == 0U );
+    
+    system_time = 6U;
+    
+    expect_value(eventHandler, receiver, &members[2U]);
+    expect_value(eventHandler, time, 6U);
+    expect_value(eventHandler, error, 1U);
+    
+    EventGroup_tick(self);
+    
+    assert_true( EventGroup_nextDeadline(self) == 100U );
+}
+
+static void groupRemove_shall_stop_servicing_member(void **user)
+{
+    struct lora_event_group *self = (struct lora_event_group *)(*user);
+    
+    (void)Event_onTimeout(&members[1U], 10U, NULL, eventHandler);
+    (void)Event_onTimeout(&members[2U], 20U, NULL, orderHandler);
+    
+    EventGroup_remove(self, &members[1U]);
+    
+    assert_true( EventGroup_nextDeadline(self) == 20U );
+    
+    /* eventHandler would fail on an unexpected call */
+    system_time = 10U;
+    EventGroup_tick(self);
+    
+    assert_true( EventGroup_add(self, &members[1U]) );
+    assert_true( EventGroup_nextDeadline(self) == 10U );
+}
+#endif
+
+static void onTimeout_shall_track_most_timers_pending(void **user)
+{
+    struct lora_event *self = (struct lora_event *)(*user);    
+    static const uint64_t id = 0U;
+    event_handle_t handle;
+    
+    numDispatched = 0U;
+    
+    handle = Event_onTimeout(self, 10U, (void *)&id, orderHandler);
+    (void)Event_onTimeout(self, 20U, (void *)&id, orderHandler);
+    
+    Event_cancel(self, &handle);
+    
+    assert_int_equal(1U, self->timersPending);
+    assert_int_equal(2U, self->timersHighWater);
+    
+    system_time = 20U;
+    Event_tick(self);
+    
+    assert_int_equal(0U, self->timersPending);
+    assert_int_equal(2U, self->timersHighWater);
+}
+
+static void tick_shall_service_high_priority_timers_first(void **user)
+{
+    struct lora_event *self = (struct lora_event *)(*user);    
+    static const uint64_t id[] = {0U, 1U};
+    
+    numDispatched = 0U;
+    
+    (void)Event_onTimeout(self, 10U, (void *)&id[0U], orderHandler);
+    (void)Event_onTimeoutWithPriority(self, 20U, EVENT_PRIORITY_HIGH, (void *)&id[1U], orderHandler);
+    
+    assert_true( Event_nextDeadline(self) == 10U );
+    
+    system_time = 30U;
+    Event_tick(self);
+    
+    assert_int_equal(2U, numDispatched);
+    assert_true( dispatched[0U] == 1U );
+    assert_true( dispatched[1U] == 0U );
+}
+
+#if !defined(LORA_EVENT_BATCH_TIME)
+static void tick_shall_let_high_priority_timer_preempt_normal_timers(void **user)
+{
+    struct lora_event *self = (struct lora_event *)(*user);    
+    static const uint64_t id[] = {0U, 1U, 2U};
+    
+    numDispatched = 0U;
+    
+    (void)Event_onTimeout(self, 10U, (void *)&id[0U], slowHandler);
+    (void)Event_onTimeout(self, 11U, (void *)&id[1U], orderHandler);
+    (void)Event_onTimeoutWithPriority(self, 15U, EVENT_PRIORITY_HIGH, (void *)&id[2U], orderHandler);
+    
+    /* the high priority timer is due by the time the slow handler returns */
+    system_time = 12U;
+    Event_tick(self);
+    
+    assert_int_equal(3U, numDispatched);
+    assert_true( dispatched[0U] == 0U );
+    assert_true( dispatched[1U] == 2U );
+    assert_true( dispatched[2U] == 1U );
+}
+#endif
+
+static void budget_shall_return_ticks_until_high_priority_deadline(void **user)
+{
+    struct lora_event *self = (struct lora_event *)(*user);    
+    static const uint64_t id = 0U;
+    event_handle_t handle;
+    
+    (void)Event_onTimeout(self, 10U, (void *)&id, orderHandler);
+    
+    assert_true( Event_budget(self) == UINT64_MAX );
+    
+    handle = Event_onTimeoutWithPriority(self, 100U, EVENT_PRIORITY_HIGH, (void *)&id, orderHandler);
+    
+    system_time = 40U;
+    assert_true( Event_budget(self) == 60U );
+    
+    system_time = 101U;
+    assert_true( Event_budget(self) == 0U );
+    
+    Event_cancel(self, &handle);
+    
+    assert_true( Event_budget(self) == UINT64_MAX );
 }
 
 static void onInput_shall_register_input_handler(void **user)
@@ -228,6 +783,15 @@ int main(void)
             tick_shall_not_service_handler_before_timeout, 
             setup_event_and_register_timeout_at_42_ticks
         ),
+        cmocka_unit_test_setup(
+            tick_shall_count_clock_reads, 
+            setup_event_and_register_timeout_at_42_ticks
+        ),
+        
+        cmocka_unit_test_setup(
+            tick_shall_service_handlers_in_deadline_order, 
+            setup_event
+        ),
         
         cmocka_unit_test_setup(
             intervalUntilNext_shall_return_max_interval_if_no_event_is_pending, 
@@ -237,11 +801,31 @@ int main(void)
             intervalUntilNext_shall_return_interval_until_next_pending_event, 
             setup_event_and_register_timeout_at_42_ticks
         ),
+        cmocka_unit_test_setup(
+            nextDeadline_shall_return_time_of_next_event, 
+            setup_event_and_register_timeout_at_42_ticks
+        ),
         
         cmocka_unit_test_setup(
             onInput_shall_register_input_handler, 
             setup_event
         ),            
+        cmocka_unit_test_setup(
+            tick_shall_service_io_events_in_order_received, 
+            setup_event
+        ),            
+        cmocka_unit_test_setup(
+            tick_shall_keep_every_io_event_timestamp, 
+            setup_event
+        ),            
+        cmocka_unit_test_setup(
+            onInput_shall_discard_events_queued_before_registration, 
+            setup_event
+        ),            
+        cmocka_unit_test_setup(
+            receive_shall_drop_events_when_queue_full, 
+            setup_event
+        ),            
         
         cmocka_unit_test_setup(
             cancel_shall_remove_timeout_handler, 
@@ -251,6 +835,64 @@ int main(void)
             cancel_shall_remove_input_handler, 
             setup_event
         ),        
+        cmocka_unit_test_setup(
+            cancel_shall_ignore_stale_timeout_handle, 
+            setup_event
+        ),        
+        cmocka_unit_test_setup(
+            cancel_shall_ignore_stale_input_handle, 
+            setup_event
+        ),        
+        cmocka_unit_test_setup(
+            onTimeout_shall_track_most_timers_pending, 
+            setup_event
+        ),        
+        cmocka_unit_test_setup(
+            tick_shall_service_high_priority_timers_first, 
+            setup_event
+        ),        
+#if !defined(LORA_EVENT_BATCH_TIME)
+        cmocka_unit_test_setup(
+            tick_shall_let_high_priority_timer_preempt_normal_timers, 
+            setup_event
+        ),        
+#endif
+        cmocka_unit_test_setup(
+            budget_shall_return_ticks_until_high_priority_deadline, 
+            setup_event
+        ),        
+#if defined(LORA_EVENT_GROUP)
+        cmocka_unit_test_setup(
+            groupTick_shall_only_visit_members_with_events_due, 
+            setup_group
+        ),        
+        cmocka_unit_test_setup(
+            groupNextDeadline_shall_follow_cancel, 
+            setup_group
+        ),        
+        cmocka_unit_test_setup(
+            groupTick_shall_service_member_io_events, 
+            setup_group
+        ),        
+        cmocka_unit_test_setup(
+            groupRemove_shall_stop_servicing_member, 
+            setup_group
+        ),        
+#endif
+#if defined(LORA_EVENT_STATS)
+        cmocka_unit_test_setup(
+            tick_shall_record_dispatch_lateness, 
+            setup_event
+        ),        
+        cmocka_unit_test_setup(
+            tick_shall_record_io_event_lateness, 
+            setup_event
+        ),        
+        cmocka_unit_test_setup(
+            clearStats_shall_forget_handlers, 
+            setup_event
+        ),        
+#endif
     };
 
     return cmocka_run_group_tests(tests, NULL, NULL);
@@ -123,6 +123,34 @@ static void encode_croft_example(void **user)
     assert_memory_equal(expected, buffer, retval);    
 }
 
+static void encode_croft_example_with_keys(void **user)
+{
+    uint8_t retval;
+    uint8_t buffer[UINT8_MAX];
+    const uint8_t payload[] = "{\"name\":\"Turiphro\",\"count\":13,\"water\":true}";
+    const uint8_t key[] = {0x2B, 0x7E, 0x15, 0x16, 0x28, 0xAE, 0xD2, 0xA6, 0xAB, 0xF7, 0x15, 0x88, 0x09, 0xCF, 0x4F, 0x3C};
+    const uint8_t expected[] = {0x80, 0x8F, 0x77, 0xBB, 0x07, 0x00, 0x02, 0x00, 0x06, 0xBD, 0x33, 0x42, 0xA1, 0x9F, 0xCC, 0x3C, 0x8D, 0x6B, 0xCB, 0x5F, 0xDB, 0x05, 0x48, 0xDB, 0x4D, 0xC8, 0x50, 0x14, 0xAE, 0xEB, 0xFE, 0x0B, 0x54, 0xB1, 0xC9, 0x98, 0xDE, 0xF5, 0x3E, 0x97, 0x9B, 0x70, 0x1D, 0xAB, 0xB0, 0x45, 0x30, 0x0E, 0xF8, 0x69, 0x9C, 0x38, 0xFC, 0x1A, 0x34, 0xD5};
+    
+    struct lora_frame_data f;
+    struct lora_frame_keys keys;
+    
+    (void)memset(&f, 0, sizeof(f));
+    
+    f.devAddr = 0x07BB778F;
+    f.counter = 2;
+    f.port = 6;
+    f.data = payload;
+    f.dataLen = sizeof(payload)-1;
+    
+    Frame_initKeys(&keys, key, key, key);
+    
+    retval = Frame_putDataWithKeys(FRAME_TYPE_DATA_CONFIRMED_UP, &keys.session, &f, buffer, sizeof(buffer));
+    
+    assert_int_equal(sizeof(expected), retval);
+    
+    assert_memory_equal(expected, buffer, retval);    
+}
+
 static void encode_random_internet_join_request_example(void **user)
 {
     uint8_t retval;
@@ -245,6 +273,29 @@ static void decode_croft_example(void **user)
     assert_true(f.valid);
 }
 
+static void decode_croft_example_with_keys(void **user)
+{
+    const uint8_t key[] = {0x2B, 0x7E, 0x15, 0x16, 0x28, 0xAE, 0xD2, 0xA6, 0xAB, 0xF7, 0x15, 0x88, 0x09, 0xCF, 0x4F, 0x3C};
+    const uint8_t payload[] = "{\"name\":\"Turiphro\",\"count\":13,\"water\":true}";
+    uint8_t input[] = {0x80, 0x8F, 0x77, 0xBB, 0x07, 0x00, 0x02, 0x00, 0x06, 0xBD, 0x33, 0x42, 0xA1, 0x9F, 0xCC, 0x3C, 0x8D, 0x6B, 0xCB, 0x5F, 0xDB, 0x05, 0x48, 0xDB, 0x4D, 0xC8, 0x50, 0x14, 0xAE, 0xEB, 0xFE, 0x0B, 0x54, 0xB1, 0xC9, 0x98, 0xDE, 0xF5, 0x3E, 0x97, 0x9B, 0x70, 0x1D, 0xAB, 0xB0, 0x45, 0x30, 0x0E, 0xF8, 0x69, 0x9C, 0x38, 0xFC, 0x1A, 0x34, 0xD5};
+    
+    struct lora_frame f;
+    struct lora_frame_keys keys;
+    
+    Frame_initKeys(&keys, key, key, key);
+    
+    bool result = Frame_decodeWithKeys(&keys, input, sizeof(input), &f);
+    
+    assert_true(result);    
+    
+    assert_int_equal(FRAME_TYPE_DATA_CONFIRMED_UP, f.type);    
+    
+    assert_true(f.valid);
+    
+    assert_int_equal(sizeof(payload)-1, f.fields.data.dataLen);    
+    assert_memory_equal(payload, f.fields.data.data, f.fields.data.dataLen);    
+}
+
 static void decode_random_internet_join_request_example(void **user)
 {
     const uint8_t key[] = {0xB6, 0xB5, 0x3F, 0x4A, 0x16, 0x8A, 0x7A, 0x88, 0xBD, 0xF7, 0xEA, 0x13, 0x5C, 0xE9, 0xCF, 0xCA};
@@ -260,6 +311,28 @@ static void decode_random_internet_join_request_example(void **user)
     
     assert_true(f.valid);
 }
+static void decode_only_needs_keys_for_frame_type(void **user)
+{
+    const uint8_t key[] = {0xB6, 0xB5, 0x3F, 0x4A, 0x16, 0x8A, 0x7A, 0x88, 0xBD, 0xF7, 0xEA, 0x13, 0x5C, 0xE9, 0xCF, 0xCA};
+    const uint8_t joinRequest[] = {0x00, 0xDC, 0x00, 0x00, 0xD0, 0x7E, 0xD5, 0xB3, 0x70, 0x1E, 0x6F, 0xED, 0xF5, 0x7C, 0xEE, 0xAF, 0x00, 0x85, 0xCC, 0x58, 0x7F, 0xE9, 0x13};
+    uint8_t input[sizeof(joinRequest)];
+    
+    struct lora_frame f;
+    struct lora_frame_keys keys;
+    
+    (void)memcpy(input, joinRequest, sizeof(input));
+    assert_true(Frame_decode(key, NULL, NULL, input, sizeof(input), &f));
+    assert_true(f.valid);
+    
+    (void)memcpy(input, joinRequest, sizeof(input));
+    assert_false(Frame_decode(NULL, key, key, input, sizeof(input), &f));
+    
+    Frame_initKeys(&keys, key, key, key);
+    
+    (void)memcpy(input, joinRequest, sizeof(input));
+    assert_false(Frame_decodeDataWithKeys(&keys.session, input, sizeof(input), &f));
+}
+
 static void decode_random_internet_data_example(void **user)
 {
     const uint8_t key[] = "\xD8\x9D\x14\xAD\xB3\xD8\x04\x1E\x48\x26\xA7\x98\x28\x92\xAF\x74";
@@ -274,6 +347,62 @@ static void decode_random_internet_data_example(void **user)
     assert_true(f.valid);
 }
 
+static void verify_mics(void **user)
+{
+    const uint8_t zeroKey[] = "\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00";
+    const uint8_t croftKey[] = {0x2B, 0x7E, 0x15, 0x16, 0x28, 0xAE, 0xD2, 0xA6, 0xAB, 0xF7, 0x15, 0x88, 0x09, 0xCF, 0x4F, 0x3C};
+    const uint8_t internetKey[] = {0xB6, 0xB5, 0x3F, 0x4A, 0x16, 0x8A, 0x7A, 0x88, 0xBD, 0xF7, 0xEA, 0x13, 0x5C, 0xE9, 0xCF, 0xCA};
+    
+    const uint8_t unconfirmedUp[] = "\x40\x00\x00\x00\x00\x00\x00\x00\x00\xBD\x1D\x9E\x61\x6F\xB5\xFB\x03\x22\x02\x52\xAB\xDC\x77\x2F";
+    const uint8_t joinRequest[] = "\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x71\x84\x9D\xAA";
+    const uint8_t joinAccept[] = "\x20\xE3\xDE\x10\x87\x95\xF7\x76\xB8\x03\x76\x10\xEF\x78\x69\xB5\xB3";
+    const uint8_t joinAcceptWithCFList[] = "\x20\x14\x0F\x0F\x10\x11\xB5\x22\x3D\x79\x58\x77\x17\xFF\xD9\xEC\x3A\xB6\x05\xA8\x02\xAC\x97\xDD\xE7\xAC\xF0\x5C\x87\xEF\xAC\x47\xAF";
+    const uint8_t croft[] = {0x80, 0x8F, 0x77, 0xBB, 0x07, 0x00, 0x02, 0x00, 0x06, 0xBD, 0x33, 0x42, 0xA1, 0x9F, 0xCC, 0x3C, 0x8D, 0x6B, 0xCB, 0x5F, 0xDB, 0x05, 0x48, 0xDB, 0x4D, 0xC8, 0x50, 0x14, 0xAE, 0xEB, 0xFE, 0x0B, 0x54, 0xB1, 0xC9, 0x98, 0xDE, 0xF5, 0x3E, 0x97, 0x9B, 0x70, 0x1D, 0xAB, 0xB0, 0x45, 0x30, 0x0E, 0xF8, 0x69, 0x9C, 0x38, 0xFC, 0x1A, 0x34, 0xD5};
+    const uint8_t internetJoinRequest[] = {0x00, 0xDC, 0x00, 0x00, 0xD0, 0x7E, 0xD5, 0xB3, 0x70, 0x1E, 0x6F, 0xED, 0xF5, 0x7C, 0xEE, 0xAF, 0x00, 0x85, 0xCC, 0x58, 0x7F, 0xE9, 0x13};
+    const uint8_t badMHDR[] = {0x41, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+    uint8_t corruptCroft[sizeof(croft)];
+    
+    struct lora_frame_keys zero;
+    struct lora_frame_keys croftKeys;
+    struct lora_frame_keys internet;
+    
+    Frame_initKeys(&zero, zeroKey, zeroKey, zeroKey);
+    Frame_initKeys(&croftKeys, croftKey, croftKey, croftKey);
+    Frame_initKeys(&internet, internetKey, internetKey, internetKey);
+    
+    (void)memcpy(corruptCroft, croft, sizeof(croft));
+    corruptCroft[20] ^= 0x01U;
+    
+    struct lora_frame_mic frames[] = {
+        {.keys = &zero, .in = unconfirmedUp, .len = sizeof(unconfirmedUp)-1U},
+        {.keys = &croftKeys, .in = croft, .len = sizeof(croft)},
+        {.keys = &zero, .in = joinRequest, .len = sizeof(joinRequest)-1U},
+        {.keys = &croftKeys, .in = corruptCroft, .len = sizeof(corruptCroft)},
+        {.keys = &zero, .in = joinAccept, .len = sizeof(joinAccept)-1U},
+        {.keys = &zero, .in = croft, .len = sizeof(croft)},
+        {.keys = &zero, .in = joinAcceptWithCFList, .len = sizeof(joinAcceptWithCFList)-1U},
+        {.keys = &zero, .in = badMHDR, .len = sizeof(badMHDR)},
+        {.keys = &zero, .in = unconfirmedUp, .len = 5U},
+        {.keys = &internet, .in = internetJoinRequest, .len = sizeof(internetJoinRequest)},
+    };
+    
+    Frame_verifyMICs(frames, sizeof(frames)/sizeof(*frames));
+    
+    assert_true(frames[0].valid);
+    assert_true(frames[1].valid);
+    assert_true(frames[2].valid);
+    assert_false(frames[3].valid);
+    assert_true(frames[4].valid);
+    assert_false(frames[5].valid);
+    assert_true(frames[6].valid);
+    assert_false(frames[7].valid);
+    assert_false(frames[8].valid);
+    assert_true(frames[9].valid);
+    
+    /* verification must not decrypt in place */
+    assert_int_equal(0xE3, joinAccept[1]);
+}
+
 int main(void)
 {
     const struct CMUnitTest tests[] = {
@@ -282,6 +411,7 @@ int main(void)
         cmocka_unit_test(encode_join_accept),        
         cmocka_unit_test(encode_join_accept_with_cf_list),        
         cmocka_unit_test(encode_croft_example),        
+        cmocka_unit_test(encode_croft_example_with_keys),        
         
         cmocka_unit_test(encode_random_internet_join_request_example),        
         
@@ -292,9 +422,13 @@ int main(void)
         cmocka_unit_test(decode_join_accept),        
         cmocka_unit_test(decode_join_accept_with_cf_list),                
         cmocka_unit_test(decode_croft_example),                
+        cmocka_unit_test(decode_croft_example_with_keys),                
         
         cmocka_unit_test(decode_random_internet_join_request_example),                
+        cmocka_unit_test(decode_only_needs_keys_for_frame_type),                
         cmocka_unit_test(decode_random_internet_data_example),                
+        
+        cmocka_unit_test(verify_mics),
     };
 
     return cmocka_run_group_tests(tests, NULL, NULL);
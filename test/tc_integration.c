@@ -7,8 +7,7 @@
 #include "lora_mac.h"
 #include "lora_radio_sx1272.h"
 
-static const uint8_t eui[] = "\x00\x00\x00\x00\x00\x00\x00\x00";
-static const uint8_t key[] = "\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00";
+#include <string.h>
 
 static void responseHandler(void *receiver, enum lora_mac_response_type type, const union lora_mac_response_arg *arg)
 {
@@ -20,6 +19,8 @@ static void test_init(void **user)
     struct lora_board board;
     struct lora_radio radio;
 
+    (void)memset(&board, 0, sizeof(board));
+
     Radio_init(&radio, &board);
 
     MAC_init(&self, NULL, EU_863_870, &radio, NULL, responseHandler);
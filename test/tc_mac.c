@@ -13,7 +13,6 @@
 
 #include <string.h>
 
-static const uint8_t eui[] = "\x00\x00\x00\x00\x00\x00\x00\x00";
 static const uint8_t key[] = "\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00";
 
 static void responseHandler(void *receiver, enum lora_mac_response_type type, const union lora_mac_response_arg *arg);
@@ -301,6 +300,552 @@ static void unconfirmed_send_shall_callback_when_cycle_complete(void **user)
     assert_true(MAC_ticksUntilNextEvent(self) == UINT64_MAX);
 }
 
+/* send an unconfirmed uplink and receive `message` in RX1 */
+static void send_and_receive_at_rx1(struct lora_mac *self, const uint8_t *message, size_t messageSize)
+{
+    static const char msg[] = "hello world";
+    
+    assert_true(MAC_send(self, false, 1U, msg, strlen(msg)));
+    will_return(Radio_transmit, true);    
+    MAC_tick(self);   
+    
+    MAC_radioEvent(self, LORA_RADIO_TX_COMPLETE, System_time());
+    MAC_tick(self);
+    
+    system_time += MAC_ticksUntilNextEvent(self);
+    will_return(Radio_receive, true);    
+    MAC_tick(self);
+    
+    will_return(Radio_collect, (uint8_t)messageSize);
+    will_return(Radio_collect, message);
+    MAC_radioEvent(self, LORA_RADIO_RX_READY, System_time());
+    expect_value(responseHandler, type, LORA_MAC_READY);
+    MAC_tick(self);
+}
+
+static void finish_unconfirmed_send(struct lora_mac *self)
+{
+    // io event: tx complete
+    MAC_radioEvent(self, LORA_RADIO_TX_COMPLETE, System_time());
+    MAC_tick(self);
+    
+    // rx1 and rx2 both time out
+    system_time += MAC_ticksUntilNextEvent(self);
+    will_return(Radio_receive, true);    
+    MAC_tick(self);
+    MAC_radioEvent(self, LORA_RADIO_RX_TIMEOUT, System_time());
+    MAC_tick(self);
+    
+    system_time += MAC_ticksUntilNextEvent(self);
+    will_return(Radio_receive, true);    
+    MAC_tick(self);
+    MAC_radioEvent(self, LORA_RADIO_RX_TIMEOUT, System_time());
+    
+    expect_value(responseHandler, type, LORA_MAC_READY);
+    MAC_tick(self);        
+}
+
+/* send an unconfirmed uplink as soon as a channel is available and return the channel used */
+static uint8_t send_on_next_channel(struct lora_mac *self)
+{
+    static const char msg[] = "hello world";
+    
+    system_time += MAC_ticksUntilNextChannel(self);
+    
+    assert_true(MAC_send(self, false, 1U, msg, strlen(msg)));
+    will_return(Radio_transmit, true);    
+    MAC_tick(self);
+    
+    finish_unconfirmed_send(self);
+    
+    return self->tx.chIndex;
+}
+
+static void answers_shall_be_sent_in_fopts_of_next_uplink(void **user)
+{
+    struct lora_mac *self = (struct lora_mac *)(*user);
+    static const uint8_t devStatusReq[] = {0x06U};
+    static const char msg[] = "hello world";
+    struct lora_frame_data f;
+    uint8_t message[50U];
+    size_t messageSize;
+    
+    ((struct mock_system_param *)self->system)->battery_level = 0x7fU;
+    
+    (void)memset(&f, 0, sizeof(f));
+    f.devAddr = System_getDevAddr(self->system);
+    f.opts = devStatusReq;
+    f.optsLen = sizeof(devStatusReq);
+    messageSize = Frame_putData(FRAME_TYPE_DATA_UNCONFIRMED_DOWN, key, key, &f, message, sizeof(message));
+    
+    send_and_receive_at_rx1(self, message, messageSize);
+    
+    system_time += MAC_ticksUntilNextChannel(self);
+    
+    assert_true(MAC_send(self, false, 1U, msg, strlen(msg)));
+    
+    // DevStatusAns (CID, battery, margin) in FOpts
+    assert_int_equal(13U + 3U + strlen(msg), self->bufferLen);
+    assert_int_equal(3U, self->buffer[5U] & 0xfU);
+    assert_int_equal(0x06U, self->buffer[8U]);
+    assert_int_equal(0x7fU, self->buffer[9U]);
+}
+
+static void answers_shall_be_sent_on_port_0_if_too_large_for_fopts(void **user)
+{
+    struct lora_mac *self = (struct lora_mac *)(*user);
+    static const uint8_t devStatusReq[] = {0x06U, 0x06U, 0x06U, 0x06U, 0x06U, 0x06U};
+    struct lora_frame_data f;
+    uint8_t message[50U];
+    size_t messageSize;
+    
+    (void)memset(&f, 0, sizeof(f));
+    f.devAddr = System_getDevAddr(self->system);
+    f.port = 0U;
+    f.data = devStatusReq;
+    f.dataLen = sizeof(devStatusReq);
+    messageSize = Frame_putData(FRAME_TYPE_DATA_UNCONFIRMED_DOWN, key, key, &f, message, sizeof(message));
+    
+    send_and_receive_at_rx1(self, message, messageSize);
+    
+    // MAC sends the answers itself once a channel is available
+    assert_true(future_event_is_pending(self));
+    system_time += MAC_ticksUntilNextEvent(self);
+    will_return(Radio_transmit, true);    
+    MAC_tick(self);
+    
+    assert_int_equal(13U + (6U * 3U), self->bufferLen);
+    assert_int_equal(0U, self->buffer[5U] & 0xfU);
+    assert_int_equal(0U, self->buffer[8U]);
+}
+
+static void link_adr_req_shall_be_applied_and_answered(void **user)
+{
+    struct lora_mac *self = (struct lora_mac *)(*user);
+    struct mock_system_param *params = (struct mock_system_param *)self->system;
+    // DR3, TXPower 2, channels 0 and 1, NbTrans 2
+    static const uint8_t linkADRReq[] = {0x03U, 0x32U, 0x03U, 0x00U, 0x02U};
+    static const char msg[] = "hello world";
+    struct lora_mac_adr_stats stats;
+    struct lora_frame_data f;
+    uint8_t message[50U];
+    size_t messageSize;
+    
+    (void)memset(&f, 0, sizeof(f));
+    f.devAddr = System_getDevAddr(self->system);
+    f.opts = linkADRReq;
+    f.optsLen = sizeof(linkADRReq);
+    messageSize = Frame_putData(FRAME_TYPE_DATA_UNCONFIRMED_DOWN, key, key, &f, message, sizeof(message));
+    
+    send_and_receive_at_rx1(self, message, messageSize);
+    
+    assert_int_equal(3U, params->tx_rate);
+    assert_int_equal(2U, params->tx_power);
+    assert_int_equal(2U, params->nb_trans);
+    assert_false(System_channelIsMasked(self->system, 0U));
+    assert_false(System_channelIsMasked(self->system, 1U));
+    assert_true(System_channelIsMasked(self->system, 2U));
+    
+    MAC_getADRStats(self, &stats);
+    assert_int_equal(1U, stats.linkADRAccepted);
+    assert_int_equal(7U, stats.lastStatus);
+    
+    system_time += MAC_ticksUntilNextChannel(self);
+    
+    assert_true(MAC_send(self, false, 1U, msg, strlen(msg)));
+    
+    // LinkADRAns with every bit set in FOpts
+    assert_int_equal(2U, self->buffer[5U] & 0xfU);
+    assert_int_equal(0x03U, self->buffer[8U]);
+    assert_int_equal(0x07U, self->buffer[9U]);
+}
+
+static void link_adr_req_block_shall_be_rejected_as_a_whole(void **user)
+{
+    struct lora_mac *self = (struct lora_mac *)(*user);
+    struct mock_system_param *params = (struct mock_system_param *)self->system;
+    // second request also enables channel 5 which does not exist
+    static const uint8_t linkADRReq[] = {
+        0x03U, 0x32U, 0x03U, 0x00U, 0x02U,
+        0x03U, 0x32U, 0x23U, 0x00U, 0x02U
+    };
+    static const char msg[] = "hello world";
+    struct lora_mac_adr_stats stats;
+    struct lora_frame_data f;
+    uint8_t message[50U];
+    size_t messageSize;
+    
+    (void)memset(&f, 0, sizeof(f));
+    f.devAddr = System_getDevAddr(self->system);
+    f.opts = linkADRReq;
+    f.optsLen = sizeof(linkADRReq);
+    messageSize = Frame_putData(FRAME_TYPE_DATA_UNCONFIRMED_DOWN, key, key, &f, message, sizeof(message));
+    
+    send_and_receive_at_rx1(self, message, messageSize);
+    
+    assert_int_equal(Region_getTXRate(EU_863_870), params->tx_rate);
+    assert_int_equal(Region_getTXPower(EU_863_870), params->tx_power);
+    assert_false(System_channelIsMasked(self->system, 2U));
+    
+    MAC_getADRStats(self, &stats);
+    assert_int_equal(0U, stats.linkADRAccepted);
+    assert_int_equal(1U, stats.linkADRRejected);
+    
+    system_time += MAC_ticksUntilNextChannel(self);
+    
+    assert_true(MAC_send(self, false, 1U, msg, strlen(msg)));
+    
+    // both requests answered with the channel mask bit clear
+    assert_int_equal(4U, self->buffer[5U] & 0xfU);
+    assert_int_equal(0x03U, self->buffer[8U]);
+    assert_int_equal(0x06U, self->buffer[9U]);
+    assert_int_equal(0x03U, self->buffer[10U]);
+    assert_int_equal(0x06U, self->buffer[11U]);
+}
+
+static void adr_shall_lower_rate_without_downlinks(void **user)
+{
+    struct lora_mac *self = (struct lora_mac *)(*user);
+    static const char msg[] = "hello world";
+    struct lora_mac_adr_stats stats;
+    uint8_t rate = System_getTXRate(self->system);
+    
+    MAC_setADR(self, true);
+    
+    // one uplink short of ADR_ACK_LIMIT + ADR_ACK_DELAY
+    self->adrAckCounter = Region_getADRAckLimit(EU_863_870) + Region_getADRAckDelay(EU_863_870) - 1U;
+    
+    assert_true(MAC_send(self, false, 1U, msg, strlen(msg)));
+    
+    // ADR and ADRACKReq
+    assert_int_equal(0xc0U, self->buffer[5U] & 0xc0U);
+    
+    // the next uplink is one rate lower
+    assert_int_equal(rate - 1U, System_getTXRate(self->system));
+    
+    MAC_getADRStats(self, &stats);
+    assert_int_equal(1U, stats.ackReq);
+    assert_int_equal(1U, stats.rateDecreased);
+    assert_int_equal(Region_getADRAckLimit(EU_863_870) + Region_getADRAckDelay(EU_863_870), stats.ackCounter);
+}
+
+static void unconfirmed_send_shall_be_repeated_nbtrans_times(void **user)
+{
+    struct lora_mac *self = (struct lora_mac *)(*user);
+    struct mock_system_param *params = (struct mock_system_param *)self->system;
+    static const char msg[] = "hello world";
+    uint8_t frame[sizeof(self->buffer)];
+    uint8_t frameLen;
+    uint16_t upCounter;
+    uint8_t prev;
+    size_t i;
+    
+    System_setNbTrans(self->system, 3U);
+    
+    assert_true(MAC_send(self, false, 1U, msg, strlen(msg)));
+    will_return(Radio_transmit, true);    
+    MAC_tick(self);
+    
+    (void)memcpy(frame, self->buffer, self->bufferLen);
+    frameLen = self->bufferLen;
+    upCounter = params->upCounter;
+    
+    for(i=0U; i < 2U; i++){
+        
+        prev = self->tx.chIndex;
+        
+        MAC_radioEvent(self, LORA_RADIO_TX_COMPLETE, System_time());
+        MAC_tick(self);
+        
+        // rx1 and rx2 both time out
+        system_time += MAC_ticksUntilNextEvent(self);
+        will_return(Radio_receive, true);    
+        MAC_tick(self);
+        MAC_radioEvent(self, LORA_RADIO_RX_TIMEOUT, System_time());
+        MAC_tick(self);
+        
+        system_time += MAC_ticksUntilNextEvent(self);
+        will_return(Radio_receive, true);    
+        MAC_tick(self);
+        MAC_radioEvent(self, LORA_RADIO_RX_TIMEOUT, System_time());
+        MAC_tick(self);
+        
+        // the same frame goes out on another channel once one is available
+        assert_true(future_event_is_pending(self));
+        system_time += MAC_ticksUntilNextEvent(self);
+        will_return(Radio_transmit, true);    
+        MAC_tick(self);
+        
+        assert_true(self->tx.chIndex != prev);
+        assert_int_equal(frameLen, self->bufferLen);
+        assert_memory_equal(frame, self->buffer, frameLen);
+        assert_int_equal(upCounter, params->upCounter);
+    }
+    
+    // ready after the third transmission
+    finish_unconfirmed_send(self);
+    
+    assert_true(MAC_ticksUntilNextEvent(self) == UINT64_MAX);
+}
+
+static void unconfirmed_repeats_shall_stop_on_a_downlink(void **user)
+{
+    struct lora_mac *self = (struct lora_mac *)(*user);
+    struct lora_frame_data f;
+    uint8_t message[50U];
+    size_t messageSize;
+    
+    (void)memset(&f, 0, sizeof(f));
+    f.devAddr = System_getDevAddr(self->system);
+    messageSize = Frame_putData(FRAME_TYPE_DATA_UNCONFIRMED_DOWN, key, key, &f, message, sizeof(message));
+    
+    System_setNbTrans(self->system, 3U);
+    
+    send_and_receive_at_rx1(self, message, messageSize);
+    
+    assert_true(MAC_ticksUntilNextEvent(self) == UINT64_MAX);
+}
+
+static void channel_selection_shall_avoid_the_previous_channel(void **user)
+{
+    struct lora_mac *self = (struct lora_mac *)(*user);
+    uint8_t prev;
+    uint8_t next;
+    size_t i;
+    
+    (void)System_maskChannel(self->system, 2U);
+    MAC_reloadChannels(self);
+    
+    prev = send_on_next_channel(self);
+    
+    for(i=0U; i < 4U; i++){
+        
+        next = send_on_next_channel(self);
+        
+        assert_true(next < 2U);
+        assert_true(next != prev);
+        
+        prev = next;
+    }
+}
+
+static void channel_selection_shall_follow_the_channel_mask(void **user)
+{
+    struct lora_mac *self = (struct lora_mac *)(*user);
+    static const char msg[] = "hello world";
+    size_t i;
+    
+    (void)System_maskChannel(self->system, 0U);
+    (void)System_maskChannel(self->system, 1U);
+    MAC_reloadChannels(self);
+    
+    for(i=0U; i < 3U; i++){
+        
+        assert_int_equal(2U, send_on_next_channel(self));
+    }
+    
+    (void)System_unmaskChannel(self->system, 1U);
+    (void)System_maskChannel(self->system, 2U);
+    MAC_reloadChannels(self);
+    
+    assert_int_equal(1U, send_on_next_channel(self));
+    
+    (void)System_maskChannel(self->system, 1U);
+    MAC_reloadChannels(self);
+    
+    assert_true(MAC_ticksUntilNextChannel(self) == UINT64_MAX);
+    assert_false(MAC_send(self, false, 1U, msg, strlen(msg)));
+}
+
+static void channel_selection_shall_filter_by_rate(void **user)
+{
+    struct lora_mac *self = (struct lora_mac *)(*user);
+    
+    // DR0 only, and in a different band to channels 0..2
+    (void)System_setChannel(self->system, 3U, 867100000U, 0U, 0U);
+    MAC_reloadChannels(self);
+    
+    assert_true(send_on_next_channel(self) < 3U);
+    
+    // channel 3 is free but cannot be used at DR5
+    assert_true(MAC_ticksUntilNextChannel(self) > 0U);
+    
+    assert_true(MAC_setRate(self, 0U));
+    
+    assert_int_equal(0U, MAC_ticksUntilNextChannel(self));
+    assert_int_equal(3U, send_on_next_channel(self));
+}
+
+static void new_channel_req_shall_reload_channels(void **user)
+{
+    struct lora_mac *self = (struct lora_mac *)(*user);
+    // disable channel 3 (frequency 0)
+    static const uint8_t newChannelReq[] = {0x07U, 0x03U, 0x00U, 0x00U, 0x00U, 0x50U};
+    struct lora_frame_data f;
+    uint8_t message[50U];
+    size_t messageSize;
+    
+    (void)System_setChannel(self->system, 3U, 867100000U, 0U, 5U);
+    (void)System_maskChannel(self->system, 0U);
+    (void)System_maskChannel(self->system, 1U);
+    (void)System_maskChannel(self->system, 2U);
+    MAC_reloadChannels(self);
+    
+    (void)memset(&f, 0, sizeof(f));
+    f.devAddr = System_getDevAddr(self->system);
+    f.opts = newChannelReq;
+    f.optsLen = sizeof(newChannelReq);
+    messageSize = Frame_putData(FRAME_TYPE_DATA_UNCONFIRMED_DOWN, key, key, &f, message, sizeof(message));
+    
+    assert_true(MAC_ticksUntilNextChannel(self) != UINT64_MAX);
+    
+    send_and_receive_at_rx1(self, message, messageSize);
+    
+    assert_int_equal(3U, self->tx.chIndex);
+    
+    // the only enabled channel is gone
+    assert_true(MAC_ticksUntilNextChannel(self) == UINT64_MAX);
+}
+
+static void cflist_shall_reload_channels(void **user)
+{
+    struct lora_mac *self = (struct lora_mac *)(*user);
+    size_t messageSize;
+    uint8_t message[50U];
+    struct lora_frame_join_accept ja;
+    size_t i;
+    
+    // five channels from 867.1MHz (a different band to channels 0..2)
+    (void)memset(&ja, 0, sizeof(ja));
+    ja.cfListPresent = true;
+    
+    for(i=0U; i < (sizeof(ja.cfList)/sizeof(*ja.cfList)); i++){
+        
+        ja.cfList[i] = 8671000U + (i * 2000U);
+    }
+    
+    messageSize = Frame_putJoinAccept(key, &ja, message, sizeof(message));    
+    
+    assert_true(MAC_join(self));
+    will_return(Radio_transmit, true);    
+    MAC_tick(self);   
+    MAC_radioEvent(self, LORA_RADIO_TX_COMPLETE, System_time());
+    MAC_tick(self);
+    system_time += MAC_ticksUntilNextEvent(self);
+    will_return(Radio_receive, true);    
+    MAC_tick(self);        
+    will_return(Radio_collect, (uint8_t)messageSize);
+    will_return(Radio_collect, message);
+    MAC_radioEvent(self, LORA_RADIO_RX_READY, System_time());
+    expect_value(responseHandler, type, LORA_MAC_READY);
+    MAC_tick(self);
+    
+    // the band used to join is off but the CFList channels are not
+    assert_int_equal(0U, MAC_ticksUntilNextChannel(self));
+    assert_true(send_on_next_channel(self) >= 3U);
+}
+
+static void link_adr_req_shall_reload_channels(void **user)
+{
+    struct lora_mac *self = (struct lora_mac *)(*user);
+    // DR5, TXPower 0, channel 2 only
+    static const uint8_t linkADRReq[] = {0x03U, 0x50U, 0x04U, 0x00U, 0x01U};
+    struct lora_frame_data f;
+    uint8_t message[50U];
+    size_t messageSize;
+    
+    (void)memset(&f, 0, sizeof(f));
+    f.devAddr = System_getDevAddr(self->system);
+    f.opts = linkADRReq;
+    f.optsLen = sizeof(linkADRReq);
+    messageSize = Frame_putData(FRAME_TYPE_DATA_UNCONFIRMED_DOWN, key, key, &f, message, sizeof(message));
+    
+    send_and_receive_at_rx1(self, message, messageSize);
+    
+    // the previous channel is not avoided when it is the only one
+    assert_int_equal(2U, send_on_next_channel(self));
+    assert_int_equal(2U, send_on_next_channel(self));
+}
+
+static void adr_backoff_shall_reload_channels(void **user)
+{
+    struct lora_mac *self = (struct lora_mac *)(*user);
+    
+    (void)System_maskChannel(self->system, 1U);
+    (void)System_maskChannel(self->system, 2U);
+    MAC_reloadChannels(self);
+    
+    MAC_setADR(self, true);
+    assert_true(MAC_setRate(self, 0U));
+    
+    // at DR0 and default power only the channel mask is left to reset
+    self->adrAckCounter = Region_getADRAckLimit(EU_863_870) + Region_getADRAckDelay(EU_863_870) - 1U;
+    
+    assert_int_equal(0U, send_on_next_channel(self));
+    
+    assert_false(System_channelIsMasked(self->system, 1U));
+    assert_false(System_channelIsMasked(self->system, 2U));
+    
+    assert_true(send_on_next_channel(self) != 0U);
+}
+
+#if defined(LORA_MAC_QUEUE)
+static void queue_shall_coalesce_messages_for_the_same_port(void **user)
+{
+    struct lora_mac *self = (struct lora_mac *)(*user);
+    static const uint8_t reading[] = {0x01U, 0x02U, 0x03U, 0x04U};
+    
+    assert_true(MAC_queue(self, false, 1U, reading, sizeof(reading)));
+    assert_true(MAC_queue(self, false, 1U, reading, sizeof(reading)));
+    assert_true(MAC_queue(self, false, 1U, reading, sizeof(reading)));
+    assert_true(MAC_queue(self, false, 2U, reading, sizeof(reading)));
+    
+    assert_int_equal(4U, MAC_queueLength(self));
+    
+    // a channel is available so the first frame is sent at the next tick
+    assert_true(immediate_event_is_pending(self));
+    will_return(Radio_transmit, true);    
+    MAC_tick(self);
+    
+    // three port 1 readings in one frame
+    assert_int_equal(1U, MAC_queueLength(self));
+    assert_int_equal(13U + (3U * sizeof(reading)), self->bufferLen);
+    
+    finish_unconfirmed_send(self);
+    
+    // port 2 reading waits for the duty cycle
+    assert_true(future_event_is_pending(self));
+    
+    system_time += MAC_ticksUntilNextEvent(self);
+    will_return(Radio_transmit, true);    
+    MAC_tick(self);
+    
+    assert_int_equal(0U, MAC_queueLength(self));
+    assert_int_equal(13U + sizeof(reading), self->bufferLen);
+}
+
+static void queue_shall_reject_when_full(void **user)
+{
+    struct lora_mac *self = (struct lora_mac *)(*user);
+    static const uint8_t reading[] = {0x01U};
+    size_t i;
+    
+    for(i=0U; i < LORA_MAC_QUEUE_DEPTH; i++){
+        
+        assert_true(MAC_queue(self, false, 1U, reading, sizeof(reading)));
+    }
+    
+    assert_false(MAC_queue(self, false, 1U, reading, sizeof(reading)));
+    
+    // nothing is sent before joining
+    assert_true(MAC_ticksUntilNextEvent(self) == UINT64_MAX);
+    
+    MAC_clearQueue(self);
+    
+    assert_int_equal(0U, MAC_queueLength(self));
+}
+#endif
+
 /* runner */
 
 int main(void)
@@ -329,7 +874,89 @@ int main(void)
         cmocka_unit_test_setup(
             unconfirmed_send_shall_callback_when_cycle_complete, 
             setup_mac_and_join
-        )
+        ),
+        
+        cmocka_unit_test_setup(
+            answers_shall_be_sent_in_fopts_of_next_uplink, 
+            setup_mac_and_join
+        ),
+        
+        cmocka_unit_test_setup(
+            answers_shall_be_sent_on_port_0_if_too_large_for_fopts, 
+            setup_mac_and_join
+        ),
+        
+        cmocka_unit_test_setup(
+            link_adr_req_shall_be_applied_and_answered, 
+            setup_mac_and_join
+        ),
+        
+        cmocka_unit_test_setup(
+            link_adr_req_block_shall_be_rejected_as_a_whole, 
+            setup_mac_and_join
+        ),
+        
+        cmocka_unit_test_setup(
+            adr_shall_lower_rate_without_downlinks, 
+            setup_mac_and_join
+        ),
+        
+        cmocka_unit_test_setup(
+            unconfirmed_send_shall_be_repeated_nbtrans_times, 
+            setup_mac_and_join
+        ),
+        
+        cmocka_unit_test_setup(
+            unconfirmed_repeats_shall_stop_on_a_downlink, 
+            setup_mac_and_join
+        ),
+        
+        cmocka_unit_test_setup(
+            channel_selection_shall_avoid_the_previous_channel, 
+            setup_mac_and_join
+        ),
+        
+        cmocka_unit_test_setup(
+            channel_selection_shall_follow_the_channel_mask, 
+            setup_mac_and_join
+        ),
+        
+        cmocka_unit_test_setup(
+            channel_selection_shall_filter_by_rate, 
+            setup_mac_and_join
+        ),
+        
+        cmocka_unit_test_setup(
+            new_channel_req_shall_reload_channels, 
+            setup_mac_and_join
+        ),
+        
+        cmocka_unit_test_setup(
+            cflist_shall_reload_channels, 
+            setup_mac
+        ),
+        
+        cmocka_unit_test_setup(
+            link_adr_req_shall_reload_channels, 
+            setup_mac_and_join
+        ),
+        
+        cmocka_unit_test_setup(
+            adr_backoff_shall_reload_channels, 
+            setup_mac_and_join
+        ),
+        
+#if defined(LORA_MAC_QUEUE)
+        cmocka_unit_test_setup(
+            queue_shall_coalesce_messages_for_the_same_port, 
+            setup_mac_and_join
+        ),
+        
+        cmocka_unit_test_setup(
+            queue_shall_reject_when_full, 
+            setup_mac
+        ),
+#endif
         
     };
 
@@ -23,10 +23,35 @@ static void test_putLinkCheckReq(void **user)
     assert_memory_equal(expected, buffer, Stream_tell(&s));    
 }
 
+static void test_putLinkADRReq(void **user)
+{
+    uint8_t buffer[50U];
+    struct lora_stream s;
+    Stream_init(&s, buffer, sizeof(buffer));    
+    bool retval;
+    struct lora_link_adr_req value;
+    
+    uint8_t expected[] = "\x03\x52\x07\x00\x63";
+    
+    value.dataRate = 5U;
+    value.txPower = 2U;
+    value.channelMask = 0x0007U;
+    value.channelMaskControl = 6U;
+    value.nbTrans = 3U;
+    
+    retval = MAC_putLinkADRReq(&s, &value);    
+    
+    assert_true(retval);
+    
+    assert_int_equal(sizeof(expected)-1U, Stream_tell(&s));
+    assert_memory_equal(expected, buffer, Stream_tell(&s));    
+}
+
 int main(void)
 {
     const struct CMUnitTest tests[] = {
         cmocka_unit_test(test_putLinkCheckReq),
+        cmocka_unit_test(test_putLinkADRReq),
     };
 
     return cmocka_run_group_tests(tests, NULL, NULL);
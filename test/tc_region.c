@@ -11,10 +11,23 @@ static void eu_868_870_is_supported(void **user)
     assert_true(Region_supported(EU_863_870));
 }
 
+static void us_902_928_mask_control_7_disables_125khz_channels(void **user)
+{
+    uint8_t first;
+    enum lora_region_mask_fill fill;
+    
+    assert_true(Region_getChannelMask(US_902_928, 7U, &first, &fill));
+    assert_int_equal(64U, first);
+    assert_int_equal(LORA_MASK_FILL_OFF, fill);
+    
+    assert_false(Region_getChannelMask(US_902_928, 5U, &first, &fill));
+}
+
 int main(void)
 {
     const struct CMUnitTest tests[] = {
         cmocka_unit_test(eu_868_870_is_supported),
+        cmocka_unit_test(us_902_928_mask_control_7_disables_125khz_channels),
     };
 
     return cmocka_run_group_tests(tests, NULL, NULL);
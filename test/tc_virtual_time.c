@@ -0,0 +1,144 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+
+#include "cmocka.h"
+
+#include "lora_event.h"
+#include "lora_system.h"
+
+#include <string.h>
+
+/* helpers */
+
+static struct lora_event events;
+
+static void eventHandler(void *receiver, uint64_t time, uint64_t error)
+{
+    check_expected_ptr(receiver);
+    check_expected(time);
+    check_expected(error);
+}
+
+/* simulates a radio interrupt arriving as the handler runs */
+static void interruptHandler(void *receiver, uint64_t time, uint64_t error)
+{
+    (void)Event_onInput(&events, EVENT_TX_COMPLETE, receiver, eventHandler);
+    Event_receive(&events, EVENT_TX_COMPLETE, time);
+}
+
+static int setup_event(void **user)
+{
+    Event_init(&events);
+    Event_setTime(0U);
+    *user = (void *)&events;
+    return 0;
+}
+
+/* tests */
+
+static void advance_shall_jump_to_each_deadline(void **user)
+{
+    struct lora_event *self = (struct lora_event *)(*user);
+
+    (void)Event_onTimeout(self, 100U, self, eventHandler);
+    (void)Event_onTimeout(self, 5000U, self, eventHandler);
+
+    expect_value(eventHandler, receiver, self);
+    expect_value(eventHandler, time, 100U);
+    expect_value(eventHandler, error, 0U);
+
+    expect_value(eventHandler, receiver, self);
+    expect_value(eventHandler, time, 5000U);
+    expect_value(eventHandler, error, 0U);
+
+    Event_advance(self, 10000U);
+
+    assert_true( System_time() == 10000U );
+}
+
+static void advance_shall_stop_at_until(void **user)
+{
+    struct lora_event *self = (struct lora_event *)(*user);
+
+    (void)Event_onTimeout(self, 200U, self, eventHandler);
+
+    Event_advance(self, 100U);
+
+    assert_true( System_time() == 100U );
+    assert_true( Event_nextDeadline(self) == 200U );
+}
+
+static void advance_shall_service_io_events_at_current_time(void **user)
+{
+    struct lora_event *self = (struct lora_event *)(*user);
+
+    (void)Event_onTimeout(self, 300U, self, interruptHandler);
+
+    expect_value(eventHandler, receiver, self);
+    expect_value(eventHandler, time, 300U);
+    expect_value(eventHandler, error, 0U);
+
+    Event_advance(self, 1000U);
+
+    assert_true( Event_nextDeadline(self) == UINT64_MAX );
+}
+
+#if defined(LORA_EVENT_GROUP)
+static void groupAdvance_shall_interleave_members(void **user)
+{
+    static struct lora_event other;
+    static struct lora_event_group group;
+    struct lora_event *self = (struct lora_event *)(*user);
+
+    Event_init(&other);
+    EventGroup_init(&group);
+
+    assert_true( EventGroup_add(&group, self) );
+    assert_true( EventGroup_add(&group, &other) );
+
+    (void)Event_onTimeout(self, 20U, self, eventHandler);
+    (void)Event_onTimeout(&other, 10U, &other, eventHandler);
+
+    expect_value(eventHandler, receiver, &other);
+    expect_value(eventHandler, time, 10U);
+    expect_value(eventHandler, error, 0U);
+
+    expect_value(eventHandler, receiver, self);
+    expect_value(eventHandler, time, 20U);
+    expect_value(eventHandler, error, 0U);
+
+    EventGroup_advance(&group, 30U);
+
+    assert_true( System_time() == 30U );
+}
+#endif
+
+/* runner */
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+
+        cmocka_unit_test_setup(
+            advance_shall_jump_to_each_deadline,
+            setup_event
+        ),
+        cmocka_unit_test_setup(
+            advance_shall_stop_at_until,
+            setup_event
+        ),
+        cmocka_unit_test_setup(
+            advance_shall_service_io_events_at_current_time,
+            setup_event
+        ),
+#if defined(LORA_EVENT_GROUP)
+        cmocka_unit_test_setup(
+            groupAdvance_shall_interleave_members,
+            setup_event
+        ),
+#endif
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}